@@ -1,50 +1,106 @@
 #include "OSTreeTUI.hpp"
 
 #include <fcntl.h>
+#include <sys/resource.h>
 #include <algorithm>
 #include <cstddef>
+#include <chrono>
 #include <cstdio>
+#include <format>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <exception>
 #include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <ftxui/component/event.hpp>  // for Event, Event::ArrowDown, Event::ArrowUp, Event::End, Event::Home, Event::PageDown, Event::PageUp
 #include "ftxui/component/component.hpp"  // for Renderer, ResizableSplitBottom, ResizableSplitLeft, ResizableSplitRight, ResizableSplitTop
 #include "ftxui/component/component_base.hpp"      // for ComponentBase
+#include "ftxui/component/mouse.hpp"               // for Mouse
 #include "ftxui/component/screen_interactive.hpp"  // for ScreenInteractive
 #include "ftxui/dom/elements.hpp"                  // for Element, operator|, text, center, border
+#include "ftxui/screen/screen.hpp"                 // for Screen
 
 #include "clip.h"
 
+#include "../util/commitIndex.hpp"
 #include "../util/cpplibostree.hpp"
+#include "../util/reachability.hpp"
+#include "../util/repoStatistics.hpp"
+#include "../util/signatureVerifier.hpp"
 
-OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& startupBranches)
-    : ostreeRepo(repo), selectedCommit(0), screen(ftxui::ScreenInteractive::Fullscreen()) {
+OSTreeTUI::OSTreeTUI(const std::vector<std::string>& repos,
+                     const cpplibostree::LoadOptions& loadOptions,
+                     bool useDaemon)
+    : screen(ftxui::ScreenInteractive::Fullscreen()) {
     using namespace ftxui;
 
-    // set all branches as visible and define a branch color
-    for (const auto& branch : ostreeRepo.GetBranches()) {
-        // if startupBranches are defined, set all as non-visible
-        visibleBranches[branch] = startupBranches.size() == 0 ? true : false;
-        std::hash<std::string> nameHash{};
-        branchColorMap[branch] = Color::Palette256((nameHash(branch) + 10) % 256);
-    }
-    // if startupBranches are defined, only set those visible
-    if (startupBranches.size() != 0) {
-        for (const auto& branch : startupBranches) {
-            visibleBranches[branch] = true;
+    // repositories are loaded in parallel on the shared worker pool (see startLoading()), the
+    // branches get shown as soon as their first commits arrived
+    loadStart = std::chrono::steady_clock::now();
+    // an index daemon serves the complete history, limited loads are done locally
+    const bool unlimited = loadOptions.depth == 0 && !loadOptions.since.has_value() &&
+                           loadOptions.refs.empty();
+    for (const auto& repo : repos) {
+        auto tab = std::make_unique<RepositoryTab>();
+        tab->repo = std::make_unique<cpplibostree::OSTreeRepo>(repo, false);
+        tab->loadOptions = loadOptions;
+        if (useDaemon && unlimited) {
+            tab->daemon = cpplibostree::DaemonClient::Connect(repo);
         }
+        repositoryTabs.push_back(std::move(tab));
+        repositoryTabNames.push_back(" " + repo + " ");
     }
 
+    for (auto& tab : repositoryTabs) {
+        tab->filterManager = std::unique_ptr<BranchBoxManager>(
+            new BranchBoxManager(*this, *tab->repo, tab->visibleBranches));
+        tab->statsManager =
+            std::unique_ptr<StatisticsManager>(new StatisticsManager(*this, threadPool));
+        tab->verifier = std::make_unique<cpplibostree::CommitVerifier>(threadPool);
+    }
+    // asynchronous operations report back through the event loop, once they are done (the mode
+    // is taken on the UI thread, when the operation is submitted)
+    executor = [this](std::function<void()> task) {
+        threadPool.Submit([this, task = std::move(task), interactive = headlessHeight == 0] {
+            task();
+            if (interactive) {
+                screen.Post([this] { handleFinishedOperations(); });
+                screen.PostEvent(Event::Custom);
+            }
+        });
+    };
+    for (auto& tab : repositoryTabs) {
+        tab->asyncRepo = std::make_unique<cpplibostree::AsyncRepo>(*tab->repo, executor);
+        startLoading(*tab);
+    }
+    swapRepositoryTabState(0);
+    prefetcher = std::make_unique<cpplibostree::CommitPrefetcher>(threadPool);
+
     // COMMIT TREE
     RefreshCommitComponents();
 
     tree = Renderer([&] {
-        RefreshCommitComponents();
+        auto renderStart = std::chrono::steady_clock::now();
+        if (headlessHeight == 0) {
+            loadOlderHistoryIfNeeded();
+            publishControlSnapshots();
+        }
+        // the commit windows are rebuilt by RefreshCommitListComponent(), only the view is
+        // updated here (kept, while neither the data, nor the filter changed)
+        parseVisibleCommitMap();
         selectedCommit = std::min(selectedCommit, visibleCommitViewMap.size() - 1);
         // check for promotion & gray-out branch-colors if needed
+        Element commitTree;
         if ((viewMode == ViewMode::COMMIT_PROMOTION || viewMode == ViewMode::COMMIT_DRAGGING) &&
             modeBranch.size() != 0) {
             std::unordered_map<std::string, Color> promotionBranchColorMap{};
@@ -55,9 +111,12 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
                     promotionBranchColorMap.insert({str, Color::GrayDark});
                 }
             }
-            return CommitRender::commitRender(*this, promotionBranchColorMap);
+            commitTree = CommitRender::commitRender(*this, promotionBranchColorMap);
+        } else {
+            commitTree = CommitRender::commitRender(*this, branchColorMap);
         }
-        return CommitRender::commitRender(*this, branchColorMap);
+        commitRenderDuration = std::chrono::steady_clock::now() - renderStart;
+        return commitTree;
     });
 
     commitListComponent = Container::Horizontal({tree, commitList});
@@ -77,6 +136,22 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
             adjustScrollToSelectedCommit();
             return true;
         }
+        // jump a page, or to the ends of the list
+        if (viewMode == ViewMode::DEFAULT && !visibleCommitViewMap.empty() &&
+            (event == Event::PageUp || event == Event::PageDown || event == Event::Home ||
+             event == Event::End)) {
+            const size_t last = visibleCommitViewMap.size() - 1;
+            const size_t page = getCommitsPerScreen();
+            if (event == Event::PageUp) {
+                selectedCommit -= std::min(selectedCommit, page);
+            } else if (event == Event::PageDown) {
+                selectedCommit = std::min(selectedCommit + page, last);
+            } else {
+                selectedCommit = event == Event::Home ? 0 : last;
+            }
+            adjustScrollToSelectedCommit();
+            return true;
+        }
         return false;
     });
 
@@ -87,32 +162,124 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
         if (visibleCommitViewMap.size() <= 0) {
             return text(" no commit info available ") | color(Color::RedLight) | bold | center;
         }
-        return CommitInfoManager::renderInfoView(
-            ostreeRepo.GetCommitList().at(visibleCommitViewMap.at(selectedCommit)));
+        const std::string& hash = visibleCommitViewMap.at(selectedCommit);
+        const auto& commit = ostreeRepo->GetCommitList().at(hash);
+        prefetcher->Update(*ostreeRepo, visibleCommitViewMap, selectedCommit);
+        // verification of this commit, appended below the details
+        auto verification = commitVerifier->GetProgress();
+        Element verificationElement =
+            verification.has_value() && verification->hash == hash
+                ? CommitInfoManager::renderVerification(verification.value())
+                : text("");
+        // refs containing the commit, answered by the ancestry index without walking the history
+        const auto& reachability = ostreeRepo->GetReachabilityIndex();
+        const auto commitId = reachability.GetId(hash);
+        const std::vector<std::string> containingRefs =
+            commitId.has_value() ? reachability.GetContainingRefs(commitId.value())
+                                 : std::vector<std::string>{};
+        // headless mode waits for the details & size, to render a deterministic frame
+        if (headlessHeight > 0) {
+            return vbox({CommitInfoManager::renderInfoView(
+                             commit, prefetcher->GetDetails(*ostreeRepo, hash).get(),
+                             ostreeRepo->ComputeCommitSize(hash, std::string(commit.parent)),
+                             containingRefs),
+                         verificationElement});
+        }
+        auto details =
+            prefetcher->GetDetails(*ostreeRepo, hash, [this] { screen.Post(Event::Custom); });
+        return vbox({CommitInfoManager::renderInfoView(commit, details.get(),
+                                                       ostreeRepo->GetCommitSize(hash),
+                                                       containingRefs),
+                     verificationElement});
     });
 
-    // filter
-    filterManager =
-        std::unique_ptr<BranchBoxManager>(new BranchBoxManager(*this, ostreeRepo, visibleBranches));
-    filterView =
-        Renderer(filterManager->branchBoxes, [&] { return filterManager->branchBoxRender(); });
+    // filter (branch boxes of the active tab)
+    filterContainer = Container::Vertical({filterManager->branchBoxes});
+    filterView = Renderer(filterContainer, [&] { return filterManager->branchBoxRender(); });
+
+    // statistics
+    statsView = Renderer([&] { return statsManager->statisticsRender(); });
 
     // interchangeable view (composed)
-    manager = std::unique_ptr<Manager>(new Manager(*this, infoView, filterView));
+    manager = std::unique_ptr<Manager>(new Manager(*this, infoView, filterView, statsView));
     managerRenderer = manager->getManagerRenderer();
 
-    // FOOTER
-    FooterRenderer = Renderer([&] { return footer.FooterRender(); });
+    // FOOTER (replaced by the "go to", or retention prompt, while it is open)
+    InputOption goToOption;
+    goToOption.multiline = false;
+    goToOption.on_enter = [&] {
+        GoTo(goToQuery);
+        goToQuery.clear();
+        goToPromptShown = false;
+        commitListComponent->TakeFocus();
+    };
+    goToInput = Input(&goToQuery, "commit hash, ref, or YYYY-MM-DD", goToOption);
+    // retention prompt: the first Enter previews the policy, the second one applies it
+    InputOption retentionOption;
+    retentionOption.multiline = false;
+    retentionOption.on_enter = [&] {
+        if (!retentionPlan.has_value() || retentionPlanQuery != retentionQuery) {
+            PlanRetention(retentionQuery);
+            return;
+        }
+        if (!retentionPlan->droppedCommits.empty()) {
+            ApplyRetention();
+        }
+        retentionPlan.reset();
+        retentionQuery.clear();
+        retentionPromptShown = false;
+        commitListComponent->TakeFocus();
+    };
+    retentionInput = Input(&retentionQuery, "keep N, or YYYY-MM-DD [ref globs...]",
+                           retentionOption);
+    Component footerPrompts = Container::Vertical(
+        {Maybe(goToInput, &goToPromptShown), Maybe(retentionInput, &retentionPromptShown)});
+    FooterRenderer = Renderer(footerPrompts, [&] {
+        if (goToPromptShown) {
+            return hbox(
+                {text(" Go to: ") | bold | color(Color::Green), goToInput->Render() | flex});
+        }
+        if (retentionPromptShown) {
+            return hbox({text(" Retain: ") | bold | color(Color::Green),
+                         retentionInput->Render() | flex, renderRetentionPreview()});
+        }
+        // loading indicator, while the commits of the active tab are still arriving
+        const RepositoryTab& tab = *repositoryTabs.at(activeTab);
+        if (tab.loading || tab.streaming) {
+            return hbox({footer.FooterRender() | flex, separator(),
+                         text(" loading " + std::to_string(ostreeRepo->GetCommitList().size()) +
+                              " commits... ") |
+                             bold | color(Color::YellowLight)});
+        }
+        return footer.FooterRender();
+    });
 
     // BUILD MAIN CONTAINER
     container = Component(managerRenderer);
     container = ResizableSplitLeft(commitListComponent, container, &logSize);
+    // repository tabs, only if multiple repositories are opened
+    if (repositoryTabs.size() > 1) {
+        MenuOption tabOption = MenuOption::HorizontalAnimated();
+        tabOption.on_change = [&] { SwitchRepositoryTab(static_cast<size_t>(repositoryTabIndex)); };
+        repositoryTabBar = Menu(&repositoryTabNames, &repositoryTabIndex, tabOption);
+        container = Container::Vertical({repositoryTabBar, container | flex});
+    }
     container = ResizableSplitBottom(FooterRenderer, container, &footerSize);
 
     commitListComponent->TakeFocus();
 
     // add application shortcuts
     mainContainer = CatchEvent(container | border, [&](const Event& event) {
+        // shortcuts on the selected commit, the commit list is empty while loading
+        if ((event == Event::AltP || event == Event::AltD || event == Event::AltV ||
+             event == Event::AltC) &&
+            (repositoryTabs.at(activeTab)->loading ||
+             selectedCommit >= visibleCommitViewMap.size())) {
+            if (repositoryTabs.at(activeTab)->loading) {
+                notificationText = " Still loading the repository ";
+            }
+            return true;
+        }
         // start commit promotion window
         if (event == Event::AltP) {
             SetViewMode(ViewMode::COMMIT_PROMOTION, visibleCommitViewMap.at(selectedCommit));
@@ -121,7 +288,17 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
         if (event == Event::AltD) {
             std::string hashToDrop = visibleCommitViewMap.at(selectedCommit);
             SetViewMode(ViewMode::COMMIT_DROP, hashToDrop);
-            SetModeBranch(GetOstreeRepo().GetCommitList().at(hashToDrop).branch);
+            SetModeBranch(std::string(GetOstreeRepo().GetCommitList().at(hashToDrop).branch));
+        }
+        // show, or hide the orphaned commits
+        if (event == Event::AltO) {
+            ToggleOrphanedCommits();
+            return true;
+        }
+        // verify all objects of the commit
+        if (event == Event::AltV) {
+            VerifyCommit(visibleCommitViewMap.at(selectedCommit));
+            return true;
         }
         // copy commit id
         if (event == Event::AltC) {
@@ -130,10 +307,37 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
             notificationText = " Copied Hash " + hash + " ";
             return true;
         }
+        // open & close the "go to" prompt
+        if (event == Event::AltG) {
+            retentionPromptShown = false;
+            goToPromptShown = true;
+            goToInput->TakeFocus();
+            return true;
+        }
+        // open the retention prompt
+        if (event == Event::AltK) {
+            goToPromptShown = false;
+            retentionPromptShown = true;
+            retentionInput->TakeFocus();
+            return true;
+        }
+        if (event == Event::Escape && (goToPromptShown || retentionPromptShown)) {
+            goToQuery.clear();
+            goToPromptShown = false;
+            retentionQuery.clear();
+            retentionPlan.reset();
+            retentionPromptShown = false;
+            commitListComponent->TakeFocus();
+            return true;
+        }
+        // switch to next repository tab
+        if (event == Event::AltT && repositoryTabs.size() > 1) {
+            SwitchRepositoryTab((activeTab + 1) % repositoryTabs.size());
+            return true;
+        }
         // refresh repository
         if (event == Event::AltR) {
             RefreshOSTreeRepository();
-            notificationText = " Refreshed Repository Data ";
             return true;
         }
         // exit
@@ -174,9 +378,121 @@ int OSTreeTUI::Run() {
         }
     });
 
+    // cached signatures of older keyrings, verified again while the UI is already usable
+    for (const auto& tab : repositoryTabs) {
+        recheckStaleSignatures(*tab->repo);
+    }
+
     screen.Loop(mainContainer);
     runSubThreads = false;
     footerNotificationUpdater.join();
+    detachDaemons();
+    // actions posted from now on would never run
+    controlServer.reset();
+
+    return EXIT_SUCCESS;
+}
+
+bool OSTreeTUI::StartControlServer(const std::string& socketPath) {
+    std::vector<const cpplibostree::OSTreeRepo*> repos;
+    for (const auto& tab : repositoryTabs) {
+        repos.push_back(tab->repo.get());
+    }
+    controlServer = std::make_unique<cpplibostree::ControlServer>(
+        socketPath, repos, threadPool, [this](cpplibostree::ControlAction action) {
+            auto done = std::make_shared<std::promise<bool>>();
+            std::future<bool> result = done->get_future();
+            screen.Post(
+                [this, action = std::move(action), done] { runControlAction(action, done); });
+            screen.PostEvent(ftxui::Event::Custom);
+            return result;
+        });
+    if (!controlServer->Start()) {
+        controlServer.reset();
+        return false;
+    }
+    return true;
+}
+
+int OSTreeTUI::RunHeadless(int width, int height, const std::vector<ScriptedEvent>& events) {
+    using namespace ftxui;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    headlessHeight = height;
+    // no event loop: wait for the first batch of every tab, the rest of the history is then
+    // loaded right away (see streamHistory())
+    while (!pendingOperations.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        handleFinishedOperations();
+    }
+
+    auto renderFrame = [&](Screen& frame) {
+        auto renderStart = std::chrono::steady_clock::now();
+        Element document = mainContainer->Render();
+        Render(frame, document);
+        return Milliseconds(std::chrono::steady_clock::now() - renderStart);
+    };
+    auto report = [&](const std::string& step, Milliseconds total) {
+        std::cerr << std::format("{:<24} {:>10.3f} ms  (commitRender {:.3f} ms)\n", step,
+                                 total.count(), Milliseconds(commitRenderDuration).count());
+    };
+
+    std::cerr << std::format("{:<24} {:>10.3f} ms\n", "first batch",
+                             Milliseconds(firstBatchDuration).count());
+    std::cerr << std::format("{:<24} {:>10.3f} ms  ({} commits)\n", "load",
+                             Milliseconds(loadDuration).count(),
+                             ostreeRepo->GetCommitList().size());
+
+    auto frame = Screen::Create(Dimension::Fixed(width), Dimension::Fixed(height));
+    report("first frame", renderFrame(frame));
+    loadOlderHistoryIfNeeded();
+
+    // scripted interaction: every event is handled & followed by a new frame
+    for (const auto& scriptedEvent : events) {
+        frame = Screen::Create(Dimension::Fixed(width), Dimension::Fixed(height));
+        auto eventStart = std::chrono::steady_clock::now();
+        mainContainer->OnEvent(scriptedEvent.event);
+        Milliseconds eventDuration = std::chrono::steady_clock::now() - eventStart;
+        report("event " + scriptedEvent.name, eventDuration + renderFrame(frame));
+        loadOlderHistoryIfNeeded();
+    }
+
+    // memory footprint of the loaded commits
+    const auto commitText = ostreeRepo->GetCommitTextStatistics();
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    std::cerr << std::format("{:<24} {:>10} KiB  (commit text {} in {} allocations)\n",
+                             "peak RSS", usage.ru_maxrss,
+                             cpplibostree::FormatByteSize(commitText.usedBytes), commitText.blocks);
+
+    // prefetching of commit details around the selection
+    const auto prefetch = prefetcher->GetStatistics();
+    const auto selections = static_cast<double>(prefetch.hits + prefetch.misses);
+    std::cerr << std::format(
+        "{:<24} {:>10.1f} %   (window {}, {} hits, {} misses, {} cancelled)\n",
+        "prefetch hit rate",
+        selections == 0 ? 0.0 : 100.0 * static_cast<double>(prefetch.hits) / selections,
+        prefetch.window, prefetch.hits, prefetch.misses, prefetch.cancelled);
+
+    // last commit verification
+    if (auto verification = commitVerifier->GetProgress(); verification.has_value()) {
+        std::cerr << std::format(
+            "{:<24} {:>10.3f} ms  ({} objects, {} skipped, {} broken, {}/s)\n",
+            "verify " + verification->hash.substr(0, 8),
+            Milliseconds(verification->elapsed).count(), verification->objectsTotal,
+            verification->objectsSkipped, verification->objectsBroken,
+            cpplibostree::FormatByteSize(static_cast<uint64_t>(verification->GetThroughput())));
+    }
+
+    // plain text output, for snapshot comparisons
+    for (int y{0}; y < frame.dimy(); y++) {
+        std::string line;
+        for (int x{0}; x < frame.dimx(); x++) {
+            line += frame.PixelAt(x, y).character;
+        }
+        std::cout << line << "\n";
+    }
+    std::cout.flush();
 
     return EXIT_SUCCESS;
 }
@@ -193,10 +509,16 @@ void OSTreeTUI::RefreshCommitComponents() {
         i++;
     }
 
-    commitList =
-        commitComponents.size() <= 1
-            ? Renderer([&] { return text(" no commits to be shown ") | color(Color::Red); })
-            : Container::Stacked(commitComponents);
+    if (commitComponents.size() > 1) {
+        commitList = Container::Stacked(commitComponents);
+        return;
+    }
+    commitList = Renderer([&] {
+        if (repositoryTabs.at(activeTab)->loading) {
+            return text(" loading commits... ") | color(Color::YellowLight);
+        }
+        return text(" no commits to be shown ") | color(Color::Red);
+    });
 }
 
 void OSTreeTUI::RefreshCommitListComponent() {
@@ -211,8 +533,11 @@ void OSTreeTUI::RefreshCommitListComponent() {
 }
 
 bool OSTreeTUI::RefreshOSTreeRepository() {
-    ostreeRepo.UpdateData();
-    RefreshCommitListComponent();
+    notificationText = " Refreshing Repository Data ";
+    if (!refreshRepositoryTab(*repositoryTabs.at(activeTab), true)) {
+        notificationText = " Still loading the repository ";
+        return false;
+    }
     return true;
 }
 
@@ -252,64 +577,687 @@ bool OSTreeTUI::PromoteCommit(const std::string& hash,
                               const std::vector<std::string>& metadataStrings,
                               const std::string& newSubject,
                               bool keepMetadata) {
-    bool success =
-        ostreeRepo.PromoteCommit(hash, targetBranch, metadataStrings, newSubject, keepMetadata);
-    SetViewMode(ViewMode::DEFAULT);
-    // reload repository
-    if (success) {
-        scrollOffset = 0;
-        selectedCommit = 0;
-        screen.PostEvent(ftxui::Event::AltR);
-        notificationText = "Promoted commit " + hash.substr(0, 8) + " to branch " + targetBranch;
+    // the orphan lane is no ref
+    if (targetBranch == cpplibostree::ORPHANED_BRANCH) {
+        SetViewMode(ViewMode::DEFAULT);
+        notificationText = " Orphaned commits can only be promoted to a branch ";
+        return false;
     }
-    return success;
+    RepositoryTab* tab = repositoryTabs.at(activeTab).get();
+    SetViewMode(ViewMode::DEFAULT);
+    notificationText = " Promoting commit " + hash.substr(0, 8) + " ";
+    onFinished<bool>(
+        tab->asyncRepo->PromoteCommit(hash, targetBranch, metadataStrings, newSubject,
+                                      keepMetadata),
+        [this, tab, hash, targetBranch](bool success) {
+            // reload repository
+            if (success) {
+                if (tab->repo.get() == ostreeRepo) {
+                    scrollOffset = 0;
+                    selectedCommit = 0;
+                }
+                refreshRepositoryTab(*tab, false);
+                notificationText =
+                    "Promoted commit " + hash.substr(0, 8) + " to branch " + targetBranch;
+            }
+        });
+    return true;
 }
 
 bool OSTreeTUI::RemoveCommit(const cpplibostree::Commit& commit) {
-    bool success = ostreeRepo.RemoveCommitFromBranchAndPrune(commit);
+    RepositoryTab* tab = repositoryTabs.at(activeTab).get();
     SetViewMode(ViewMode::DEFAULT);
-    // reload repository
-    if (success) {
-        scrollOffset = 0;
+    const std::string message = "commit " + std::string(commit.hash.substr(0, 8)) +
+                                " from branch " + std::string(commit.branch);
+    notificationText = " Dropping " + message + " ";
+    onFinished<bool>(tab->asyncRepo->RemoveCommit(commit), [this, tab, message](bool success) {
+        // reload repository
+        if (success) {
+            if (tab->repo.get() == ostreeRepo) {
+                scrollOffset = 0;
+                selectedCommit = 0;
+            }
+            refreshRepositoryTab(*tab, false);
+            notificationText = "Dropped " + message;
+        } else {
+            notificationText = "Failed to drop commit";
+        }
+    });
+    return true;
+}
+
+void OSTreeTUI::RequestCommitSizes(const std::vector<std::string>& hashes) {
+    std::lock_guard<std::mutex> lock(pendingCommitSizesMutex);
+    for (const auto& hash : hashes) {
+        if (ostreeRepo->GetCommitSize(hash).has_value() || pendingCommitSizes.contains(hash)) {
+            continue;
+        }
+        auto commit = ostreeRepo->GetCommitList().find(hash);
+        if (commit == ostreeRepo->GetCommitList().end()) {
+            continue;
+        }
+        pendingCommitSizes.insert(hash);
+        // copy the parent, the commit list might be reloaded before the task runs
+        threadPool.Submit([this, repo = ostreeRepo, hash,
+                           parent = std::string(commit->second.parent)] {
+            repo->ComputeCommitSize(hash, parent);
+            {
+                std::lock_guard<std::mutex> lock(pendingCommitSizesMutex);
+                pendingCommitSizes.erase(hash);
+            }
+            screen.Post(ftxui::Event::Custom);
+        });
+    }
+}
+
+bool OSTreeTUI::VerifyCommit(const std::string& hash) {
+    if (!commitVerifier->Start(ostreeRepo->GetRepoPath(), hash,
+                               [this] { screen.Post(ftxui::Event::Custom); })) {
+        notificationText = " Another commit is still being verified ";
+        return false;
+    }
+    // headless mode has no event loop to show the progress
+    if (headlessHeight > 0) {
+        commitVerifier->Wait();
+    }
+    notificationText = " Verifying commit " + hash.substr(0, 8) + " ";
+    return true;
+}
+
+bool OSTreeTUI::SwitchRepositoryTab(size_t index) {
+    if (index >= repositoryTabs.size() || index == activeTab) {
+        repositoryTabIndex = static_cast<int>(activeTab);
+        return false;
+    }
+    SetViewMode(ViewMode::DEFAULT);
+
+    // swap the current state back into its tab & the state of the new tab in
+    swapRepositoryTabState(activeTab);
+    swapRepositoryTabState(index);
+    repositoryTabIndex = static_cast<int>(index);
+
+    filterContainer->DetachAllChildren();
+    filterContainer->Add(filterManager->branchBoxes);
+    RefreshCommitListComponent();
+    notificationText = " Switched to " + ostreeRepo->GetRepoPath() + " ";
+    return true;
+}
+
+bool OSTreeTUI::GoTo(const std::string& query) {
+    if (query.empty()) {
+        return false;
+    }
+    // ref
+    const auto& heads = ostreeRepo->GetBranchHeads();
+    if (auto head = heads.find(query); head != heads.end()) {
+        return selectCommitByHash(head->second);
+    }
+    // date
+    int year{0};
+    unsigned int month{0};
+    unsigned int day{0};
+    char trailing{0};
+    if (std::sscanf(query.c_str(), "%d-%u-%u%c", &year, &month, &day, &trailing) == 3) {
+        const std::chrono::year_month_day date{std::chrono::year(year), std::chrono::month(month),
+                                               std::chrono::day(day)};
+        if (!date.ok()) {
+            notificationText = " Invalid date " + query + " (use YYYY-MM-DD) ";
+            return false;
+        }
+        // newest commit, that is not newer than the end of the day
+        const std::chrono::sys_days endOfDay = std::chrono::sys_days(date) + std::chrono::days(1);
+        const cpplibostree::Timepoint time(
+            std::chrono::duration_cast<std::chrono::seconds>(endOfDay.time_since_epoch()) -
+            std::chrono::seconds(1));
+        auto position =
+            cpplibostree::FindInTimeline(visibleCommitViewMap, ostreeRepo->GetCommitList(), time);
+        if (!position.has_value()) {
+            notificationText = " No visible commit on, or before " + query + " ";
+            return false;
+        }
+        return selectCommitByHash(visibleCommitViewMap.at(position.value()));
+    }
+    // hash prefix
+    auto hashes = ostreeRepo->GetCommitIndex().FindByPrefix(query);
+    if (hashes.size() != 1) {
+        notificationText = hashes.empty() ? " No commit, ref, or date matches " + query + " "
+                                          : " Ambiguous hash " + query + " (" +
+                                                std::to_string(hashes.size()) + " commits) ";
+        return false;
+    }
+    return selectCommitByHash(hashes.front());
+}
+
+bool OSTreeTUI::PlanRetention(const std::string& policy) {
+    std::vector<std::string> words;
+    std::istringstream policyStream(policy);
+    for (std::string word; policyStream >> word;) {
+        words.push_back(word);
+    }
+    auto parsed = cpplibostree::RetentionPolicy::Parse(words);
+    if (!parsed.has_value()) {
+        retentionPlan.reset();
+        notificationText = " Invalid retention policy (use N, or YYYY-MM-DD & ref globs) ";
+        return false;
+    }
+    retentionPlan = cpplibostree::PlanRetention(*ostreeRepo, parsed.value());
+    retentionPlanQuery = policy;
+    RequestCommitSizes(retentionPlan->droppedCommits);
+    return true;
+}
+
+bool OSTreeTUI::ApplyRetention() {
+    if (!retentionPlan.has_value()) {
+        return false;
+    }
+    RepositoryTab* tab = repositoryTabs.at(activeTab).get();
+    notificationText = " Pruning " + std::to_string(retentionPlan->droppedCommits.size()) +
+                       " commits ";
+    onFinished<std::optional<cpplibostree::RetentionResult>>(
+        tab->asyncRepo->ApplyRetention(retentionPlan.value()),
+        [this, tab](std::optional<cpplibostree::RetentionResult> result) {
+            // reload repository
+            if (result.has_value()) {
+                if (tab->repo.get() == ostreeRepo) {
+                    scrollOffset = 0;
+                    selectedCommit = 0;
+                }
+                refreshRepositoryTab(*tab, false);
+                notificationText = " Pruned " + std::to_string(result->objectsPruned) +
+                                   " objects, freed " +
+                                   cpplibostree::FormatByteSize(result->bytesPruned) + " ";
+            } else {
+                notificationText = " Failed to apply the retention policy ";
+            }
+        });
+    retentionPlan.reset();
+    return true;
+}
+
+bool OSTreeTUI::ToggleOrphanedCommits() {
+    using namespace ftxui;
+
+    if (repositoryTabs.at(activeTab)->loading) {
+        notificationText = " Still loading the repository ";
+        return false;
+    }
+    const std::string lane(cpplibostree::ORPHANED_BRANCH);
+    if (visibleBranches[lane]) {
+        SetViewMode(ViewMode::DEFAULT);
+        visibleBranches[lane] = false;
+        ostreeRepo->SetOrphanedCommits({});
         selectedCommit = 0;
-        screen.PostEvent(ftxui::Event::AltR);
-        notificationText =
-            "Dropped commit " + commit.hash.substr(0, 8) + " from branch " + commit.branch;
-    } else {
-        notificationText = "Failed to drop commit";
+        scrollOffset = 0;
+        RefreshCommitListComponent();
+        notificationText = " Hid orphaned commits ";
+        return true;
+    }
+    auto stats = statsManager->GetStatistics(headlessHeight > 0);
+    if (!stats.has_value()) {
+        notificationText = " Scanning for orphaned commits, try again when the scan is done ";
+        return false;
+    }
+    if (ostreeRepo->SetOrphanedCommits(std::move(stats->orphanedCommits)) == 0) {
+        notificationText = " No orphaned commits ";
+        return false;
     }
-    return success;
+    visibleBranches[lane] = true;
+    branchColorMap[lane] = Color::GrayLight;
+    RequestCommitSizes(ostreeRepo->GetOrphanedCommits());
+    RefreshCommitListComponent();
+    notificationText = " Showing " + std::to_string(ostreeRepo->GetOrphanedCommits().size()) +
+                       " orphaned commits ";
+    return true;
+}
+
+bool OSTreeTUI::PruneOrphanedCommits() {
+    RepositoryTab* tab = repositoryTabs.at(activeTab).get();
+    const size_t orphans = ostreeRepo->GetOrphanedCommits().size();
+    SetViewMode(ViewMode::DEFAULT);
+    notificationText = " Pruning " + std::to_string(orphans) + " orphaned commits ";
+    onFinished<cpplibostree::PruneResult>(
+        tab->asyncRepo->PruneOrphanedCommits(),
+        [this, tab, orphans](cpplibostree::PruneResult result) {
+            // reload repository
+            if (result.success) {
+                const std::string lane(cpplibostree::ORPHANED_BRANCH);
+                if (tab->repo.get() == ostreeRepo) {
+                    visibleBranches[lane] = false;
+                    scrollOffset = 0;
+                    selectedCommit = 0;
+                } else {
+                    tab->visibleBranches[lane] = false;
+                }
+                refreshRepositoryTab(*tab, false);
+                notificationText = " Pruned " + std::to_string(orphans) + " orphaned commits (" +
+                                   std::to_string(result.objectsPruned) + " objects), freed " +
+                                   cpplibostree::FormatByteSize(result.bytesPruned) + " ";
+            } else {
+                notificationText = " Failed to prune orphaned commits ";
+            }
+        });
+    return true;
+}
+
+bool OSTreeTUI::selectCommitByHash(std::string_view hash) {
+    const auto& commits = ostreeRepo->GetCommitList();
+    auto commit = commits.find(hash);
+    if (commit == commits.end()) {
+        return false;
+    }
+    // show the branch, if it is filtered out
+    const std::string branch(commit->second.branch);
+    if (!visibleBranches[branch]) {
+        visibleBranches[branch] = true;
+        RefreshCommitListComponent();
+    }
+    auto position = cpplibostree::FindInTimeline(visibleCommitViewMap, commits, hash);
+    if (!position.has_value()) {
+        return false;
+    }
+    SetViewMode(ViewMode::DEFAULT);
+    selectedCommit = position.value();
+    adjustScrollToSelectedCommit();
+    notificationText = " Went to commit " + std::string(hash.substr(0, 8)) + " on " + branch + " ";
+    return true;
+}
+
+size_t OSTreeTUI::getCommitsPerScreen() const {
+    return static_cast<size_t>(
+        std::max(1, GetScreenHeight() / CommitRender::COMMIT_WINDOW_HEIGHT));
+}
+
+ftxui::Element OSTreeTUI::renderRetentionPreview() {
+    using namespace ftxui;
+
+    if (!retentionPlan.has_value() || retentionPlanQuery != retentionQuery) {
+        return text(" Enter: preview ") | dim;
+    }
+    // approximate size, computed in the background
+    uint64_t bytes{0};
+    bool complete{true};
+    for (const auto& hash : retentionPlan->droppedCommits) {
+        auto size = ostreeRepo->GetCommitSize(hash);
+        bytes += size.value_or(0);
+        complete = complete && size.has_value();
+    }
+    const size_t dropped = retentionPlan->droppedCommits.size();
+    return text(" drops " + std::to_string(dropped) + (dropped == 1 ? " commit" : " commits") +
+                " on " + std::to_string(retentionPlan->refs.size()) + " refs, ≈ " +
+                cpplibostree::FormatByteSize(bytes) + (complete ? "" : "...") +
+                (dropped == 0 ? " " : " · Enter: apply ")) |
+           color(dropped == 0 ? Color::GrayLight : Color::Yellow);
+}
+
+void OSTreeTUI::swapRepositoryTabState(size_t index) {
+    RepositoryTab& tab = *repositoryTabs.at(index);
+    std::swap(selectedCommit, tab.selectedCommit);
+    std::swap(scrollOffset, tab.scrollOffset);
+    std::swap(visibleBranches, tab.visibleBranches);
+    std::swap(branchColorMap, tab.branchColorMap);
+    retentionPlan.reset();  // planned on the previously shown repository
+
+    activeTab = index;
+    ostreeRepo = tab.repo.get();
+    filterManager = tab.filterManager.get();
+    statsManager = tab.statsManager.get();
+    commitVerifier = tab.verifier.get();
 }
 
 void OSTreeTUI::parseVisibleCommitMap() {
+    if (visibleCommitMapRepo == ostreeRepo &&
+        visibleCommitMapState == ostreeRepo->GetStateVersion() &&
+        visibleCommitMapBranches == visibleBranches) {
+        return;
+    }
     // get filtered commits
     visibleCommitViewMap = {};
-    for (const auto& commitPair : ostreeRepo.GetCommitList()) {
-        if (visibleBranches[commitPair.second.branch]) {
-            visibleCommitViewMap.push_back(commitPair.first);
+    for (const auto& commitPair : ostreeRepo->GetCommitList()) {
+        if (visibleBranches[std::string(commitPair.second.branch)]) {
+            visibleCommitViewMap.emplace_back(commitPair.first);
         }
     }
     // sort by date
     std::sort(visibleCommitViewMap.begin(), visibleCommitViewMap.end(),
               [&](const std::string& a, const std::string& b) {
-                  return ostreeRepo.GetCommitList().at(a).timestamp >
-                         ostreeRepo.GetCommitList().at(b).timestamp;
+                  return ostreeRepo->GetCommitList().at(a).timestamp >
+                         ostreeRepo->GetCommitList().at(b).timestamp;
               });
+    visibleCommitMapRepo = ostreeRepo;
+    visibleCommitMapState = ostreeRepo->GetStateVersion();
+    visibleCommitMapBranches = visibleBranches;
 }
 
 void OSTreeTUI::adjustScrollToSelectedCommit() {
     // try to scroll it to the middle
-    int windowHeight = screen.dimy() - 4;
+    int windowHeight = GetScreenHeight() - 4;
     int scollOffsetToFitCommitToTop =
         -static_cast<int>(selectedCommit) * CommitRender::COMMIT_WINDOW_HEIGHT;
     int newScroll =
         scollOffsetToFitCommitToTop + windowHeight / 2 - CommitRender::COMMIT_WINDOW_HEIGHT;
-    // adjust if on edges
-    int min = 0;
-    int max = -windowHeight - static_cast<int>(visibleCommitViewMap.size() - 1) *
-                                  CommitRender::COMMIT_WINDOW_HEIGHT;
-    scrollOffset = std::max(newScroll, max);
-    scrollOffset = std::min(min, newScroll);
+    // adjust if on edges (the last commit may not scroll above the bottom of the window)
+    int max = 0;
+    int min = std::min(max, windowHeight - static_cast<int>(visibleCommitViewMap.size()) *
+                                               CommitRender::COMMIT_WINDOW_HEIGHT);
+    scrollOffset = std::clamp(newScroll, min, max);
+}
+
+void OSTreeTUI::recheckStaleSignatures(const cpplibostree::OSTreeRepo& repo) {
+    const std::vector<std::string> stale = repo.GetStaleSignatureCommits();
+    for (size_t begin{0}; begin < stale.size(); begin += cpplibostree::SIGNATURE_BATCH_SIZE) {
+        const size_t end = std::min(begin + cpplibostree::SIGNATURE_BATCH_SIZE, stale.size());
+        // low priority: dropped on exit, the remaining ones are checked on the next start
+        threadPool.Submit(
+            [&repo, batch = std::vector<std::string>(stale.begin() + begin, stale.begin() + end)] {
+                repo.VerifySignatures(batch);
+            },
+            cpplibostree::TaskPriority::LOW);
+    }
+}
+
+void OSTreeTUI::loadOlderHistoryIfNeeded() {
+    RepositoryTab* tab = repositoryTabs.at(activeTab).get();
+    if (tab->historyPageLoading || !ostreeRepo->HasMoreHistory()) {
+        return;
+    }
+    // pages depend on the window size, not on the size of the repository
+    const size_t commitsPerScreen = getCommitsPerScreen();
+    if (selectedCommit + 2 * commitsPerScreen < visibleCommitViewMap.size()) {
+        return;
+    }
+    const size_t pageSize = 2 * commitsPerScreen;
+
+    // headless mode has no event loop to hand the page back to
+    if (headlessHeight > 0) {
+        ostreeRepo->MergeHistoryPage(
+            ostreeRepo->LoadHistoryPage(ostreeRepo->GetHistoryPageRequest(), pageSize));
+        RefreshCommitListComponent();
+        return;
+    }
+
+    // the page belongs to this tab, even if another one is shown when it arrives
+    tab->historyPageLoading = true;
+    threadPool.Submit([this, tab, request = ostreeRepo->GetHistoryPageRequest(), pageSize] {
+        auto page = std::make_shared<cpplibostree::HistoryPage>(
+            tab->repo->LoadHistoryPage(request, pageSize));
+        screen.Post([this, tab, page] {
+            tab->historyPageLoading = false;
+            if (tab->repo->MergeHistoryPage(std::move(*page)) && tab->repo.get() == ostreeRepo) {
+                RefreshCommitListComponent();
+            }
+        });
+        screen.Post(ftxui::Event::Custom);
+    });
+}
+
+void OSTreeTUI::startLoading(RepositoryTab& tab) {
+    if (tab.daemon != nullptr) {
+        loadFromDaemon(tab);
+        return;
+    }
+    // an unlimited history is streamed: the first batch only holds the newest commits
+    tab.streaming = tab.loadOptions.depth == 0 && !tab.loadOptions.since.has_value();
+    cpplibostree::LoadOptions firstBatch = tab.loadOptions;
+    if (tab.streaming) {
+        firstBatch.depth = FIRST_BATCH_DEPTH;
+    }
+    tab.repo->SetLoadOptions(firstBatch);
+    RepositoryTab* tabPointer = &tab;
+    onFinished<std::optional<cpplibostree::RepoData>>(
+        tab.asyncRepo->Load(), [this, tabPointer](std::optional<cpplibostree::RepoData> data) {
+            RepositoryTab& tab = *tabPointer;
+            // later reloads are complete again
+            tab.repo->SetLoadOptions(tab.loadOptions);
+            tab.repo->ApplyRepoData(std::move(data.value()));
+            tab.loading = false;
+            showLoadedBranches(tab);
+            if (&tab == repositoryTabs.front().get()) {
+                firstBatchDuration = std::chrono::steady_clock::now() - loadStart;
+            }
+            streamHistory(tab);
+        });
+}
+
+void OSTreeTUI::streamHistory(RepositoryTab& tab) {
+    const bool active = tab.repo.get() == ostreeRepo;
+    if (tab.streaming && !tab.repo->HasMoreHistory()) {
+        tab.streaming = false;
+    }
+    if (!tab.streaming) {
+        loadDuration = std::chrono::steady_clock::now() - loadStart;
+        if (active) {
+            RefreshCommitListComponent();
+        }
+        return;
+    }
+
+    // headless mode has no event loop to hand the batches back to
+    if (headlessHeight > 0) {
+        while (tab.repo->HasMoreHistory()) {
+            tab.repo->MergeHistoryPage(
+                tab.repo->LoadHistoryPage(tab.repo->GetHistoryPageRequest(), STREAM_BATCH_SIZE));
+        }
+        streamHistory(tab);
+        return;
+    }
+
+    // the commit list is rebuilt a few times a second, not for every page
+    const auto now = std::chrono::steady_clock::now();
+    if (active && now - tab.refreshedAt >= STREAM_REFRESH_INTERVAL) {
+        tab.refreshedAt = now;
+        RefreshCommitListComponent();
+    }
+    // scrolling down does not load pages meanwhile
+    tab.historyPageLoading = true;
+    RepositoryTab* tabPointer = &tab;
+    onFinished<cpplibostree::HistoryPage>(
+        tab.asyncRepo->LoadHistoryPage(tab.repo->GetHistoryPageRequest(), STREAM_BATCH_SIZE),
+        [this, tabPointer](cpplibostree::HistoryPage page) {
+            tabPointer->historyPageLoading = false;
+            // a page of an older load (refreshed meanwhile) is dropped, the reload is complete
+            tabPointer->repo->MergeHistoryPage(std::move(page));
+            streamHistory(*tabPointer);
+        });
+}
+
+void OSTreeTUI::showLoadedBranches(RepositoryTab& tab) {
+    using namespace ftxui;
+
+    // set new branches as visible and define a branch color (known ones keep their state)
+    const bool active = tab.repo.get() == ostreeRepo;
+    auto& visible = active ? visibleBranches : tab.visibleBranches;
+    auto& colors = active ? branchColorMap : tab.branchColorMap;
+    for (const auto& branch : tab.repo->GetBranches()) {
+        visible.try_emplace(branch, true);
+        std::hash<std::string> nameHash{};
+        colors[branch] = Color::Palette256((nameHash(branch) + 10) % 256);
+    }
+
+    // the branch boxes are built from the loaded branches, the shown ones are replaced first
+    auto manager = std::make_unique<BranchBoxManager>(*this, *tab.repo, visible);
+    if (active) {
+        filterManager = manager.get();
+        filterContainer->DetachAllChildren();
+        filterContainer->Add(filterManager->branchBoxes);
+    }
+    tab.filterManager = std::move(manager);
+}
+
+void OSTreeTUI::loadFromDaemon(RepositoryTab& tab) {
+    tab.streaming = false;
+    // the snapshot follows the greeting of the daemon right away
+    auto promise = std::make_shared<std::promise<std::optional<cpplibostree::RepoUpdate>>>();
+    executor([promise, client = tab.daemon.get()] { promise->set_value(client->ReadUpdate()); });
+    RepositoryTab* tabPointer = &tab;
+    onFinished<std::optional<cpplibostree::RepoUpdate>>(
+        promise->get_future(),
+        [this, tabPointer](std::optional<cpplibostree::RepoUpdate> update) {
+            RepositoryTab& tab = *tabPointer;
+            if (!update.has_value()) {
+                tab.daemon.reset();
+                startLoading(tab);
+                return;
+            }
+            tab.repo->ApplyRepoData(std::move(update->data));
+            tab.loading = false;
+            showLoadedBranches(tab);
+            if (&tab == repositoryTabs.front().get()) {
+                firstBatchDuration = std::chrono::steady_clock::now() - loadStart;
+            }
+            streamHistory(tab);
+            // headless mode only renders the snapshot
+            if (headlessHeight == 0) {
+                listenToDaemon(tab);
+            }
+        });
+}
+
+void OSTreeTUI::listenToDaemon(RepositoryTab& tab) {
+    tab.attached = true;
+    RepositoryTab* tabPointer = &tab;
+    tab.daemonListener = std::thread([this, tabPointer, client = tab.daemon.get()] {
+        while (auto update = client->ReadUpdate()) {
+            auto shared = std::make_shared<cpplibostree::RepoUpdate>(std::move(update.value()));
+            screen.Post([this, tabPointer, shared] {
+                RepositoryTab& tab = *tabPointer;
+                if (shared->snapshot) {
+                    tab.repo->ApplyRepoData(std::move(shared->data));
+                } else {
+                    tab.repo->ApplyRepoDelta(std::move(shared->data), shared->removedCommits);
+                }
+                showReloadedRepository(tab, false);
+            });
+            screen.PostEvent(ftxui::Event::Custom);
+        }
+        // the daemon stopped (or got detached): refreshes are loaded locally again
+        screen.Post([tabPointer] { tabPointer->attached = false; });
+    });
+}
+
+void OSTreeTUI::detachDaemons() {
+    for (const auto& tab : repositoryTabs) {
+        if (tab->daemon != nullptr) {
+            tab->daemon->Close();
+        }
+        if (tab->daemonListener.joinable()) {
+            tab->daemonListener.join();
+        }
+    }
+}
+
+bool OSTreeTUI::refreshRepositoryTab(RepositoryTab& tab, bool announce) {
+    // the running load is not replaced
+    if (tab.loading) {
+        return false;
+    }
+    // the daemon sends the changes (if any) to all attached TUIs
+    if (tab.attached && tab.daemon->RequestRefresh()) {
+        return true;
+    }
+    // a newer refresh replaces a running one
+    tab.refreshCancellation.Cancel();
+    tab.refreshCancellation = {};
+    cpplibostree::AsyncOptions options;
+    options.cancellation = tab.refreshCancellation;
+    RepositoryTab* tabPointer = &tab;
+    onFinished<std::optional<cpplibostree::RepoData>>(
+        tab.asyncRepo->Load(options),
+        [this, tabPointer, announce](std::optional<cpplibostree::RepoData> data) {
+            // cancelled by a newer refresh
+            if (!data.has_value()) {
+                return;
+            }
+            tabPointer->repo->ApplyRepoData(std::move(data.value()));
+            showReloadedRepository(*tabPointer, announce);
+        });
+    return true;
+}
+
+void OSTreeTUI::showReloadedRepository(RepositoryTab& tab, bool announce) {
+    // the orphan lane might have been hidden during the reload
+    const bool active = tab.repo.get() == ostreeRepo;
+    const std::string lane(cpplibostree::ORPHANED_BRANCH);
+    if (!(active ? visibleBranches : tab.visibleBranches)[lane] &&
+        !tab.repo->GetOrphanedCommits().empty()) {
+        tab.repo->SetOrphanedCommits({});
+    }
+    // added or deleted refs (e.g. by a daemon delta): the branch boxes are rebuilt
+    std::vector<std::string> refs = tab.repo->GetBranches();
+    std::sort(refs.begin(), refs.end());
+    if (tab.filterManager == nullptr || refs != tab.filterManager->GetRefs()) {
+        showLoadedBranches(tab);
+    }
+    if (headlessHeight == 0) {
+        recheckStaleSignatures(*tab.repo);
+    }
+    tab.statsManager->Invalidate();
+    if (active) {
+        RefreshCommitListComponent();
+        if (announce) {
+            notificationText = " Refreshed Repository Data ";
+        }
+    }
+}
+
+void OSTreeTUI::publishControlSnapshots() {
+    if (controlServer == nullptr) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    for (size_t i{0}; i < repositoryTabs.size(); i++) {
+        RepositoryTab& tab = *repositoryTabs[i];
+        // a streamed history changes with every batch
+        if (tab.loading || tab.publishedState == tab.repo->GetStateVersion() ||
+            (tab.streaming && now - tab.publishedAt < CONTROL_SNAPSHOT_INTERVAL)) {
+            continue;
+        }
+        tab.publishedState = tab.repo->GetStateVersion();
+        tab.publishedAt = now;
+        controlServer->Publish(i, cpplibostree::ModelSnapshot::Capture(*tab.repo));
+    }
+}
+
+void OSTreeTUI::runControlAction(const cpplibostree::ControlAction& action,
+                                 const std::shared_ptr<std::promise<bool>>& done) {
+    RepositoryTab* tab = repositoryTabs.at(action.repo).get();
+    if (action.method == "refresh") {
+        done->set_value(refreshRepositoryTab(*tab, true));
+        return;
+    }
+    const std::string shortHash = action.hash.substr(0, 8);
+    std::future<bool> result;
+    std::string message;
+    if (action.method == "promote") {
+        result = tab->asyncRepo->PromoteCommit(action.hash, action.ref, action.metadata,
+                                               action.subject, true);
+        message = "Promoted commit " + shortHash + " to branch " + action.ref;
+    } else {
+        // the commit may be gone since the snapshot was taken
+        auto commit = tab->repo->GetCommitList().find(action.hash);
+        if (commit == tab->repo->GetCommitList().end()) {
+            done->set_value(false);
+            return;
+        }
+        result = tab->asyncRepo->RemoveCommit(commit->second);
+        message = "Dropped commit " + shortHash;
+    }
+    // the selection is kept, the action was not started from the UI
+    onFinished<bool>(std::move(result), [this, tab, done, message](bool success) {
+        if (success) {
+            refreshRepositoryTab(*tab, false);
+            notificationText = " " + message + " (control socket) ";
+        }
+        done->set_value(success);
+    });
+}
+
+void OSTreeTUI::handleFinishedOperations() {
+    // handlers may start new operations meanwhile
+    std::vector<std::function<bool()>> operations;
+    operations.swap(pendingOperations);
+    std::erase_if(operations, [](const std::function<bool()>& poll) { return poll(); });
+    pendingOperations.insert(pendingOperations.end(), std::make_move_iterator(operations.begin()),
+                             std::make_move_iterator(operations.end()));
 }
 
 // SETTER & non-const GETTER
@@ -334,9 +1282,13 @@ ftxui::ScreenInteractive& OSTreeTUI::GetScreen() {
     return screen;
 }
 
+int OSTreeTUI::GetScreenHeight() const {
+    return headlessHeight > 0 ? headlessHeight : screen.dimy();
+}
+
 // GETTER
 const cpplibostree::OSTreeRepo& OSTreeTUI::GetOstreeRepo() const {
-    return ostreeRepo;
+    return *ostreeRepo;
 }
 
 const size_t& OSTreeTUI::GetSelectedCommit() const {
@@ -376,6 +1328,64 @@ const std::string& OSTreeTUI::GetModeHash() const {
 }
 
 // STATIC
+std::optional<std::vector<ScriptedEvent>> OSTreeTUI::ParseEventScript(
+    const std::vector<std::string>& tokens) {
+    using namespace ftxui;
+
+    const std::unordered_map<std::string, Event> keyEvents{
+        {"up", Event::ArrowUp},         {"down", Event::ArrowDown},
+        {"left", Event::ArrowLeft},     {"right", Event::ArrowRight},
+        {"enter", Event::Return},       {"escape", Event::Escape},
+        {"tab", Event::Tab},            {"backspace", Event::Backspace},
+        {"pageup", Event::PageUp},      {"pagedown", Event::PageDown},
+        {"home", Event::Home},          {"end", Event::End},
+    };
+    const std::unordered_map<std::string, std::pair<Mouse::Button, Mouse::Motion>> mouseEvents{
+        {"press", {Mouse::Left, Mouse::Pressed}},
+        {"drag", {Mouse::Left, Mouse::Moved}},  // moved, with the left button held
+        {"release", {Mouse::Left, Mouse::Released}},
+        {"wheelup", {Mouse::WheelUp, Mouse::Pressed}},
+        {"wheeldown", {Mouse::WheelDown, Mouse::Pressed}},
+    };
+
+    std::vector<ScriptedEvent> events;
+    for (const auto& token : tokens) {
+        // named keys
+        if (keyEvents.contains(token)) {
+            events.push_back({token, keyEvents.at(token)});
+            continue;
+        }
+        // alt+<letter>
+        if (token.size() == 5 && token.starts_with("alt+")) {
+            events.push_back({token, Event::Special("\x1b" + token.substr(4))});
+            continue;
+        }
+        // single characters
+        if (token.size() == 1) {
+            events.push_back({token, Event::Character(token)});
+            continue;
+        }
+        // mouse: <action>:<x>:<y>
+        const size_t first = token.find(':');
+        const size_t second = token.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos ||
+            !mouseEvents.contains(token.substr(0, first))) {
+            return std::nullopt;
+        }
+        Mouse mouse;
+        mouse.button = mouseEvents.at(token.substr(0, first)).first;
+        mouse.motion = mouseEvents.at(token.substr(0, first)).second;
+        try {
+            mouse.x = std::stoi(token.substr(first + 1, second - first - 1));
+            mouse.y = std::stoi(token.substr(second + 1));
+        } catch (const std::exception&) {
+            return std::nullopt;
+        }
+        events.push_back({token, Event::Mouse("", mouse)});
+    }
+    return events;
+}
+
 int OSTreeTUI::showHelp(const std::string& caller, const std::string& errorMessage) {
     using namespace ftxui;
 
@@ -383,8 +1393,31 @@ int OSTreeTUI::showHelp(const std::string& caller, const std::string& errorMessa
     std::vector<std::vector<std::string>> command_options{
         // option, arguments, meaning
         {"-h, --help", "", "Show help options. The REPOSITORY_PATH can be omitted"},
-        {"-r, --refs", "REF [REF...]",
-         "Specify a list of visible refs at startup if not specified, show all refs"},
+        {"-r, --refs", "GLOB [GLOB...]",
+         "Only load refs matching any glob, like os/*/stable (other refs are never read)"},
+        {"--refs-regex", "REGEX [REGEX...]", "Only load refs matching any regular expression"},
+        {"--dump", "json|ndjson",
+         "Write all commits of the first repository to stdout (without the TUI) and exit"},
+        {"--bench-commits", "",
+         "Time loading all commits via mmap vs. libostree (cold & warm page cache) and exit"},
+        {"--daemon", "",
+         "Keep the first repository loaded & serve it to the TUIs of this user (until stopped)"},
+        {"--no-daemon", "", "Load the repositories directly, even if a daemon serves them"},
+        {"--control", "SOCKET",
+         "Serve JSON-RPC queries & actions (promote, drop, refresh) on a Unix socket"},
+        {"--depth", "N", "Only load the newest N commits per ref (older ones load on scrolling)"},
+        {"--since", "YYYY-MM-DD",
+         "Only load commits since the given date (older ones load on scrolling)"},
+        {"--retain", "N|YYYY-MM-DD [GLOB...]",
+         "Preview dropping all but the newest N commits, or the ones before a date (on matching "
+         "refs) and exit"},
+        {"--apply", "", "Prune the commits dropped by --retain, instead of only previewing them"},
+        {"--metrics", "FILE",
+         "Write repository gauges of the first repository as a Prometheus textfile and exit"},
+        {"--render", "WIDTHxHEIGHT",
+         "Render the UI once as text to stdout & print timings to stderr (no TTY needed)"},
+        {"--events", "EVENT [EVENT...]",
+         "Events to apply in --render mode: up, down, pagedown, alt+g, a, enter, press:X:Y, ..."},
     };
 
     Elements options{text("Options:")};
@@ -399,7 +1432,7 @@ int OSTreeTUI::showHelp(const std::string& caller, const std::string& errorMessa
     auto helpPage = vbox(
         {errorMessage.empty() ? filler() : (text(errorMessage) | bold | color(Color::Red) | flex),
          hbox({text("Usage: "), text(caller) | color(Color::GrayLight),
-               text(" REPOSITORY_PATH") | color(Color::Yellow),
+               text(" REPOSITORY_PATH [REPOSITORY_PATH...]") | color(Color::Yellow),
                text(" [OPTION...]") | color(Color::Yellow)}),
          text(""),
          hbox({
@@ -5,12 +5,21 @@
 
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include "ftxui/component/component.hpp"  // for Renderer, ResizableSplitBottom, ResizableSplitLeft, ResizableSplitRight, ResizableSplitTop
 #include "ftxui/component/component_base.hpp"      // for ComponentBase
+#include "ftxui/component/event.hpp"               // for Event
 #include "ftxui/component/screen_interactive.hpp"  // for ScreenInteractive
 #include "ftxui/dom/elements.hpp"                  // for Element, operator|, text, center, border
 
@@ -19,21 +28,72 @@
 #include "manager.hpp"
 #include "trashBin.hpp"
 
+#include "../util/asyncRepo.hpp"
+#include "../util/commitPrefetcher.hpp"
+#include "../util/commitVerifier.hpp"
+#include "../util/controlServer.hpp"
 #include "../util/cpplibostree.hpp"
+#include "../util/repoDaemon.hpp"
+#include "../util/retention.hpp"
+#include "../util/threadPool.hpp"
 
 enum ViewMode : uint8_t { DEFAULT, COMMIT_DRAGGING, COMMIT_PROMOTION, COMMIT_DROP };
 
+/// commits per branch in the first batch of a streamed load (more than fit on any screen)
+constexpr size_t FIRST_BATCH_DEPTH{64};
+/// commits per branch in every further batch of a streamed load
+constexpr size_t STREAM_BATCH_SIZE{512};
+/// minimum interval between two rebuilds of the commit list, while a history streams in
+constexpr std::chrono::milliseconds STREAM_REFRESH_INTERVAL{250};
+/// minimum interval between two snapshots for the control socket, while a history streams in
+constexpr std::chrono::milliseconds CONTROL_SNAPSHOT_INTERVAL{1000};
+
+/// Event for the headless mode, with the name it was scripted with
+struct ScriptedEvent {
+    std::string name;
+    ftxui::Event event;
+};
+
+/// Model & view state of one opened repository, kept in memory while another tab is shown
+struct RepositoryTab {
+    std::unique_ptr<cpplibostree::OSTreeRepo> repo;
+    std::unique_ptr<BranchBoxManager> filterManager;
+    std::unique_ptr<StatisticsManager> statsManager;
+    std::unique_ptr<cpplibostree::CommitVerifier> verifier;
+    std::unique_ptr<cpplibostree::AsyncRepo> asyncRepo;  // loads & writes off the UI thread
+    cpplibostree::CancellationToken refreshCancellation;  // of the running refresh, if any
+    cpplibostree::LoadOptions loadOptions;                // limits of the complete load
+    std::unique_ptr<cpplibostree::DaemonClient> daemon;   // index daemon serving the repository
+    std::thread daemonListener;                           // receives the updates of the daemon
+    bool attached{false};                                 // updates still arrive from the daemon
+    bool loading{true};                                   // first batch of commits not shown yet
+    bool streaming{false};                                // rest of the history still arriving
+    bool historyPageLoading{false};                       // older history is being loaded
+    size_t publishedState{0};                             // state of the last control snapshot
+    std::chrono::steady_clock::time_point publishedAt;    // time of the last control snapshot
+    std::chrono::steady_clock::time_point refreshedAt;    // last commit list rebuild (streaming)
+    // view state, swapped with the OSTreeTUI while the tab is active
+    size_t selectedCommit{0};
+    int scrollOffset{0};
+    std::unordered_map<std::string, bool> visibleBranches;
+    std::unordered_map<std::string, ftxui::Color> branchColorMap;
+};
+
 class OSTreeTUI {
    public:
     /**
      * @brief Constructs, builds and assembles all components of the OSTreeTUI.
      *
-     * @param repo Path to the OSTree repository directory.
-     * @param startupBranches Optional list of branches to pre-select at startup (providing nothing
-     * will display all branches).
+     * @param repos Paths to the OSTree repository directories, each one is opened in its own tab
+     * (all of them are loaded in parallel, in the background: the UI opens right away).
+     * @param loadOptions Optional limits for the loaded refs (others are never walked) & the
+     * initially loaded history (older commits are loaded on demand, when scrolling down).
+     * @param useDaemon Attach to the index daemon of a repository, if one runs (only without
+     * limits, see cpplibostree::RepoDaemon).
      */
-    explicit OSTreeTUI(const std::string& repo,
-                       const std::vector<std::string>& startupBranches = {});
+    explicit OSTreeTUI(const std::vector<std::string>& repos,
+                       const cpplibostree::LoadOptions& loadOptions = {},
+                       bool useDaemon = true);
 
     /**
      * @brief Runs the OSTreeTUI (starts the ftxui screen loop).
@@ -42,13 +102,36 @@ class OSTreeTUI {
      */
     int Run();
 
+    /**
+     * @brief Runs the OSTreeTUI without a TTY: Renders the complete UI for a fixed terminal
+     * size, applies the scripted events (each followed by a new frame) and prints the last
+     * frame as plain text to stdout. Load, render & event timings are printed to stderr.
+     *
+     * @param width Terminal width.
+     * @param height Terminal height.
+     * @param events Scripted events (see ParseEventScript()).
+     * @return Exit Code
+     */
+    int RunHeadless(int width, int height, const std::vector<ScriptedEvent>& events = {});
+
+    /**
+     * @brief Serve the opened repositories on a JSON-RPC control socket while the TUI runs (see
+     * cpplibostree::ControlServer). Promotions, drops & refreshes requested on the socket are
+     * run like the ones of the UI.
+     *
+     * @param socketPath Path of the Unix socket.
+     * @return false, if the socket could not be created
+     */
+    bool StartControlServer(const std::string& socketPath);
+
     /// @brief OSTreeTUI Refresh Level 3: Refreshes the commit components.
     void RefreshCommitComponents();
 
     /// @brief OSTreeTUI Refresh Level 2: Refreshes the commit list component & upper levels.
     void RefreshCommitListComponent();
 
-    /// @brief OSTreeTUI Refresh Level 1: Refreshes complete repository & upper levels.
+    /// @brief OSTreeTUI Refresh Level 1: Refreshes complete repository & upper levels (loaded in
+    /// the background, the UI keeps running meanwhile).
     bool RefreshOSTreeRepository();
 
     /**
@@ -67,14 +150,15 @@ class OSTreeTUI {
                      bool targetBranch = true);
 
     /**
-     * @brief Promotes a commit, by passing it to the cpplibostree and refreshing the UI.
+     * @brief Promotes a commit in the background, by passing it to the cpplibostree, and
+     * refreshes the UI once it is done.
      *
      * @param hash Hash of commit to be promoted.
      * @param targetBranch Branch to promote the commit to.
      * @param metadataStrings Optional additional metadata-strings to be set.
      * @param newSubject New commit subject.
      * @param keepMetadata Keep metadata of old commit.
-     * @return promotion success
+     * @return true, if the promotion got started
      */
     bool PromoteCommit(const std::string& hash,
                        const std::string& targetBranch,
@@ -83,20 +167,215 @@ class OSTreeTUI {
                        bool keepMetadata = true);
 
     /**
-     * @brief Remove a commit from the OSTree repo and refresh the UI.
+     * @brief Remove a commit from the OSTree repo in the background and refresh the UI once it
+     * is done.
      *
      * @param commit Commit to remove.
-     * @return True on success.
+     * @return True, if the removal got started.
      */
     bool RemoveCommit(const cpplibostree::Commit& commit);
 
+    /**
+     * @brief Computes the sizes of commits in the background (if not known yet) and redraws
+     * the screen, once they are available.
+     *
+     * @param hashes Hashes of the commits.
+     */
+    void RequestCommitSizes(const std::vector<std::string>& hashes);
+
+    /**
+     * @brief Re-hash all objects of a commit in the background (see CommitVerifier). The
+     * progress is shown in the info view of the commit. In headless mode, this blocks until
+     * the verification is done.
+     *
+     * @param hash Hash of the commit.
+     * @return true, if the verification was started (only one runs per tab at a time).
+     */
+    bool VerifyCommit(const std::string& hash);
+
+    /**
+     * @brief Show another repository tab. The repository is not reloaded, its commits and view
+     * state (selection, scrolling, visible branches) stay in memory while it is hidden.
+     *
+     * @param index Index of the tab (order of the repository paths).
+     * @return true, if the tab changed.
+     */
+    bool SwitchRepositoryTab(size_t index);
+
+    /**
+     * @brief Select a commit of the active tab & scroll to it (see the "go to" prompt). The
+     * query is resolved in the following order:
+     * - ref name: head commit of the ref
+     * - date (YYYY-MM-DD): newest commit on, or before that day
+     * - hex hash prefix: the only commit with this prefix
+     * Branches of commits, that are hidden by the filter, are made visible.
+     *
+     * @param query Ref, date, or (abbreviated) commit hash.
+     * @return true, if a commit was found.
+     */
+    bool GoTo(const std::string& query);
+
+    /**
+     * @brief Plan a retention policy on the active tab (see the retention prompt &
+     * cpplibostree::RetentionPolicy::Parse()). The dropped commits are previewed in the
+     * prompt, until the plan is applied.
+     *
+     * @param policy Words of the policy, separated by spaces (like "5 stable").
+     * @return true, if the policy is valid.
+     */
+    bool PlanRetention(const std::string& policy);
+
+    /**
+     * @brief Prune all commits dropped by the planned retention policy in a single pass (in the
+     * background) and refresh the repository once done.
+     *
+     * @return true if the prune pass got started.
+     */
+    bool ApplyRetention();
+
+    /**
+     * @brief Show, or hide the commits, that no ref reaches, in their own lane (see
+     * cpplibostree::ORPHANED_BRANCH). They are found by the statistics scan, which is started
+     * if needed (in headless mode, this blocks until the scan is done).
+     *
+     * @return true, if the lane got shown, or hidden.
+     */
+    bool ToggleOrphanedCommits();
+
+    /**
+     * @brief Prune all orphaned commits (and all other unreachable objects) in a single pass
+     * in the background and refresh the UI once it is done.
+     *
+     * @return true, if the pruning got started.
+     */
+    bool PruneOrphanedCommits();
+
    private:
-    /// @brief Calculates all visible commits from an OSTreeRepo and a list of branches.
+    /**
+     * @brief Exchange the view state of the OSTreeTUI with the one stored in a tab (swaps the
+     * state of the tab in, or back out) and show the model of this tab.
+     *
+     * @param index Index of the tab.
+     */
+    void swapRepositoryTabState(size_t index);
+
+    /// @brief Calculates all visible commits from an OSTreeRepo and a list of branches (only if
+    /// the repository, its state, or the visible branches changed since the last call).
     void parseVisibleCommitMap();
 
     /// @brief Adjust scroll offset to fit the selected commit.
     void adjustScrollToSelectedCommit();
 
+    /**
+     * @brief Select a commit of the active tab, shows its branch if needed.
+     *
+     * @param hash Hash of the commit.
+     * @return true, if the commit is part of the commit list.
+     */
+    bool selectCommitByHash(std::string_view hash);
+
+    /// @brief Preview of the planned retention policy, shown behind the retention prompt.
+    [[nodiscard]] ftxui::Element renderRetentionPreview();
+
+    /// @brief Amount of commits, that fit on the screen at once.
+    [[nodiscard]] size_t getCommitsPerScreen() const;
+
+    /**
+     * @brief Verify the signatures of a repository, whose cache entries are stale (keyrings
+     * changed), in batches at low priority on the thread pool.
+     *
+     * @param repo Repository, has to outlive the pool.
+     */
+    void recheckStaleSignatures(const cpplibostree::OSTreeRepo& repo);
+
+    /// @brief Load the next page of older history, if the selection is close to the last
+    /// loaded commit (in the background, unless in headless mode).
+    void loadOlderHistoryIfNeeded();
+
+    /**
+     * @brief Load a repository for the first time, in the background: The newest commits of
+     * every branch are shown first, an unlimited history is then streamed in batches (see
+     * streamHistory()).
+     *
+     * @param tab Tab of the repository.
+     */
+    void startLoading(RepositoryTab& tab);
+
+    /// @brief Load the next batch of a streamed history & continue with the following one, once
+    /// it got merged (all batches right away in headless mode).
+    void streamHistory(RepositoryTab& tab);
+
+    /// @brief Show all branches of a tab, that got loaded for the first time.
+    void showLoadedBranches(RepositoryTab& tab);
+
+    /**
+     * @brief Take over the snapshot of the index daemon of a tab, instead of loading the
+     * repository (which is done, if the daemon went away meanwhile). Later updates are received
+     * on a listener thread (not in headless mode).
+     *
+     * @param tab Tab of the repository, attached to a daemon.
+     */
+    void loadFromDaemon(RepositoryTab& tab);
+
+    /// @brief Hand every update of the daemon of a tab to the UI thread, until it is gone.
+    void listenToDaemon(RepositoryTab& tab);
+
+    /// @brief Disconnect from all daemons & join the listener threads.
+    void detachDaemons();
+
+    /**
+     * @brief Reload a repository in the background, replaces a running reload of it. Tabs
+     * attached to a daemon ask it for the changes instead.
+     *
+     * @param tab Tab of the repository.
+     * @param announce Show a notification, once the repository got reloaded.
+     * @return false if the tab is still loading its first batch (not refreshed)
+     */
+    bool refreshRepositoryTab(RepositoryTab& tab, bool announce);
+
+    /**
+     * @brief Show the reloaded (or updated) state of a repository.
+     *
+     * @param tab Tab of the repository.
+     * @param announce Show a notification.
+     */
+    void showReloadedRepository(RepositoryTab& tab, bool announce);
+
+    /// @brief Hand a snapshot of every changed repository to the control server (if any).
+    void publishControlSnapshots();
+
+    /**
+     * @brief Run an action requested on the control socket (on the UI thread).
+     *
+     * @param action Validated action, see cpplibostree::ControlServer.
+     * @param done Set to the success, once the action is done (refreshes: once started).
+     */
+    void runControlAction(const cpplibostree::ControlAction& action,
+                          const std::shared_ptr<std::promise<bool>>& done);
+
+    /**
+     * @brief Hand the result of an asynchronous operation to `onDone` on the UI thread, once it
+     * is ready (right away in headless mode, which has no event loop).
+     */
+    template <typename Result>
+    void onFinished(std::future<Result> future, std::function<void(Result)> onDone) {
+        if (headlessHeight > 0) {
+            onDone(future.get());
+            return;
+        }
+        auto shared = std::make_shared<std::future<Result>>(std::move(future));
+        pendingOperations.push_back([shared, onDone = std::move(onDone)] {
+            if (shared->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return false;
+            }
+            onDone(shared->get());
+            return true;
+        });
+    }
+
+    /// @brief Handle all finished asynchronous operations (see onFinished()).
+    void handleFinishedOperations();
+
    public:
     // SETTER
     void SetModeBranch(const std::string& modeBranch);
@@ -107,6 +386,9 @@ class OSTreeTUI {
     [[nodiscard]] std::vector<std::string>& GetColumnToBranchMap();
     [[nodiscard]] ftxui::ScreenInteractive& GetScreen();
 
+    /// @brief Height of the (interactive, or headless) screen.
+    [[nodiscard]] int GetScreenHeight() const;
+
     // GETTER
     [[nodiscard]] const cpplibostree::OSTreeRepo& GetOstreeRepo() const;
     [[nodiscard]] const size_t& GetSelectedCommit() const;
@@ -120,19 +402,39 @@ class OSTreeTUI {
     [[nodiscard]] const std::string& GetModeHash() const;
 
    private:
-    // model
-    cpplibostree::OSTreeRepo ostreeRepo;
+    // model: one tab per repository
+    std::vector<std::unique_ptr<RepositoryTab>> repositoryTabs;
+    std::vector<std::string> repositoryTabNames;
+    size_t activeTab{0};
+    int repositoryTabIndex{0};  // selected entry of the repository tab bar
+    cpplibostree::OSTreeRepo* ostreeRepo{nullptr};  // repository of the active tab
 
     // backend states
-    size_t selectedCommit;
+    size_t selectedCommit{0};
     std::unordered_map<std::string, bool> visibleBranches;  // map branch -> visibe
     std::vector<std::string> columnToBranchMap;             // map branch -> column in commit-tree
     std::vector<std::string> visibleCommitViewMap;          // map view-index -> commit-hash
+    // visibleCommitViewMap was calculated from this repository, state & visible branches
+    const cpplibostree::OSTreeRepo* visibleCommitMapRepo{nullptr};
+    size_t visibleCommitMapState{0};
+    std::unordered_map<std::string, bool> visibleCommitMapBranches;
     std::unordered_map<std::string, ftxui::Color> branchColorMap;  // map branch -> color
     std::string notificationText;                                  // footer notification
+    std::mutex pendingCommitSizesMutex;
+    std::unordered_set<std::string> pendingCommitSizes;  // commit sizes being computed
+    // asynchronous operations (loads, refreshes, promote, drop, orphan pruning & retention),
+    // polled on the UI thread, return true once handled
+    std::vector<std::function<bool()>> pendingOperations;
+    cpplibostree::Executor executor;  // runs operations on the pool, reports back to the UI
 
     // view states
     int scrollOffset{0};
+    bool goToPromptShown{false};
+    std::string goToQuery;  // text of the "go to" prompt
+    bool retentionPromptShown{false};
+    std::string retentionQuery;                                // text of the retention prompt
+    std::optional<cpplibostree::RetentionPlan> retentionPlan;  // planned policy, if any
+    std::string retentionPlanQuery;                            // policy of the retentionPlan
     ViewMode viewMode = ViewMode::DEFAULT;
     std::string modeHash;
     std::string modeBranch;
@@ -140,10 +442,20 @@ class OSTreeTUI {
     // view constants
     int logSize{45};
     int footerSize{1};
+    int headlessHeight{0};  // screen height in headless mode (0 = interactive)
+
+    // performance instrumentation
+    std::chrono::steady_clock::time_point loadStart;
+    std::chrono::steady_clock::duration firstBatchDuration{};  // until the first tab is usable
+    std::chrono::steady_clock::duration loadDuration{};        // until all tabs are complete
+    std::chrono::steady_clock::duration commitRenderDuration{};
 
     // components
     Footer footer;
-    std::unique_ptr<BranchBoxManager> filterManager{nullptr};
+    BranchBoxManager* filterManager{nullptr};               // of the active tab
+    StatisticsManager* statsManager{nullptr};               // of the active tab
+    cpplibostree::CommitVerifier* commitVerifier{nullptr};  // of the active tab
+    std::unique_ptr<cpplibostree::CommitPrefetcher> prefetcher{nullptr};
     std::unique_ptr<Manager> manager{nullptr};
     ftxui::ScreenInteractive screen;
     ftxui::Component mainContainer;
@@ -153,11 +465,32 @@ class OSTreeTUI {
     ftxui::Component commitListComponent;
     ftxui::Component infoView;
     ftxui::Component filterView;
+    ftxui::Component filterContainer;  // holds the branch boxes of the active tab
+    ftxui::Component repositoryTabBar;
+    ftxui::Component statsView;
     ftxui::Component managerRenderer;
+    ftxui::Component goToInput;
+    ftxui::Component retentionInput;
     ftxui::Component FooterRenderer;
     ftxui::Component container;
 
+    // background workers, shared by all tabs (declared last: joined before the state they
+    // access is destroyed)
+    cpplibostree::ThreadPool threadPool;
+    // JSON-RPC endpoint, if enabled (declared after the pool: stopped before the pool is joined)
+    std::unique_ptr<cpplibostree::ControlServer> controlServer;
+
    public:
+    /**
+     * @brief Parse a list of event names for RunHeadless(), like "down", "alt+p",
+     * "press:12:5", or "wheeldown:12:5".
+     *
+     * @param tokens Event names.
+     * @return Events, or nothing if a name is invalid.
+     */
+    static std::optional<std::vector<ScriptedEvent>> ParseEventScript(
+        const std::vector<std::string>& tokens);
+
     /**
      * @brief Print a help page including usage, options, etc.
      *
@@ -21,6 +21,8 @@
 #include "ftxui/screen/color.hpp"  // for Color
 
 #include "../util/cpplibostree.hpp"
+#include "../util/reachability.hpp"
+#include "../util/repoStatistics.hpp"
 
 #include "OSTreeTUI.hpp"
 
@@ -84,12 +86,22 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
           commit(ostreetui.GetOstreeRepo().GetCommitList().at(hash)),
           newVersion(this->commit.version) {
         inner = Renderer([&] {
+            const auto& current = ostreetui.GetOstreeRepo().GetCommitList().at(hash);
+            const auto timestamp = std::chrono::time_point_cast<std::chrono::seconds>(
+                current.timestamp);
+            // orphaned commits show their size, to find the ones worth pruning
+            if (current.branch == cpplibostree::ORPHANED_BRANCH) {
+                auto size = ostreetui.GetOstreeRepo().GetCommitSize(hash);
+                return vbox({
+                    text(std::string(current.subject)),
+                    text(std::format("{:%Y-%m-%d %R} · {}", timestamp,
+                                     size.has_value() ? cpplibostree::FormatByteSize(size.value())
+                                                      : "...")),
+                });
+            }
             return vbox({
-                text(ostreetui.GetOstreeRepo().GetCommitList().at(hash).subject),
-                text(
-                    std::format("{:%Y-%m-%d %T %Ez}",
-                                std::chrono::time_point_cast<std::chrono::seconds>(
-                                    ostreetui.GetOstreeRepo().GetCommitList().at(hash).timestamp))),
+                text(std::string(current.subject)),
+                text(std::format("{:%Y-%m-%d %T %Ez}", timestamp)),
             });
         });
         simpleCommit = inner;
@@ -134,17 +146,13 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
         }
     }
 
-    void startDeletionWindow(bool isMostRecentCommit) {
+    void startDeletionWindow(const Component& deletionView) {
         left() = std::max(left(), -2);
         width() = DELETION_WINDOW_WIDTH;
         height() = DELETION_WINDOW_HEIGHT;
         // change inner to deletion layout
         DetachAllChildren();
-        if (isMostRecentCommit) {
-            Add(deletionViewHead);
-        } else {
-            Add(deletionViewBody);
-        }
+        Add(deletionView);
         TakeFocus();
     }
 
@@ -164,11 +172,104 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
         resetWindow();
     }
 
+    void executeOrphanPrune() {
+        // prune all orphans on the ostree repo
+        ostreetui.PruneOrphanedCommits();
+        resetWindow();
+    }
+
     void cancelSpecialWindow() {
         ostreetui.SetViewMode(ViewMode::DEFAULT);
         resetWindow();
     }
 
+    /// Relation of the promoted commit to the target branch (already contained, or diverged).
+    Element renderPromotionTarget() {
+        const auto& index = ostreetui.GetOstreeRepo().GetReachabilityIndex();
+        const auto id = index.GetId(hash);
+        const auto headId = index.GetRefHeadId(ostreetui.GetModeBranch());
+        if (!id.has_value() || !headId.has_value()) {
+            return text(" │") | bold;
+        }
+        if (index.IsAncestor(id.value(), headId.value())) {
+            return text(" ⚠ branch already contains this commit") | color(Color::Yellow) | bold;
+        }
+        const auto mergeBase = index.GetMergeBase(id.value(), headId.value());
+        return text(mergeBase.has_value()
+                        ? " │ diverged at " + index.GetHash(mergeBase.value()).substr(0, 8)
+                        : " │ no common history") |
+               dim;
+    }
+
+    /// Summary of all commits, that become unreachable by dropping this commit.
+    Element renderDropPreview(bool listCommits) {
+        const auto& repo = ostreetui.GetOstreeRepo();
+        const std::vector<std::string> lost =
+            repo.GetReachabilityIndex().PreviewDrop(hash, std::string(commit.branch));
+
+        Elements elements;
+        if (listCommits) {
+            // the dropped commit itself is rendered by the caller
+            for (size_t i{1}; i < lost.size() && i <= DELETION_PREVIEW_COMMITS; i++) {
+                const std::string subject(repo.GetCommitList().at(lost.at(i)).subject);
+                elements.push_back(text(" ✖ " + lost.at(i).substr(0, 8) + " " + subject) |
+                                   color(Color::Red));
+            }
+            if (lost.size() > DELETION_PREVIEW_COMMITS + 1) {
+                elements.push_back(
+                    text(" ✖ ... " + std::to_string(lost.size() - DELETION_PREVIEW_COMMITS - 1) +
+                         " more") |
+                    color(Color::Red));
+            }
+            if (repo.GetHistoryFrontiers().contains(std::string(commit.branch))) {
+                elements.push_back(text(" ✖ ... + older history (not loaded)") | color(Color::Red));
+            }
+        }
+
+        // approximate size, computed in the background
+        uint64_t bytes{0};
+        bool complete{true};
+        for (const auto& lostHash : lost) {
+            auto size = repo.GetCommitSize(lostHash);
+            bytes += size.value_or(0);
+            complete = complete && size.has_value();
+        }
+        if (!complete) {
+            ostreetui.RequestCommitSizes(lost);
+        }
+        elements.push_back(text(" " + std::to_string(lost.size()) +
+                                (lost.size() == 1 ? " commit" : " commits") + " unreachable, ≈ " +
+                                cpplibostree::FormatByteSize(bytes) + (complete ? "" : "...")) |
+                           dim);
+        return vbox(std::move(elements));
+    }
+
+    /// Summary of all loaded orphaned commits, that get pruned together.
+    Element renderOrphanPreview() {
+        const auto& repo = ostreetui.GetOstreeRepo();
+        const auto& orphans = repo.GetOrphanedCommits();
+
+        // approximate size, computed in the background
+        uint64_t bytes{0};
+        bool complete{true};
+        for (const auto& orphan : orphans) {
+            auto size = repo.GetCommitSize(orphan);
+            bytes += size.value_or(0);
+            complete = complete && size.has_value();
+        }
+        if (!complete) {
+            ostreetui.RequestCommitSizes(orphans);
+        }
+        return vbox({
+            text(" ✖ ... all " + std::to_string(orphans.size()) + " orphaned commits") |
+                color(Color::Red),
+            text(" ✖ ... all other unreachable objects") | color(Color::Red),
+            text(" ≈ " + cpplibostree::FormatByteSize(bytes) + (complete ? "" : "...") +
+                 " of orphaned commits") |
+                dim,
+        });
+    }
+
     Element Render() final {
         // check if promotion was started not from drag & drop, but from ostreetui
         if (ostreetui.GetViewMode() == ViewMode::COMMIT_DRAGGING &&
@@ -183,7 +284,13 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
             }
         } else if (ostreetui.GetViewMode() == ViewMode::COMMIT_DROP &&
                    ostreetui.GetModeHash() == hash) {
-            startDeletionWindow(ostreetui.GetOstreeRepo().IsMostRecentCommitOnBranch(hash));
+            if (commit.branch == cpplibostree::ORPHANED_BRANCH) {
+                startDeletionWindow(deletionViewOrphans);
+            } else if (ostreetui.GetOstreeRepo().IsMostRecentCommitOnBranch(hash)) {
+                startDeletionWindow(deletionViewHead);
+            } else {
+                startDeletionWindow(deletionViewBody);
+            }
         }
 
         ftxui::Element element = ComponentBase::Render();
@@ -191,10 +298,10 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
         const WindowRenderState state = {element, title(), Active(), drag_};
 
         if (commitPosition == ostreetui.GetSelectedCommit()) {  // selected & not in promotion
+            const auto& branchColor = ostreetui.GetBranchColorMap().at(std::string(commit.branch));
             element =
                 render ? render(state)
-                       : DefaultRenderState(state, ostreetui.GetBranchColorMap().at(commit.branch),
-                                            ostreetui.GetModeHash() != hash);
+                       : DefaultRenderState(state, branchColor, ostreetui.GetModeHash() != hash);
         } else {
             element =
                 render ? render(state)
@@ -264,10 +371,10 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
                 // reset mouse
                 captured_mouse_ = nullptr;
                 // drop commit
-                if (event.mouse().y > ostreetui.GetScreen().dimy() - 8) {
+                if (event.mouse().y > ostreetui.GetScreenHeight() - 8) {
                     ostreetui.SetViewMode(ViewMode::COMMIT_DROP, hash);
                     ostreetui.SetModeBranch(
-                        ostreetui.GetOstreeRepo().GetCommitList().at(hash).branch);
+                        std::string(ostreetui.GetOstreeRepo().GetCommitList().at(hash).branch));
                     top() = drag_initial_y;
                 }
                 // check if position matches branch & do something if it does
@@ -285,7 +392,7 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
                 top() = event.mouse().y - drag_start_y - box_.y_min;
                 ostreetui.SetViewMode(ViewMode::COMMIT_DRAGGING, hash);
                 // check if potential commit deletion
-                if (event.mouse().y > ostreetui.GetScreen().dimy() - 8) {
+                if (event.mouse().y > ostreetui.GetScreenHeight() - 8) {
                     ostreetui.SetModeBranch("");
                 } else {
                     // potential promotion
@@ -392,11 +499,13 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
          // render version, if available
          commit.version.empty()
              ? Renderer([] { return filler(); })
-             : Container::Horizontal({Renderer([&] { return text(" ┆ version: "); }),
-                                      Input(&newVersion, commit.version) | underlined}),
+             : Container::Horizontal(
+                   {Renderer([&] { return text(" ┆ version: "); }),
+                    Input(&newVersion, std::string(commit.version)) | underlined}),
          Renderer([&] {
              return vbox({text(" ┆"), text(" ┆ to branch:"),
-                          text(" ☐ " + ostreetui.GetModeBranch()) | bold, text(" │") | bold});
+                          text(" ☐ " + ostreetui.GetModeBranch()) | bold,
+                          renderPromotionTarget()});
          }),
          Container::Horizontal({
              Button(" Cancel ", [&] { cancelSpecialWindow(); }) | color(Color::Red) | flex,
@@ -410,9 +519,10 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
                               text(" ✖ ") | color(Color::Red),
                               text(hash.substr(0, 8)) | bold | color(Color::Red),
                           }),
-                          text(" ✖ " + commit.subject) | color(Color::Red),
+                          text(" ✖ " + std::string(commit.subject)) | color(Color::Red),
                           text(" ✖") | color(Color::Red),
-                          text(" ☐ " + ostreetui.GetModeBranch()) | dim, text(" │") | dim});
+                          text(" ☐ " + ostreetui.GetModeBranch()) | dim, text(" │") | dim,
+                          renderDropPreview(false)});
          }),
          Container::Horizontal({
              Button(" Cancel ", [&] { cancelSpecialWindow(); }) | color(Color::Red) | flex,
@@ -421,24 +531,33 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
     // deletion view, if commit is not the most recent on its branch
     Component deletionViewBody = Container::Vertical(
         {Renderer([&] {
-             std::string parent = ostreetui.GetOstreeRepo().GetCommitList().at(hash).parent;
              return vbox({text(" Remove Commit (and preceding)...") | bold, text(""),
                           text(" ☐ " + ostreetui.GetModeBranch()) | dim, text(" │") | dim,
                           hbox({
                               text(" ✖ ") | color(Color::Red),
                               text(hash.substr(0, 8)) | bold | color(Color::Red),
                           }),
-                          parent == "(no parent)"
-                              ? text("")
-                              : vbox({
-                                    text(" ✖ " + parent.substr(0, 8)) | color(Color::Red),
-                                    text(" ✖ ...") | color(Color::Red),
-                                })});
+                          renderDropPreview(true)});
          }),
          Container::Horizontal({
              Button(" Cancel ", [&] { cancelSpecialWindow(); }) | color(Color::Red) | flex,
              Button(" Remove ", [&] { executeDeletion(); }) | color(Color::Green) | flex,
          })});
+    // deletion view, if the commit is orphaned (all orphans are pruned at once)
+    Component deletionViewOrphans = Container::Vertical(
+        {Renderer([&] {
+             return vbox({text(" Prune Orphaned Commits...") | bold, text(""),
+                          text(" ☐ " + ostreetui.GetModeBranch()) | dim, text(" │") | dim,
+                          hbox({
+                              text(" ✖ ") | color(Color::Red),
+                              text(hash.substr(0, 8)) | bold | color(Color::Red),
+                          }),
+                          renderOrphanPreview()});
+         }),
+         Container::Horizontal({
+             Button(" Cancel ", [&] { cancelSpecialWindow(); }) | color(Color::Red) | flex,
+             Button(" Prune ", [&] { executeOrphanPrune(); }) | color(Color::Green) | flex,
+         })});
 };
 
 }  // namespace
@@ -475,7 +594,7 @@ ftxui::Element commitRender(OSTreeTUI& ostreetui,
         const cpplibostree::Commit commit =
             ostreetui.GetOstreeRepo().GetCommitList().at(visibleCommitIndex);
         // branch head if it is first branch usage
-        const std::string relevantBranch = commit.branch;
+        const std::string relevantBranch(commit.branch);
         if (usedBranches.at(relevantBranch) == -1) {
             ostreetui.GetColumnToBranchMap().push_back(relevantBranch);
             usedBranches.at(relevantBranch) = nextAvailableSpace--;
@@ -503,7 +622,7 @@ ftxui::Element addTreeLine(const RenderTree& treeLineType,
                            const std::unordered_map<std::string, ftxui::Color>& branchColorMap) {
     using namespace ftxui;
 
-    const std::string relevantBranch = commit.branch;
+    const std::string relevantBranch(commit.branch);
     // create an empty branch tree line
     Elements tree(usedBranches.size(), text(COMMIT_NONE));
 
@@ -32,8 +32,10 @@ constexpr int COMMIT_WINDOW_HEIGHT{4};
 constexpr int COMMIT_WINDOW_WIDTH{32};
 constexpr int PROMOTION_WINDOW_HEIGHT{COMMIT_WINDOW_HEIGHT + 11};
 constexpr int PROMOTION_WINDOW_WIDTH{COMMIT_WINDOW_WIDTH + 8};
-constexpr int DELETION_WINDOW_HEIGHT{COMMIT_WINDOW_HEIGHT + 8};
+constexpr int DELETION_WINDOW_HEIGHT{COMMIT_WINDOW_HEIGHT + 10};
 constexpr int DELETION_WINDOW_WIDTH{COMMIT_WINDOW_WIDTH + 8};
+// maximum amount of listed commits in the deletion window
+constexpr size_t DELETION_PREVIEW_COMMITS{4};
 // render tree types
 enum RenderTree : uint8_t {
     TREE_LINE_NODE,          // ☐ | |
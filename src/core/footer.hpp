@@ -19,7 +19,7 @@ class Footer {
 
    private:
     const std::string DEFAULT_CONTENT{
-        "  || Alt+Q : Quit || Alt+R : Refresh || Alt+C : Copy Hash || Alt+P : Promote || Alt+D: "
-        "Drop || "};
+        "  || Alt+Q : Quit || Alt+R : Refresh || Alt+G : Go to || Alt+C : Copy Hash || Alt+V : "
+        "Verify || Alt+P : Promote || Alt+D: Drop || Alt+K : Retain || Alt+O : Orphans || "};
     std::string content{DEFAULT_CONTENT};
 };
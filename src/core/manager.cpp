@@ -1,14 +1,23 @@
 #include "manager.hpp"
 
 #include <assert.h>
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <numeric>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "ftxui/component/component.hpp"  // for Renderer, ResizableSplitBottom, ResizableSplitLeft, ResizableSplitRight, ResizableSplitTop
 #include "ftxui/component/event.hpp"  // for Event
+#include "ftxui/component/mouse.hpp"  // for Mouse
 #include "ftxui/dom/elements.hpp"     // for Element, operator|, text, center, border
 
+#include "../util/commitMetadata.hpp"
 #include "../util/cpplibostree.hpp"
+#include "../util/signatureVerifier.hpp"
 
 #include "OSTreeTUI.hpp"
 
@@ -16,13 +25,14 @@
 
 Manager::Manager(OSTreeTUI& ostreetui,
                  const ftxui::Component& infoView,
-                 const ftxui::Component& filterView)
+                 const ftxui::Component& filterView,
+                 const ftxui::Component& statsView)
     : ostreetui(ostreetui) {
     using namespace ftxui;
 
     tabSelection = Menu(&tab_entries, &tab_index, MenuOption::HorizontalAnimated());
 
-    tabContent = Container::Tab({infoView, filterView}, &tab_index);
+    tabContent = Container::Tab({infoView, filterView, statsView}, &tab_index);
 
     managerRenderer = Container::Vertical(
         {tabSelection, tabContent,
@@ -50,60 +60,443 @@ int Manager::getTabIndex() const {
 
 BranchBoxManager::BranchBoxManager(OSTreeTUI& ostreetui,
                                    cpplibostree::OSTreeRepo& repo,
-                                   std::unordered_map<std::string, bool>& visibleBranches) {
+                                   std::unordered_map<std::string, bool>& visibleBranches)
+    : ostreetui(ostreetui) {
     using namespace ftxui;
 
-    CheckboxOption cboption = CheckboxOption::Simple();
-    cboption.on_change = [&] { ostreetui.RefreshCommitListComponent(); };
-    // CheckboxOption cboption = {.on_change = [&] { ostreetui.RefreshCommitListComponent(); }};
-
-    // branch visibility
-    for (const auto& branch : repo.GetBranches()) {
-        branchBoxes->Add(Checkbox(branch, &(visibleBranches.at(branch)), cboption));
+    // branch visibility (map entries are never removed, so the pointers stay valid)
+    refTree.Build(repo.GetBranches());
+    for (const auto& branch : refTree.GetRefs()) {
+        refVisible.push_back(&visibleBranches.at(branch));
     }
+
+    InputOption searchOption;
+    searchOption.multiline = false;
+    searchOption.on_enter = [&] { refList->TakeFocus(); };
+    searchInput = Input(&query, "glob, or text", searchOption);
+
+    refList = CatchEvent(Renderer([&](bool focused) { return listRender(focused); }),
+                         [&](const Event& event) { return onListEvent(event); });
+
+    branchBoxes = Container::Vertical({searchInput, refList});
 }
 
 ftxui::Element BranchBoxManager::branchBoxRender() {
     using namespace ftxui;
 
+    updateSearch();
+    const auto shown =
+        std::count_if(refVisible.begin(), refVisible.end(), [](bool* visible) { return *visible; });
+
     // branch filter
     Elements bfb_elements = {
-        text(L"branches:") | bold,
-        filler(),
-        branchBoxes->Render() | vscroll_indicator | frame | size(HEIGHT, LESS_THAN, 10),
+        hbox({text(L"branches:") | bold, filler(),
+              text(std::to_string(shown) + "/" + std::to_string(refVisible.size()) + " shown ") |
+                  dim}),
+        hbox({text(" search: "), searchInput->Render() | flex}),
+        refList->Render(),
     };
     return vbox(bfb_elements);
 }
 
+const std::vector<std::string>& BranchBoxManager::GetRefs() const {
+    return refTree.GetRefs();
+}
+
+void BranchBoxManager::updateSearch() {
+    if (query == (search.has_value() ? search->GetPattern() : "")) {
+        return;
+    }
+    cursor = 0;
+    scrollTop = 0;
+    if (query.empty()) {
+        search.reset();
+        searchResults.clear();
+        return;
+    }
+    auto pattern = cpplibostree::RefPattern::Compile(
+        query, cpplibostree::RefPattern::GuessSyntax(query));
+    if (!pattern.has_value()) {
+        // incomplete pattern while typing, keep the last results
+        return;
+    }
+    // typing more characters only narrows down the last results
+    std::vector<size_t> candidates;
+    if (search.has_value() && pattern->Narrows(search.value())) {
+        candidates = std::move(searchResults);
+    } else {
+        candidates.resize(refTree.GetRefs().size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+    }
+    searchResults.clear();
+    for (const size_t ref : candidates) {
+        if (pattern->Matches(refTree.GetRefs()[ref])) {
+            searchResults.push_back(ref);
+        }
+    }
+    search = std::move(pattern);
+}
+
+size_t BranchBoxManager::getRowCount() const {
+    // while searching, the first row toggles all matches
+    return search.has_value() ? searchResults.size() + 1 : refTree.GetRows().size();
+}
+
+size_t BranchBoxManager::getListHeight() const {
+    return static_cast<size_t>(std::max(REF_LIST_MIN_HEIGHT, ostreetui.GetScreenHeight() / 2));
+}
+
+std::vector<size_t> BranchBoxManager::getRowRefs(size_t row) const {
+    if (search.has_value()) {
+        return row == 0 ? searchResults : std::vector<size_t>{searchResults.at(row - 1)};
+    }
+    const auto& node = refTree.GetNode(refTree.GetRows().at(row));
+    std::vector<size_t> refs(node.refEnd - node.refBegin);
+    std::iota(refs.begin(), refs.end(), node.refBegin);
+    return refs;
+}
+
+void BranchBoxManager::toggleRefs(const std::vector<size_t>& refs) {
+    if (refs.empty()) {
+        return;
+    }
+    const bool allVisible =
+        std::all_of(refs.begin(), refs.end(), [&](size_t ref) { return *refVisible.at(ref); });
+    for (const size_t ref : refs) {
+        *refVisible.at(ref) = !allVisible;
+    }
+    ostreetui.RefreshCommitListComponent();
+}
+
+bool BranchBoxManager::setRowExpanded(size_t row, bool expanded) {
+    if (search.has_value() || row >= refTree.GetRows().size()) {
+        return false;
+    }
+    return refTree.SetExpanded(refTree.GetRows().at(row), expanded);
+}
+
+bool BranchBoxManager::onListEvent(const ftxui::Event& event) {
+    using namespace ftxui;
+
+    updateSearch();
+    const size_t rowCount = getRowCount();
+    if (rowCount == 0) {
+        return false;
+    }
+    const size_t page = getListHeight();
+
+    // mouse: click toggles refs, or expands directories
+    if (event.is_mouse()) {
+        const Mouse& mouse = event.mouse();
+        if (!listBox.Contain(mouse.x, mouse.y)) {
+            return false;
+        }
+        if (mouse.button == Mouse::WheelUp || mouse.button == Mouse::WheelDown) {
+            scrollTop = mouse.button == Mouse::WheelUp
+                            ? scrollTop - std::min<size_t>(scrollTop, 1)
+                            : std::min(scrollTop + 1, rowCount - 1);
+            cursor = std::clamp(cursor, scrollTop, scrollTop + page - 1);
+            return true;
+        }
+        if (mouse.button != Mouse::Left || mouse.motion != Mouse::Pressed) {
+            return false;
+        }
+        const size_t row = scrollTop + static_cast<size_t>(mouse.y - listBox.y_min);
+        if (row >= rowCount) {
+            return false;
+        }
+        cursor = row;
+        refList->TakeFocus();
+        if (search.has_value() || refTree.GetNode(refTree.GetRows().at(row)).isRef) {
+            toggleRefs(getRowRefs(row));
+        } else {
+            setRowExpanded(row, !refTree.GetNode(refTree.GetRows().at(row)).expanded);
+        }
+        return true;
+    }
+
+    // keyboard
+    if (event == Event::ArrowUp && cursor > 0) {
+        cursor--;
+    } else if (event == Event::ArrowDown && cursor + 1 < rowCount) {
+        cursor++;
+    } else if (event == Event::PageUp) {
+        cursor -= std::min(cursor, page);
+    } else if (event == Event::PageDown) {
+        cursor = std::min(cursor + page, rowCount - 1);
+    } else if (event == Event::Home) {
+        cursor = 0;
+    } else if (event == Event::End) {
+        cursor = rowCount - 1;
+    } else if (event == Event::Return || event == Event::Character(' ')) {
+        toggleRefs(getRowRefs(cursor));
+    } else if (event == Event::ArrowRight) {
+        return setRowExpanded(cursor, true);
+    } else if (event == Event::ArrowLeft) {
+        // not handled on refs, to leave the filter
+        return setRowExpanded(cursor, false);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+ftxui::Element BranchBoxManager::listRender(bool focused) {
+    using namespace ftxui;
+
+    updateSearch();
+    const size_t rowCount = getRowCount();
+    if (rowCount == 0 || (search.has_value() && searchResults.empty())) {
+        return text(" no matching refs ") | dim;
+    }
+    cursor = std::min(cursor, rowCount - 1);
+
+    // keep the cursor in the rendered window
+    const size_t height = getListHeight();
+    if (cursor < scrollTop) {
+        scrollTop = cursor;
+    } else if (cursor >= scrollTop + height) {
+        scrollTop = cursor - height + 1;
+    }
+    scrollTop = std::min(scrollTop, rowCount - std::min(rowCount, height));
+
+    auto checkbox = [&](const std::vector<size_t>& refs) {
+        const auto visible = std::count_if(refs.begin(), refs.end(),
+                                           [&](size_t ref) { return *refVisible.at(ref); });
+        if (visible == 0) {
+            return std::string("☐ ");
+        }
+        return static_cast<size_t>(visible) == refs.size() ? std::string("▣ ")
+                                                           : std::string("◪ ");
+    };
+
+    Elements rows;
+    for (size_t row{scrollTop}; row < std::min(scrollTop + height, rowCount); row++) {
+        const std::vector<size_t> refs = getRowRefs(row);
+        Element line;
+        if (search.has_value()) {
+            line = row == 0 ? text(checkbox(refs) + "all " + std::to_string(refs.size()) +
+                                   " matches") |
+                                  bold
+                            : text(checkbox(refs) + refTree.GetRefs().at(refs.front()));
+        } else {
+            const auto& node = refTree.GetNode(refTree.GetRows().at(row));
+            const std::string indent(2 * node.depth, ' ');
+            line = node.isRef ? text(indent + "  " + checkbox(refs) + node.label)
+                              : hbox({text(indent + (node.expanded ? "▾ " : "▸ ") +
+                                           checkbox(refs) + node.label + "/"),
+                                      text(" " + std::to_string(refs.size())) | dim});
+        }
+        if (row == cursor) {
+            line = line | (focused ? inverted : bold);
+        }
+        rows.push_back(line);
+    }
+
+    // position indicator, the list is not scrollable by a frame
+    Element position =
+        rowCount > height ? text(" " + std::to_string(cursor + 1) + "/" +
+                                 std::to_string(rowCount) + " ") |
+                                dim
+                          : text("");
+    return vbox({vbox(std::move(rows)) | reflect(listBox), position});
+}
+
 // CommitInfoManager
 
-ftxui::Element CommitInfoManager::renderInfoView(const cpplibostree::Commit& displayCommit) {
+ftxui::Element CommitInfoManager::renderInfoView(const cpplibostree::Commit& displayCommit,
+                                                 const cpplibostree::CommitDetails* loadedDetails,
+                                                 std::optional<uint64_t> size,
+                                                 const std::vector<std::string>& containingRefs) {
     using namespace ftxui;
 
+    // details might still be decoded in the background, show everything else meanwhile
+    static const cpplibostree::CommitDetails NO_DETAILS;
+    const auto& details = loadedDetails != nullptr ? *loadedDetails : NO_DETAILS;
+
     // selected commit info
     Elements signatures;
-    for (const auto& signature : displayCommit.signatures) {
-        std::string ts =
-            std::format("{:%Y-%m-%d %T %Ez}",
-                        std::chrono::time_point_cast<std::chrono::seconds>(signature.timestamp));
-        signatures.push_back(
-            vbox({hbox({text("‣ "), text(signature.pubkeyAlgorithm) | bold, text(" signature")}),
-                  text("  with key ID " + signature.fingerprint), text("  made " + ts)}));
+    for (const auto& signature : details.signatures) {
+        Elements lines{
+            hbox({text("‣ "), text(signature.pubkeyAlgorithm) | bold, text(" signature")}),
+            signature.valid
+                ? text("  verified by " + signature.scheme) | color(Color::Green)
+                : text("  not verified (" + signature.scheme + ")") | color(Color::Red)};
+        if (!signature.fingerprint.empty()) {
+            lines.push_back(text("  with key ID " + signature.fingerprint));
+        }
+        // ed25519 signatures carry no timestamp
+        if (signature.scheme == cpplibostree::SIGNATURE_SCHEME_GPG) {
+            lines.push_back(text(
+                "  made " + std::format("{:%Y-%m-%d %T %Ez}",
+                                        std::chrono::time_point_cast<std::chrono::seconds>(
+                                            signature.timestamp))));
+        }
+        signatures.push_back(vbox(std::move(lines)));
+    }
+    // metadata, only the displayed entries get formatted
+    auto metadataElements = [](GVariant* metadata) {
+        Elements entries;
+        cpplibostree::ForEachMetadataEntry(metadata, [&](std::string_view key, GVariant* value) {
+            entries.push_back(hbox({text("  " + std::string(key) + ": ") | bold,
+                                    paragraph(cpplibostree::FormatMetadataValue(value))}));
+        });
+        return entries;
+    };
+    Elements metadata = metadataElements(details.metadata.get());
+    Elements detachedMetadata = metadataElements(details.detachedMetadata.get());
+    std::string containedIn;
+    for (const auto& ref : containingRefs) {
+        containedIn += (containedIn.empty() ? "" : ", ") + ref;
     }
     return vbox(
         {text(" Subject:") | color(Color::Green),
-         paragraph(displayCommit.subject) | color(Color::White), filler(),
-         text(" Hash: ") | color(Color::Green), text(displayCommit.hash), filler(),
+         paragraph(std::string(displayCommit.subject)) | color(Color::White),
+         details.body.empty() ? filler() : paragraph(details.body) | dim, filler(),
+         text(" Hash: ") | color(Color::Green), text(std::string(displayCommit.hash)), filler(),
          text(" Date: ") | color(Color::Green),
          text(std::format("{:%Y-%m-%d %T %Ez}", std::chrono::time_point_cast<std::chrono::seconds>(
                                                     displayCommit.timestamp))),
          filler(),
          // TODO insert version, only if exists
          displayCommit.version.empty() ? filler() : text(" Version: ") | color(Color::Green),
-         displayCommit.version.empty() ? filler() : text(displayCommit.version),
-         text(" Parent: ") | color(Color::Green), text(displayCommit.parent), filler(),
-         text(" Checksum: ") | color(Color::Green), text(displayCommit.contentChecksum), filler(),
-         displayCommit.signatures.size() > 0 ? text(" Signatures: ") | color(Color::Green)
-                                             : text(""),
+         displayCommit.version.empty() ? filler() : text(std::string(displayCommit.version)),
+         text(" Parent: ") | color(Color::Green), text(std::string(displayCommit.parent)), filler(),
+         containedIn.empty() ? filler() : text(" Contained in: ") | color(Color::Green),
+         containedIn.empty() ? filler() : paragraph(containedIn), filler(),
+         size.has_value() ? text(" Size: ") | color(Color::Green) : filler(),
+         size.has_value() ? text("≈ " + cpplibostree::FormatByteSize(size.value())) : filler(),
+         text(" Checksum: ") | color(Color::Green),
+         loadedDetails == nullptr ? text("loading details...") | dim
+                                  : text(details.contentChecksum),
+         filler(),
+         metadata.empty() ? text("") : text(" Metadata: ") | color(Color::Green),
+         vbox(metadata), filler(),
+         detachedMetadata.empty() ? text("") : text(" Detached Metadata: ") | color(Color::Green),
+         vbox(detachedMetadata), filler(),
+         details.signatures.size() > 0 ? text(" Signatures: ") | color(Color::Green) : text(""),
          vbox(signatures), filler()});
 }
+
+ftxui::Element CommitInfoManager::renderVerification(
+    const cpplibostree::VerifyProgress& progress) {
+    using namespace ftxui;
+
+    Elements elements{text(" Verification: ") | color(Color::Green)};
+    // progress, the objects are only known after the commit got traversed
+    if (progress.running) {
+        const float done = progress.objectsTotal == 0
+                               ? 0.0F
+                               : static_cast<float>(progress.objectsDone) /
+                                     static_cast<float>(progress.objectsTotal);
+        elements.push_back(hbox({text("  "), gauge(done) | color(Color::Yellow) | flex,
+                                 text(" " + std::to_string(progress.objectsDone) + "/" +
+                                      std::to_string(progress.objectsTotal) + " ")}));
+    } else if (progress.objectsBroken == 0) {
+        elements.push_back(text("  ✔ all " + std::to_string(progress.objectsTotal) +
+                                " objects intact") |
+                           color(Color::GreenLight));
+    } else {
+        elements.push_back(text("  ✘ " + std::to_string(progress.objectsBroken) +
+                                " broken objects") |
+                           color(Color::RedLight) | bold);
+    }
+    // throughput
+    const auto milliseconds =
+        std::chrono::duration_cast<std::chrono::milliseconds>(progress.elapsed).count();
+    elements.push_back(
+        text("  " + cpplibostree::FormatByteSize(progress.bytesHashed) + " hashed in " +
+             std::to_string(milliseconds) + " ms (" +
+             cpplibostree::FormatByteSize(static_cast<uint64_t>(progress.GetThroughput())) +
+             "/s)") |
+        dim);
+    if (progress.objectsSkipped > 0) {
+        elements.push_back(text("  " + std::to_string(progress.objectsSkipped) +
+                                " objects already verified before") |
+                           dim);
+    }
+    for (const auto& problem : progress.problems) {
+        elements.push_back(paragraph("  " + problem) | color(Color::Red));
+    }
+    if (progress.objectsBroken > progress.problems.size()) {
+        elements.push_back(
+            text("  ... " + std::to_string(progress.objectsBroken - progress.problems.size()) +
+                 " more") |
+            color(Color::Red));
+    }
+    return vbox(std::move(elements));
+}
+
+// StatisticsManager
+
+StatisticsManager::StatisticsManager(OSTreeTUI& ostreetui, cpplibostree::ThreadPool& threadPool)
+    : ostreetui(ostreetui), collector(threadPool) {}
+
+ftxui::Element StatisticsManager::statisticsRender() {
+    using namespace ftxui;
+
+    collector.Start(ostreetui.GetOstreeRepo(),
+                    [&] { ostreetui.GetScreen().Post(Event::Custom); });
+
+    Elements elements;
+
+    // scan progress
+    if (collector.IsRunning()) {
+        auto [done, total] = collector.GetProgress();
+        elements.push_back(hbox({
+            text(" Scanning objects ") | color(Color::Yellow),
+            gauge(static_cast<float>(done) / static_cast<float>(total)) | flex,
+            text(" " + std::to_string(done) + "/" + std::to_string(total) + " "),
+        }));
+    }
+
+    auto stats = collector.GetResult();
+    if (!stats.has_value()) {
+        elements.push_back(text(" no statistics available yet ") | dim);
+        return vbox(elements);
+    }
+
+    auto row = [](const std::string& label, const std::string& value) {
+        return hbox({text(" " + label) | color(Color::Green), filler(), text(value + " ")});
+    };
+
+    // objects
+    elements.push_back(text(" Objects:") | bold);
+    for (const auto& [type, typeStats] : stats->objectTypes) {
+        elements.push_back(row("‣ " + type, std::to_string(typeStats.count) + " (" +
+                                                 cpplibostree::FormatByteSize(typeStats.bytes) +
+                                                 ")"));
+    }
+    elements.push_back(row("loose objects", cpplibostree::FormatByteSize(stats->looseObjectBytes)));
+    elements.push_back(row("total", cpplibostree::FormatByteSize(stats->totalBytes)));
+    elements.push_back(filler());
+
+    // refs & commits
+    elements.push_back(text(" History:") | bold);
+    elements.push_back(row("refs", std::to_string(stats->refCount)));
+    elements.push_back(row("commits", std::to_string(stats->commitCount)));
+    elements.push_back(row("unsigned heads", std::to_string(stats->unsignedHeads)));
+    elements.push_back(row("orphaned commits", std::to_string(stats->orphanedCommits.size())));
+    if (!stats->orphanedCommits.empty()) {
+        elements.push_back(text(" Alt+O: show them in the commit tree ") | dim);
+    }
+    elements.push_back(filler());
+
+    elements.push_back(
+        text(" scanned in " + std::to_string(stats->scanDuration.count()) + " ms ") | dim);
+
+    return vbox(elements);
+}
+
+void StatisticsManager::Invalidate() {
+    collector.Invalidate();
+}
+
+std::optional<cpplibostree::RepoStatistics> StatisticsManager::GetStatistics(bool wait) {
+    collector.Start(ostreetui.GetOstreeRepo(),
+                    [&] { ostreetui.GetScreen().Post(ftxui::Event::Custom); });
+    if (wait) {
+        collector.Wait();
+    }
+    return collector.GetResult();
+}
@@ -1,31 +1,46 @@
 /*_____________________________________________________________
  | Manager Render
- |   Right portion of main window, includes branch filter &
- |   detailed commit info of the selected commit.
+ |   Right portion of main window, includes branch filter,
+ |   detailed commit info of the selected commit & repository
+ |   statistics.
  |___________________________________________________________*/
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "ftxui/component/component.hpp"  // for Component
+#include "ftxui/component/event.hpp"      // for Event
+#include "ftxui/screen/box.hpp"           // for Box
 
+#include "../util/commitVerifier.hpp"
 #include "../util/cpplibostree.hpp"
+#include "../util/refPattern.hpp"
+#include "../util/refTree.hpp"
+#include "../util/repoStatistics.hpp"
+#include "../util/threadPool.hpp"
 
 class OSTreeTUI;
 
+/// minimum amount of rows of the ref list in the branch filter
+constexpr int REF_LIST_MIN_HEIGHT{5};
+
 /// Interchangeable View
 class Manager {
    public:
     Manager(OSTreeTUI& ostreetui,
             const ftxui::Component& infoView,
-            const ftxui::Component& filterView);
+            const ftxui::Component& filterView,
+            const ftxui::Component& statsView);
 
    private:
     OSTreeTUI& ostreetui;
 
     int tab_index{0};
-    std::vector<std::string> tab_entries = {" Info ", " Filter "};
+    std::vector<std::string> tab_entries = {" Info ", " Filter ", " Stats "};
 
     // because the combination of all interchangeable views is very simple,
     // we can (in contrast to the other ones) render this one here
@@ -44,11 +59,29 @@ class CommitInfoManager {
      * @brief Build the info view Element.
      *
      * @param displayCommit Commit to display the information of.
+     * @param loadedDetails Lazily decoded details of the commit (nullptr while loading).
+     * @param size Size of the commit, if already known.
+     * @param containingRefs Refs, that contain the commit in their history.
+     * @return ftxui::Element
+     */
+    [[nodiscard]] static ftxui::Element renderInfoView(
+        const cpplibostree::Commit& displayCommit,
+        const cpplibostree::CommitDetails* loadedDetails,
+        std::optional<uint64_t> size,
+        const std::vector<std::string>& containingRefs);
+
+    /**
+     * @brief Build the Element of a (running) commit verification.
+     *
+     * @param progress Progress of the verification.
      * @return ftxui::Element
      */
-    [[nodiscard]] static ftxui::Element renderInfoView(const cpplibostree::Commit& displayCommit);
+    [[nodiscard]] static ftxui::Element renderVerification(
+        const cpplibostree::VerifyProgress& progress);
 };
 
+/// Branch filter: refs as a collapsible tree by path segment, with a search field. Only the
+/// rows, that fit on the screen, are rendered.
 class BranchBoxManager {
    public:
     BranchBoxManager(OSTreeTUI& ostreetui,
@@ -56,12 +89,97 @@ class BranchBoxManager {
                      std::unordered_map<std::string, bool>& visibleBranches);
 
     /**
-     * @brief Build the branch box Element.
+     * @brief Build the branch filter Element.
      *
      * @return ftxui::Element
      */
     [[nodiscard]] ftxui::Element branchBoxRender();
 
+    /// Getter: sorted refs, the branch boxes were built for
+    [[nodiscard]] const std::vector<std::string>& GetRefs() const;
+
+   private:
+    /// @brief Update the search results, if the search query changed since the last call.
+    void updateSearch();
+
+    /// @brief Amount of rows in the list (tree rows, or "all matches" & search results).
+    [[nodiscard]] size_t getRowCount() const;
+
+    /// @brief Amount of rows, that are rendered at once.
+    [[nodiscard]] size_t getListHeight() const;
+
+    /**
+     * @brief Get the refs of a row (all refs of a directory, or of the search).
+     *
+     * @param row Row in the list.
+     * @return Ref indices in the RefTree
+     */
+    [[nodiscard]] std::vector<size_t> getRowRefs(size_t row) const;
+
+    /**
+     * @brief Show all given refs, or hide them if all are shown already. The commit list is
+     * refreshed once.
+     *
+     * @param refs Ref indices in the RefTree.
+     */
+    void toggleRefs(const std::vector<size_t>& refs);
+
+    /// @brief Expand, or collapse the directory of a row (no effect on refs).
+    bool setRowExpanded(size_t row, bool expanded);
+
+    /// @brief Handle keyboard & mouse events of the list.
+    bool onListEvent(const ftxui::Event& event);
+
+    /// @brief Render the visible window of the list.
+    [[nodiscard]] ftxui::Element listRender(bool focused);
+
+    OSTreeTUI& ostreetui;
+    cpplibostree::RefTree refTree;
+    std::vector<bool*> refVisible;  // per ref of the tree, points into visibleBranches
+
+    // search
+    std::string query;
+    std::optional<cpplibostree::RefPattern> search;  // pattern of the current results
+    std::vector<size_t> searchResults;               // matching ref indices
+
+    // list state
+    size_t cursor{0};
+    size_t scrollTop{0};
+    ftxui::Box listBox;
+
+    ftxui::Component searchInput;
+    ftxui::Component refList;
+
    public:
-    ftxui::Component branchBoxes = ftxui::Container::Vertical({});
+    // search field & ref list
+    ftxui::Component branchBoxes;
+};
+
+class StatisticsManager {
+   public:
+    StatisticsManager(OSTreeTUI& ostreetui, cpplibostree::ThreadPool& threadPool);
+
+    /**
+     * @brief Build the statistics Element. Starts a background scan, if there is no
+     * up-to-date result yet.
+     *
+     * @return ftxui::Element
+     */
+    [[nodiscard]] ftxui::Element statisticsRender();
+
+    /// @brief Mark the shown statistics as outdated (e.g. after a repository refresh).
+    void Invalidate();
+
+    /**
+     * @brief Get the last finished statistics. Starts a background scan, if there is no
+     * up-to-date result yet.
+     *
+     * @param wait Block until the started scan is done.
+     * @return Statistics, if any scan finished
+     */
+    [[nodiscard]] std::optional<cpplibostree::RepoStatistics> GetStatistics(bool wait);
+
+   private:
+    OSTreeTUI& ostreetui;
+    cpplibostree::RepoStatisticsCollector collector;
 };
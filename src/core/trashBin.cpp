@@ -63,7 +63,7 @@ class TrashBinComponentImpl : public ComponentBase, public WindowOptions {
 
    private:
     void showBin() {
-        top() = ostreetui.GetScreen().dimy() - 8;
+        top() = ostreetui.GetScreenHeight() - 8;
         left() = -5;
     }
 
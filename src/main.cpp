@@ -1,8 +1,19 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "core/OSTreeTUI.hpp"
+#include "util/commitExport.hpp"
+#include "util/commitReader.hpp"
+#include "util/metricsExport.hpp"
+#include "util/refPattern.hpp"
+#include "util/repoDaemon.hpp"
+#include "util/retention.hpp"
 
 /**
  * @brief Parse all options listed behind an argument
@@ -51,12 +62,144 @@ int main(int argc, const char** argv) {
     if (argExists(args, "-v") || argExists(args, "--version")) {
         return OSTreeTUI::showVersion();
     }
-    // assume ostree repository path as first argument
-    std::string repo = args.at(0);
-    // -r, --refs
-    std::vector<std::string> startupBranches = getArgOptions(args, {"-r", "--refs"});
+    // assume ostree repository paths as first arguments (one tab per repository)
+    std::vector<std::string> repos;
+    for (const auto& arg : args) {
+        if (arg.starts_with("-")) {
+            break;
+        }
+        repos.push_back(arg);
+    }
+    if (repos.empty()) {
+        return OSTreeTUI::showHelp(argv[0], "no repository provided");
+    }
+    // -r, --refs GLOB [GLOB...], --refs-regex REGEX [REGEX...]
+    cpplibostree::LoadOptions loadOptions;
+    const std::vector<std::pair<std::vector<std::string>, cpplibostree::RefPatternSyntax>>
+        refPatterns{{getArgOptions(args, {"-r", "--refs"}), cpplibostree::RefPatternSyntax::GLOB},
+                    {getArgOptions(args, {"--refs-regex"}), cpplibostree::RefPatternSyntax::REGEX}};
+    for (const auto& [patterns, syntax] : refPatterns) {
+        for (const auto& pattern : patterns) {
+            auto compiled = cpplibostree::RefPattern::Compile(pattern, syntax);
+            if (!compiled.has_value()) {
+                return OSTreeTUI::showHelp(argv[0], "invalid ref pattern " + pattern);
+            }
+            loadOptions.refs.push_back(std::move(compiled.value()));
+        }
+    }
+    // --depth N, --since YYYY-MM-DD
+    if (argExists(args, "--depth")) {
+        std::vector<std::string> depthOptions = getArgOptions(args, {"--depth"});
+        int depth{0};
+        if (depthOptions.empty() || std::sscanf(depthOptions.at(0).c_str(), "%d", &depth) != 1 ||
+            depth <= 0) {
+            return OSTreeTUI::showHelp(argv[0], "invalid depth (use a positive number)");
+        }
+        loadOptions.depth = static_cast<size_t>(depth);
+    }
+    if (argExists(args, "--since")) {
+        std::vector<std::string> sinceOptions = getArgOptions(args, {"--since"});
+        int year{0};
+        unsigned int month{0};
+        unsigned int day{0};
+        if (sinceOptions.empty() ||
+            std::sscanf(sinceOptions.at(0).c_str(), "%d-%u-%u", &year, &month, &day) != 3 ||
+            !std::chrono::year_month_day(std::chrono::year(year), std::chrono::month(month),
+                                         std::chrono::day(day))
+                 .ok()) {
+            return OSTreeTUI::showHelp(argv[0], "invalid date (use YYYY-MM-DD)");
+        }
+        std::chrono::sys_days date = std::chrono::year_month_day(
+            std::chrono::year(year), std::chrono::month(month), std::chrono::day(day));
+        loadOptions.since = cpplibostree::Timepoint(
+            std::chrono::duration_cast<std::chrono::seconds>(date.time_since_epoch()));
+    }
+    // --dump FORMAT (headless)
+    if (argExists(args, "--dump")) {
+        std::vector<std::string> dumpOptions = getArgOptions(args, {"--dump"});
+        std::optional<cpplibostree::ExportFormat> format =
+            dumpOptions.empty() ? std::nullopt : cpplibostree::ParseExportFormat(dumpOptions.at(0));
+        if (!format.has_value()) {
+            return OSTreeTUI::showHelp(argv[0], "unknown dump format (use json, or ndjson)");
+        }
+        cpplibostree::OSTreeRepo ostreeRepo(repos.at(0), false);
+        ostreeRepo.SetLoadOptions(loadOptions);
+        return cpplibostree::ExportCommits(ostreeRepo, format.value(), std::cout) ? EXIT_SUCCESS
+                                                                                  : EXIT_FAILURE;
+    }
+    // --bench-commits (headless)
+    if (argExists(args, "--bench-commits")) {
+        return cpplibostree::BenchmarkCommitReaders(repos.at(0), std::cout) ? EXIT_SUCCESS
+                                                                            : EXIT_FAILURE;
+    }
+    // --daemon (headless)
+    if (argExists(args, "--daemon")) {
+        if (loadOptions.depth != 0 || loadOptions.since.has_value() || !loadOptions.refs.empty()) {
+            return OSTreeTUI::showHelp(argv[0], "the daemon always indexes the complete history");
+        }
+        cpplibostree::RepoDaemon daemon(repos.at(0));
+        return daemon.Run(std::cerr) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // --retain N|YYYY-MM-DD [GLOB...] [--apply] (headless)
+    if (argExists(args, "--retain")) {
+        auto policy = cpplibostree::RetentionPolicy::Parse(getArgOptions(args, {"--retain"}));
+        if (!policy.has_value()) {
+            return OSTreeTUI::showHelp(argv[0], "invalid retention policy (use N, or YYYY-MM-DD)");
+        }
+        cpplibostree::OSTreeRepo ostreeRepo(repos.at(0), false);
+        ostreeRepo.SetLoadOptions(loadOptions);
+        return cpplibostree::RunRetention(ostreeRepo, policy.value(), argExists(args, "--apply"),
+                                          std::cout)
+                   ? EXIT_SUCCESS
+                   : EXIT_FAILURE;
+    }
+    // --metrics FILE (headless)
+    if (argExists(args, "--metrics")) {
+        std::vector<std::string> metricsOptions = getArgOptions(args, {"--metrics"});
+        if (metricsOptions.empty()) {
+            return OSTreeTUI::showHelp(argv[0], "no metrics file provided");
+        }
+        cpplibostree::OSTreeRepo ostreeRepo(repos.at(0), false);
+        ostreeRepo.SetLoadOptions(loadOptions);
+        return cpplibostree::ExportMetrics(ostreeRepo, metricsOptions.at(0), std::cerr)
+                   ? EXIT_SUCCESS
+                   : EXIT_FAILURE;
+    }
+    // --render WIDTHxHEIGHT (headless)
+    std::optional<std::pair<int, int>> renderSize;
+    if (argExists(args, "--render")) {
+        std::vector<std::string> renderOptions = getArgOptions(args, {"--render"});
+        int width{0};
+        int height{0};
+        if (renderOptions.empty() ||
+            std::sscanf(renderOptions.at(0).c_str(), "%dx%d", &width, &height) != 2 ||
+            width <= 0 || height <= 0) {
+            return OSTreeTUI::showHelp(argv[0], "invalid render size (use WIDTHxHEIGHT)");
+        }
+        renderSize = {width, height};
+    }
+    // --control SOCKET
+    std::optional<std::string> controlSocket;
+    if (argExists(args, "--control")) {
+        std::vector<std::string> controlOptions = getArgOptions(args, {"--control"});
+        if (controlOptions.empty()) {
+            return OSTreeTUI::showHelp(argv[0], "no control socket path provided");
+        }
+        controlSocket = controlOptions.at(0);
+    }
+    // --events EVENT [EVENT...]
+    auto events = OSTreeTUI::ParseEventScript(getArgOptions(args, {"--events"}));
+    if (!events.has_value()) {
+        return OSTreeTUI::showHelp(argv[0], "invalid event in --events");
+    }
 
     // OSTree TUI
-    OSTreeTUI ostreetui(repo, startupBranches);
+    OSTreeTUI ostreetui(repos, loadOptions, !argExists(args, "--no-daemon"));
+    if (renderSize.has_value()) {
+        return ostreetui.RunHeadless(renderSize->first, renderSize->second, events.value());
+    }
+    if (controlSocket.has_value() && !ostreetui.StartControlServer(controlSocket.value())) {
+        return EXIT_FAILURE;
+    }
     return ostreetui.Run();
 }
@@ -0,0 +1,142 @@
+#include "asyncRepo.hpp"
+
+// C++
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cpplibostree {
+
+namespace {
+/// @brief Forward the walked branches of a load & check for cancellation in between.
+LoadProgressCallback loadProgress(const AsyncOptions& options) {
+    return [options](size_t loadedBranches, size_t totalBranches) {
+        if (options.onProgress) {
+            options.onProgress(loadedBranches, totalBranches);
+        }
+        return !options.cancellation.IsCancelled();
+    };
+}
+}  // namespace
+
+void CancellationToken::Cancel() {
+    cancelled->store(true);
+}
+
+bool CancellationToken::IsCancelled() const {
+    return cancelled->load();
+}
+
+Executor MakePoolExecutor(ThreadPool& pool, TaskPriority priority) {
+    return [&pool, priority](std::function<void()> task) {
+        pool.Submit(std::move(task), priority);
+    };
+}
+
+AsyncRepo::AsyncRepo(OSTreeRepo& repo, Executor executor)
+    : repo(repo), executor(std::move(executor)) {}
+
+std::future<std::optional<RepoData>> AsyncRepo::Load(const AsyncOptions& options) const {
+    // the settings may change on the calling thread, while the load runs
+    return run<std::optional<RepoData>>(
+        options, [this, options, settings = repo.GetLoadSettings()] {
+            return repo.LoadRepoData(settings, loadProgress(options));
+        });
+}
+
+std::future<HistoryPage> AsyncRepo::LoadHistoryPage(HistoryPageRequest request,
+                                                    size_t pageSize,
+                                                    const AsyncOptions& options) const {
+    return run<HistoryPage>(options, [this, options, request = std::move(request), pageSize] {
+        HistoryPage page = repo.LoadHistoryPage(request, pageSize);
+        reportDone(options);
+        return page;
+    });
+}
+
+std::future<bool> AsyncRepo::Refresh(const AsyncOptions& options) {
+    return run<bool>(options, [this, options, settings = repo.GetLoadSettings()] {
+        std::optional<RepoData> data = repo.LoadRepoData(settings, loadProgress(options));
+        if (!data.has_value()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(writeMutex);
+        repo.ApplyRepoData(std::move(data.value()));
+        return true;
+    });
+}
+
+std::future<bool> AsyncRepo::PromoteCommit(const std::string& hash,
+                                           const std::string& newRef,
+                                           const std::vector<std::string>& addMetadataStrings,
+                                           const std::string& newSubject,
+                                           bool keepMetadata,
+                                           const AsyncOptions& options) {
+    return run<bool>(options, [this, options, hash, newRef, addMetadataStrings, newSubject,
+                               keepMetadata] {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const bool success =
+            repo.PromoteCommit(hash, newRef, addMetadataStrings, newSubject, keepMetadata);
+        reportDone(options);
+        return success;
+    });
+}
+
+std::future<bool> AsyncRepo::RemoveCommit(const Commit& commit, const AsyncOptions& options) {
+    // the commit points into the loaded state, which may be replaced before the task runs
+    return run<bool>(options, [this, options, hash = std::string(commit.hash),
+                               branch = std::string(commit.branch),
+                               resetHead = repo.IsMostRecentCommitOnBranch(commit)] {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const bool success = repo.RemoveCommitAndPrune(hash, branch, resetHead);
+        reportDone(options);
+        return success;
+    });
+}
+
+std::future<PruneResult> AsyncRepo::PruneOrphanedCommits(const AsyncOptions& options) {
+    return run<PruneResult>(options, [this, options] {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        PruneResult result;
+        result.success = repo.PruneOrphanedCommits(result.objectsPruned, result.bytesPruned);
+        reportDone(options);
+        return result;
+    });
+}
+
+std::future<std::optional<RetentionResult>> AsyncRepo::ApplyRetention(
+    const RetentionPlan& plan,
+    const AsyncOptions& options) {
+    return run<std::optional<RetentionResult>>(options, [this, options, plan] {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        RetentionResult result;
+        const bool success = cpplibostree::ApplyRetention(repo.GetRepoPath(), plan, result);
+        reportDone(options);
+        return success ? std::optional<RetentionResult>(result) : std::nullopt;
+    });
+}
+
+std::future<std::shared_ptr<const CommitDetails>> AsyncRepo::GetCommitDetails(
+    const std::string& hash,
+    const AsyncOptions& options) const {
+    return run<std::shared_ptr<const CommitDetails>>(options, [this, options, hash] {
+        auto details = repo.GetCommitDetails(hash);
+        reportDone(options);
+        return details;
+    });
+}
+
+void AsyncRepo::reportDone(const AsyncOptions& options) {
+    if (options.onProgress) {
+        options.onProgress(1, 1);
+    }
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,175 @@
+/*_____________________________________________________________
+ | Async Repository
+ |   Future based access to an OSTreeRepo: loading, refreshing,
+ |   promoting, pruning (also by a retention plan) & commit
+ |   details run on an executor (e.g. the thread pool), report
+ |   their progress and can be cancelled. Writes to the
+ |   repository on disk are run one after another, reads run
+ |   in parallel.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cpplibostree.hpp"
+#include "retention.hpp"
+#include "threadPool.hpp"
+
+namespace cpplibostree {
+
+/// Cancellation flag of an operation, all copies share the same flag
+class CancellationToken {
+   public:
+    /// @brief Cancel the operation: it is skipped, if not started yet, or stops at its next
+    /// check (writes to the repository are never interrupted).
+    void Cancel();
+    /// Getter
+    [[nodiscard]] bool IsCancelled() const;
+
+   private:
+    std::shared_ptr<std::atomic<bool>> cancelled{std::make_shared<std::atomic<bool>>(false)};
+};
+
+/// Progress of an operation: done & total steps, called on the executor
+using ProgressCallback = std::function<void(size_t done, size_t total)>;
+
+/// Runs a task, e.g. on a worker thread
+using Executor = std::function<void(std::function<void()> task)>;
+
+/**
+ * @brief Executor, that submits the tasks to a thread pool. Tasks dropped by the pool (on
+ * destruction) leave their futures with a broken promise.
+ *
+ * @param pool Pool, has to outlive the executor.
+ * @param priority Priority of all submitted tasks.
+ */
+[[nodiscard]] Executor MakePoolExecutor(ThreadPool& pool,
+                                        TaskPriority priority = TaskPriority::NORMAL);
+
+/// Options of a single operation
+struct AsyncOptions {
+    ProgressCallback onProgress;
+    CancellationToken cancellation;
+};
+
+/// Result of AsyncRepo::PruneOrphanedCommits()
+struct PruneResult {
+    bool success{false};
+    size_t objectsPruned{0};
+    uint64_t bytesPruned{0};
+};
+
+class AsyncRepo {
+   public:
+    /**
+     * @brief Construct a new AsyncRepo.
+     *
+     * @param repo Repository, has to outlive all started operations.
+     * @param executor Executor for all operations.
+     */
+    AsyncRepo(OSTreeRepo& repo, Executor executor);
+
+    /**
+     * @brief Load the refs & commits without touching the loaded state (see
+     * OSTreeRepo::LoadRepoData()). Reports the walked branches & may be cancelled in between.
+     *
+     * @return Loaded data (to be applied with OSTreeRepo::ApplyRepoData() by the owner of the
+     * repository), or nothing if cancelled
+     */
+    [[nodiscard]] std::future<std::optional<RepoData>> Load(
+        const AsyncOptions& options = {}) const;
+
+    /**
+     * @brief Load the next older commits of all cut off branches (see
+     * OSTreeRepo::LoadHistoryPage()), e.g. to stream a large history in batches.
+     *
+     * @return Page (to be merged with OSTreeRepo::MergeHistoryPage() by the owner of the
+     * repository), empty if cancelled
+     */
+    [[nodiscard]] std::future<HistoryPage> LoadHistoryPage(
+        HistoryPageRequest request,
+        size_t pageSize,
+        const AsyncOptions& options = {}) const;
+
+    /**
+     * @brief Load & apply the refs & commits (see OSTreeRepo::UpdateData()) on the executor.
+     * Only for owners, that do not read the repository while the future is pending.
+     *
+     * @return true if applied, false if cancelled
+     */
+    [[nodiscard]] std::future<bool> Refresh(const AsyncOptions& options = {});
+
+    /// @brief See OSTreeRepo::PromoteCommit(), the loaded state is not changed.
+    [[nodiscard]] std::future<bool> PromoteCommit(
+        const std::string& hash,
+        const std::string& newRef,
+        const std::vector<std::string>& addMetadataStrings,
+        const std::string& newSubject = "",
+        bool keepMetadata = true,
+        const AsyncOptions& options = {});
+
+    /**
+     * @brief See OSTreeRepo::RemoveCommitFromBranchAndPrune(). The commit is looked up on the
+     * calling thread, the loaded state is not changed.
+     */
+    [[nodiscard]] std::future<bool> RemoveCommit(const Commit& commit,
+                                                 const AsyncOptions& options = {});
+
+    /// @brief See OSTreeRepo::PruneOrphanedCommits(), the loaded state is not changed.
+    [[nodiscard]] std::future<PruneResult> PruneOrphanedCommits(const AsyncOptions& options = {});
+
+    /**
+     * @brief See cpplibostree::ApplyRetention(), the loaded state is not changed.
+     *
+     * @return Statistics of the prune pass, or nothing if it failed (or got cancelled)
+     */
+    [[nodiscard]] std::future<std::optional<RetentionResult>> ApplyRetention(
+        const RetentionPlan& plan,
+        const AsyncOptions& options = {});
+
+    /// @brief See OSTreeRepo::GetCommitDetails().
+    [[nodiscard]] std::future<std::shared_ptr<const CommitDetails>> GetCommitDetails(
+        const std::string& hash,
+        const AsyncOptions& options = {}) const;
+
+   private:
+    /**
+     * @brief Run a function on the executor. If the operation is cancelled before it starts,
+     * the future holds a default constructed result instead.
+     */
+    template <typename Result, typename Function>
+    std::future<Result> run(const AsyncOptions& options, Function function) const {
+        auto promise = std::make_shared<std::promise<Result>>();
+        std::future<Result> future = promise->get_future();
+        executor([promise, cancellation = options.cancellation, function = std::move(function)] {
+            try {
+                promise->set_value(cancellation.IsCancelled() ? Result{} : function());
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        });
+        return future;
+    }
+
+    /// @brief Report a finished single step operation.
+    static void reportDone(const AsyncOptions& options);
+
+    OSTreeRepo& repo;
+    Executor executor;
+    std::mutex writeMutex;  // held while writing to the repository (or its loaded state)
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,99 @@
+#include "commitExport.hpp"
+
+// C++
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.hpp"
+
+namespace cpplibostree {
+
+namespace {
+int64_t toUnixSeconds(const Timepoint& timepoint) {
+    return std::chrono::duration_cast<std::chrono::seconds>(timepoint.time_since_epoch()).count();
+}
+
+std::string stringListToJson(const std::vector<std::string>& list) {
+    std::string out{"["};
+    for (size_t i{0}; i < list.size(); i++) {
+        out += (i == 0 ? "" : ",") + json::Quote(list.at(i));
+    }
+    return out + "]";
+}
+
+std::string signatureToJson(const Signature& signature) {
+    std::string out{"{"};
+    out += "\"scheme\":" + json::Quote(signature.scheme);
+    out += ",\"valid\":" + std::string(signature.valid ? "true" : "false");
+    out += ",\"sigExpired\":" + std::string(signature.sigExpired ? "true" : "false");
+    out += ",\"keyExpired\":" + std::string(signature.keyExpired ? "true" : "false");
+    out += ",\"keyRevoked\":" + std::string(signature.keyRevoked ? "true" : "false");
+    out += ",\"keyMissing\":" + std::string(signature.keyMissing ? "true" : "false");
+    out += ",\"fingerprint\":" + json::Quote(signature.fingerprint);
+    out += ",\"pubkeyAlgorithm\":" + json::Quote(signature.pubkeyAlgorithm);
+    out += ",\"username\":" + json::Quote(signature.username);
+    out += ",\"usermail\":" + json::Quote(signature.usermail);
+    out += ",\"timestamp\":" + std::to_string(toUnixSeconds(signature.timestamp));
+    return out + "}";
+}
+}  // namespace
+
+std::optional<ExportFormat> ParseExportFormat(std::string_view name) {
+    if (name == "json") {
+        return ExportFormat::JSON;
+    }
+    if (name == "ndjson") {
+        return ExportFormat::NDJSON;
+    }
+    return std::nullopt;
+}
+
+std::string CommitToJson(const Commit& commit,
+                         const CommitDetails& details,
+                         const std::vector<std::string>& refs) {
+    std::string out{"{"};
+    out += "\"hash\":" + json::Quote(commit.hash);
+    out += ",\"branch\":" + json::Quote(commit.branch);
+    out += ",\"refs\":" + stringListToJson(refs);
+    out += ",\"parent\":" + (commit.parent == "(no parent)" ? "null" : json::Quote(commit.parent));
+    out += ",\"timestamp\":" + std::to_string(toUnixSeconds(commit.timestamp));
+    out += ",\"subject\":" + json::Quote(commit.subject);
+    out += ",\"version\":" + (commit.version.empty() ? "null" : json::Quote(commit.version));
+    out += ",\"contentChecksum\":" + json::Quote(details.contentChecksum);
+    out += ",\"signed\":" + std::string(OSTreeRepo::IsCommitSigned(details) ? "true" : "false");
+    out += ",\"signatures\":[";
+    for (size_t i{0}; i < details.signatures.size(); i++) {
+        out += (i == 0 ? "" : ",") + signatureToJson(details.signatures.at(i));
+    }
+    return out + "]}";
+}
+
+bool ExportCommits(OSTreeRepo& repo, ExportFormat format, std::ostream& out) {
+    bool first{true};
+
+    if (format == ExportFormat::JSON) {
+        out << "[";
+    }
+    bool success = repo.StreamCommits([&](const Commit& commit, const CommitDetails& details,
+                                          const std::vector<std::string>& refs) {
+        const std::string record = CommitToJson(commit, details, refs);
+
+        if (format == ExportFormat::JSON) {
+            out << (first ? "\n" : ",\n") << record;
+        } else {
+            out << record << "\n";
+        }
+        first = false;
+    });
+    if (format == ExportFormat::JSON) {
+        out << (first ? "]\n" : "\n]\n");
+    }
+    out.flush();
+
+    return success && out.good();
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,54 @@
+/*_____________________________________________________________
+ | Commit Export
+ |   Non-interactive export of the commit graph as JSON or
+ |   NDJSON (one JSON record per line), streamed directly from
+ |   the loader.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpplibostree.hpp"
+
+namespace cpplibostree {
+
+enum class ExportFormat : uint8_t { JSON, NDJSON };
+
+/**
+ * @brief Parse an export format name ("json", or "ndjson").
+ *
+ * @param name Name of the format.
+ * @return Export format, or nothing if the name is unknown.
+ */
+[[nodiscard]] std::optional<ExportFormat> ParseExportFormat(std::string_view name);
+
+/**
+ * @brief Serialize a commit to a single line JSON object.
+ *
+ * @param commit Commit to serialize.
+ * @param details Details of the commit (see OSTreeRepo::GetCommitDetails()).
+ * @param refs Refs pointing directly to this commit.
+ * @return JSON object
+ */
+[[nodiscard]] std::string CommitToJson(const Commit& commit,
+                                       const CommitDetails& details,
+                                       const std::vector<std::string>& refs);
+
+/**
+ * @brief Write all commits of a repository to `out`. Every record is written as soon as
+ * the commit got decoded, the complete commit list is never built up.
+ *
+ * @param repo Repository to export (does not need to be loaded).
+ * @param format Output format.
+ * @param out Stream to write to.
+ * @return true on success
+ */
+bool ExportCommits(OSTreeRepo& repo, ExportFormat format, std::ostream& out);
+
+}  // namespace cpplibostree
@@ -0,0 +1,177 @@
+#include "commitIndex.hpp"
+
+// C++
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace cpplibostree {
+
+namespace {
+
+/// Value of a hex digit, or nothing for other characters
+std::optional<uint8_t> hexValue(char c) {
+    const auto lower = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (lower >= '0' && lower <= '9') {
+        return static_cast<uint8_t>(lower - '0');
+    }
+    if (lower >= 'a' && lower <= 'f') {
+        return static_cast<uint8_t>(lower - 'a' + 10);
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Decode a hex string into a checksum. Missing trailing digits are set to `fill`.
+ *
+ * @return Checksum, or nothing if the string is too long or not a hex string
+ */
+std::optional<BinaryChecksum> decodeChecksum(std::string_view hex, uint8_t fill) {
+    if (hex.size() > 2 * BinaryChecksum{}.size()) {
+        return std::nullopt;
+    }
+    BinaryChecksum checksum{};
+    for (size_t i{0}; i < 2 * checksum.size(); i++) {
+        std::optional<uint8_t> nibble = fill;
+        if (i < hex.size()) {
+            nibble = hexValue(hex[i]);
+            if (!nibble.has_value()) {
+                return std::nullopt;
+            }
+        }
+        checksum[i / 2] |= static_cast<uint8_t>(i % 2 == 0 ? nibble.value() << 4 : nibble.value());
+    }
+    return checksum;
+}
+
+}  // namespace
+
+// CommitIndex
+
+void CommitIndex::Build(const CommitList& commitList) {
+    runs.clear();
+    std::vector<Entry> run;
+    run.reserve(commitList.size());
+    for (const auto& [hash, commit] : commitList) {
+        addEntry(run, commit.hash);
+    }
+    addRun(std::move(run));
+}
+
+void CommitIndex::Append(const CommitList& commitList, const std::vector<std::string>& hashes) {
+    std::vector<Entry> run;
+    run.reserve(hashes.size());
+    for (const auto& hash : hashes) {
+        auto commit = commitList.find(hash);
+        if (commit != commitList.end()) {
+            addEntry(run, commit->second.hash);
+        }
+    }
+    addRun(std::move(run));
+}
+
+void CommitIndex::addEntry(std::vector<Entry>& run, std::string_view hash) {
+    // full hashes only, so that every checksum is unique
+    auto checksum = decodeChecksum(hash, 0);
+    if (hash.size() == 2 * BinaryChecksum{}.size() && checksum.has_value()) {
+        run.push_back({checksum.value(), hash});
+    }
+}
+
+void CommitIndex::addRun(std::vector<Entry> run) {
+    if (run.empty()) {
+        return;
+    }
+    auto byChecksum = [](const Entry& a, const Entry& b) { return a.checksum < b.checksum; };
+    std::sort(run.begin(), run.end(), byChecksum);
+
+    // merge with the smaller runs, so there are at most log n runs
+    while (!runs.empty() && runs.back().size() <= run.size()) {
+        std::vector<Entry> merged;
+        merged.reserve(runs.back().size() + run.size());
+        std::merge(runs.back().begin(), runs.back().end(), run.begin(), run.end(),
+                   std::back_inserter(merged), byChecksum);
+        runs.pop_back();
+        run = std::move(merged);
+    }
+    runs.push_back(std::move(run));
+}
+
+std::vector<std::string_view> CommitIndex::FindByPrefix(std::string_view prefix) const {
+    // all checksums with this prefix lie between the prefix padded with 0s and with Fs
+    auto lowest = decodeChecksum(prefix, 0x0);
+    auto highest = decodeChecksum(prefix, 0xF);
+    if (prefix.empty() || !lowest.has_value() || !highest.has_value()) {
+        return {};
+    }
+
+    std::vector<Entry> matches;
+    for (const auto& run : runs) {
+        auto first = std::lower_bound(
+            run.begin(), run.end(), lowest.value(),
+            [](const Entry& entry, const BinaryChecksum& value) { return entry.checksum < value; });
+        auto last = std::upper_bound(
+            first, run.end(), highest.value(),
+            [](const BinaryChecksum& value, const Entry& entry) { return value < entry.checksum; });
+        matches.insert(matches.end(), first, last);
+    }
+    std::sort(matches.begin(), matches.end(),
+              [](const Entry& a, const Entry& b) { return a.checksum < b.checksum; });
+
+    std::vector<std::string_view> hashes;
+    hashes.reserve(matches.size());
+    for (const auto& entry : matches) {
+        hashes.push_back(entry.hash);
+    }
+    return hashes;
+}
+
+size_t CommitIndex::GetSize() const {
+    size_t size{0};
+    for (const auto& run : runs) {
+        size += run.size();
+    }
+    return size;
+}
+
+// timeline
+
+std::optional<size_t> FindInTimeline(const std::vector<std::string>& timeline,
+                                     const CommitList& commitList,
+                                     Timepoint time) {
+    // timestamps are descending, so the newer commits form the first partition
+    auto position = std::partition_point(timeline.begin(), timeline.end(),
+                                         [&](const std::string& hash) {
+                                             return commitList.at(hash).timestamp > time;
+                                         });
+    if (position == timeline.end()) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(position - timeline.begin());
+}
+
+std::optional<size_t> FindInTimeline(const std::vector<std::string>& timeline,
+                                     const CommitList& commitList,
+                                     std::string_view hash) {
+    auto commit = commitList.find(hash);
+    if (commit == commitList.end()) {
+        return std::nullopt;
+    }
+    const Timepoint time = commit->second.timestamp;
+    auto first = std::partition_point(timeline.begin(), timeline.end(),
+                                      [&](const std::string& other) {
+                                          return commitList.at(other).timestamp > time;
+                                      });
+    // commits with the same timestamp are in no particular order
+    for (auto position = first;
+         position != timeline.end() && commitList.at(*position).timestamp == time; position++) {
+        if (*position == hash) {
+            return static_cast<size_t>(position - timeline.begin());
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,94 @@
+/*_____________________________________________________________
+ | Commit Index
+ |   Sorted binary checksums of all loaded commits, to resolve
+ |   (abbreviated) hashes by binary search, and binary search
+ |   over the timeline of the commit list view. Streamed pages
+ |   of older history are appended as sorted runs, merged like
+ |   a binary counter (O(n log n) in total).
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpplibostree.hpp"
+
+namespace cpplibostree {
+
+/// SHA256 commit checksum in binary form (half the size of the hex string)
+using BinaryChecksum = std::array<uint8_t, 32>;
+
+class CommitIndex {
+   public:
+    CommitIndex() = default;
+
+    /**
+     * @brief (Re-)Build the index.
+     *
+     * @param commitList All loaded commits (the index points to their hashes).
+     */
+    void Build(const CommitList& commitList);
+
+    /**
+     * @brief Add newly loaded commits to the index.
+     *
+     * @param commitList All loaded commits (the index points to their hashes).
+     * @param hashes Hashes of the commits, that are not indexed yet.
+     */
+    void Append(const CommitList& commitList, const std::vector<std::string>& hashes);
+
+    /**
+     * @brief Find all commits, whose hash starts with a hex prefix (case insensitive).
+     *
+     * @param prefix Abbreviated hash, like the first 8 characters.
+     * @return Matching commit hashes (empty, if the prefix is not a valid hex string)
+     */
+    [[nodiscard]] std::vector<std::string_view> FindByPrefix(std::string_view prefix) const;
+
+    /// Getter: amount of indexed commits
+    [[nodiscard]] size_t GetSize() const;
+
+   private:
+    struct Entry {
+        BinaryChecksum checksum;
+        std::string_view hash;  // points to Commit::hash
+    };
+    /// Add an entry for a full hash to a run (other hashes are skipped)
+    static void addEntry(std::vector<Entry>& run, std::string_view hash);
+    /// Sort a run & merge it with the trailing runs, that are not larger
+    void addRun(std::vector<Entry> run);
+
+    std::vector<std::vector<Entry>> runs;  // each sorted by checksum, sizes descending
+};
+
+/**
+ * @brief Find the newest commit of a timeline, that is not newer than a point in time.
+ *
+ * @param timeline Commit hashes sorted by descending timestamps (like the commit list view).
+ * @param commitList Commits of the timeline.
+ * @param time Point in time.
+ * @return Position in the timeline, or nothing if all commits are newer
+ */
+[[nodiscard]] std::optional<size_t> FindInTimeline(const std::vector<std::string>& timeline,
+                                                   const CommitList& commitList,
+                                                   Timepoint time);
+
+/**
+ * @brief Find the position of a commit in a timeline.
+ *
+ * @param timeline Commit hashes sorted by descending timestamps (like the commit list view).
+ * @param commitList Commits of the timeline.
+ * @param hash Hash of the commit.
+ * @return Position in the timeline, or nothing if the commit is not part of it
+ */
+[[nodiscard]] std::optional<size_t> FindInTimeline(const std::vector<std::string>& timeline,
+                                                   const CommitList& commitList,
+                                                   std::string_view hash);
+
+}  // namespace cpplibostree
@@ -0,0 +1,65 @@
+#include "commitMetadata.hpp"
+
+// C++
+#include <cstdint>
+#include <string>
+#include <string_view>
+// external
+#include <glib.h>
+
+#include "repoStatistics.hpp"
+
+namespace cpplibostree {
+
+namespace {
+std::string truncate(std::string_view value, size_t maxLength) {
+    if (value.size() <= maxLength) {
+        return std::string(value);
+    }
+    return std::string(value.substr(0, maxLength)) + "…";
+}
+}  // namespace
+
+size_t ForEachMetadataEntry(GVariant* metadata, const MetadataVisitor& visitor) {
+    if (metadata == nullptr || !g_variant_is_of_type(metadata, G_VARIANT_TYPE_VARDICT)) {
+        return 0;
+    }
+
+    size_t count{0};
+    GVariantIter iter;
+    const gchar* key{nullptr};
+    GVariant* value{nullptr};
+    g_variant_iter_init(&iter, metadata);
+    // `key` points into the serialized dictionary, `value` shares its buffer
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        visitor(key, value);
+        g_variant_unref(value);
+        count++;
+    }
+    return count;
+}
+
+std::string FormatMetadataValue(GVariant* value, size_t maxLength) {
+    if (value == nullptr) {
+        return "";
+    }
+
+    // strings are shown in place
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
+        gsize length{0};
+        const gchar* string = g_variant_get_string(value, &length);
+        return truncate(std::string_view(string, length), maxLength);
+    }
+
+    // binary data & large containers are only summarized, printing them would be expensive
+    const gsize size = g_variant_get_size(value);
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_BYTESTRING) || size > maxLength) {
+        return "<" + std::string(g_variant_get_type_string(value)) + ", " +
+               FormatByteSize(static_cast<uint64_t>(size)) + ">";
+    }
+
+    g_autofree gchar* printed = g_variant_print(value, FALSE);
+    return truncate(printed, maxLength);
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,46 @@
+/*_____________________________________________________________
+ | Commit Metadata
+ |   Lazy access to the a{sv} metadata of a commit & its
+ |   detached metadata (.commitmeta). Keys & string values are
+ |   read in place from the loaded variant, everything else is
+ |   only formatted when it is displayed.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+// external
+#include <glib.h>
+
+namespace cpplibostree {
+
+/// maximum length of a formatted metadata value
+constexpr size_t METADATA_VALUE_MAX_LENGTH{256};
+
+/// Visitor for ForEachMetadataEntry(), `key` & `value` are only valid during the call
+using MetadataVisitor = std::function<void(std::string_view key, GVariant* value)>;
+
+/**
+ * @brief Visit all entries of an a{sv} metadata dictionary, without copying any data.
+ *
+ * @param metadata a{sv} variant, may be nullptr.
+ * @param visitor Called once per entry.
+ * @return amount of visited entries
+ */
+size_t ForEachMetadataEntry(GVariant* metadata, const MetadataVisitor& visitor);
+
+/**
+ * @brief Format a single metadata value for display. Strings are shown as is, large binary
+ * values (e.g. signatures) only by their type & size.
+ *
+ * @param value Value of a metadata entry.
+ * @param maxLength Maximum length of the result, longer values get truncated.
+ * @return Human readable value
+ */
+[[nodiscard]] std::string FormatMetadataValue(GVariant* value,
+                                              size_t maxLength = METADATA_VALUE_MAX_LENGTH);
+
+}  // namespace cpplibostree
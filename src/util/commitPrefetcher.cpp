@@ -0,0 +1,129 @@
+#include "commitPrefetcher.hpp"
+
+// C++
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cpplibostree {
+
+CommitPrefetcher::CommitPrefetcher(ThreadPool& pool)
+    : pool(pool), state(std::make_shared<SharedState>()) {}
+
+void CommitPrefetcher::Update(const OSTreeRepo& repo,
+                              const std::vector<std::string>& commits,
+                              size_t selected) {
+    if (commits.empty() || (&repo == lastRepo && selected == lastSelected)) {
+        return;
+    }
+    selected = std::min(selected, commits.size() - 1);
+
+    const size_t distance =
+        selected > lastSelected ? selected - lastSelected : lastSelected - selected;
+    const bool forward = selected >= lastSelected;
+    if (&repo != lastRepo || distance > PREFETCH_AHEAD) {
+        state->generation++;
+    }
+    lastRepo = &repo;
+    lastSelected = selected;
+
+    // window around the selection, nearest commits in scroll direction first
+    std::vector<size_t> window;
+    for (size_t offset{1}; offset <= PREFETCH_AHEAD; offset++) {
+        if (forward && selected + offset < commits.size()) {
+            window.push_back(selected + offset);
+        } else if (!forward && offset <= selected) {
+            window.push_back(selected - offset);
+        }
+    }
+    for (size_t offset{1}; offset <= PREFETCH_BEHIND; offset++) {
+        if (!forward && selected + offset < commits.size()) {
+            window.push_back(selected + offset);
+        } else if (forward && offset <= selected) {
+            window.push_back(selected - offset);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->statistics.window = window.size();
+    }
+
+    for (const size_t index : window) {
+        fetch(repo, commits.at(index), TaskPriority::LOW, {});
+    }
+}
+
+std::shared_ptr<const CommitDetails> CommitPrefetcher::GetDetails(
+    const OSTreeRepo& repo,
+    const std::string& hash,
+    const std::function<void()>& onFetched) {
+    auto details = repo.FindCommitDetails(hash);
+    if (hash == lastSelectedHash) {
+        return details;
+    }
+    lastSelectedHash = hash;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        (details != nullptr ? state->statistics.hits : state->statistics.misses)++;
+    }
+    if (details != nullptr) {
+        return details;
+    }
+    if (!onFetched) {
+        return repo.GetCommitDetails(hash);
+    }
+    fetch(repo, hash, TaskPriority::NORMAL, onFetched);
+    return nullptr;
+}
+
+PrefetchStatistics CommitPrefetcher::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->statistics;
+}
+
+void CommitPrefetcher::fetch(const OSTreeRepo& repo,
+                             const std::string& hash,
+                             TaskPriority priority,
+                             const std::function<void()>& onFetched) {
+    auto commit = repo.GetCommitList().find(hash);
+    if (commit == repo.GetCommitList().end()) {
+        return;
+    }
+    if (repo.FindCommitDetails(hash) != nullptr && repo.GetCommitSize(hash).has_value()) {
+        return;
+    }
+    // on-demand fetches may overtake a queued prefetch of the same commit
+    if (priority == TaskPriority::LOW) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->queued.insert(hash).second) {
+            return;
+        }
+    }
+
+    // copy the parent, the commit list might be reloaded before the task runs
+    pool.Submit(
+        [sharedState = state, model = &repo, hash, parent = std::string(commit->second.parent),
+         generation = state->generation.load(), priority, onFetched] {
+            const bool cancelled =
+                priority == TaskPriority::LOW && generation != sharedState->generation;
+            if (!cancelled) {
+                // both results are cached by the repository
+                static_cast<void>(model->GetCommitDetails(hash));
+                model->ComputeCommitSize(hash, parent);
+            }
+            if (priority == TaskPriority::LOW) {
+                std::lock_guard<std::mutex> lock(sharedState->mutex);
+                sharedState->queued.erase(hash);
+                sharedState->statistics.cancelled += cancelled ? 1 : 0;
+            }
+            if (!cancelled && onFetched) {
+                onFetched();
+            }
+        },
+        priority);
+}
+
+}  // namespace cpplibostree
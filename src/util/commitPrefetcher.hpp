@@ -0,0 +1,90 @@
+/*_____________________________________________________________
+ | Commit Prefetcher
+ |   Follows the selection in the commit list and decodes the
+ |   details & sizes of the neighboring commits in the
+ |   background, so that the info view does not have to wait.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "cpplibostree.hpp"
+#include "threadPool.hpp"
+
+namespace cpplibostree {
+
+/// commits prefetched in scroll direction
+constexpr size_t PREFETCH_AHEAD{8};
+/// commits prefetched against scroll direction
+constexpr size_t PREFETCH_BEHIND{2};
+
+struct PrefetchStatistics {
+    size_t window{0};     // commits around the last selection
+    size_t hits{0};       // selected commits, that were already decoded
+    size_t misses{0};     // selected commits, that had to be decoded on demand
+    size_t cancelled{0};  // queued prefetches dropped after a jump
+};
+
+class CommitPrefetcher {
+   public:
+    explicit CommitPrefetcher(ThreadPool& pool);
+
+    /**
+     * @brief Follow the selection: Queue the commits around it (mostly in scroll direction) for
+     * decoding at low priority. Jumps (further than the window, or into another repository)
+     * cancel all prefetches, that have not been started yet.
+     *
+     * @param repo Repository of the commits, has to outlive the pool.
+     * @param commits Hashes of the listed commits, in list order.
+     * @param selected Index of the selected commit.
+     */
+    void Update(const OSTreeRepo& repo, const std::vector<std::string>& commits, size_t selected);
+
+    /**
+     * @brief Get the details of the selected commit. Counts a hit, or a miss once per commit.
+     *
+     * @param repo Repository of the commit.
+     * @param hash Hash of the selected commit.
+     * @param onFetched On a miss, the commit is decoded in the background with normal
+     * priority & this is called once it is done. Without a callback, the commit is decoded right
+     * away on the calling thread.
+     * @return Details, or nullptr if they are not decoded yet
+     */
+    std::shared_ptr<const CommitDetails> GetDetails(const OSTreeRepo& repo,
+                                                    const std::string& hash,
+                                                    const std::function<void()>& onFetched = {});
+
+    /// Getter
+    [[nodiscard]] PrefetchStatistics GetStatistics() const;
+
+   private:
+    /// state shared with the worker tasks, so that they may outlive the prefetcher
+    struct SharedState {
+        mutable std::mutex mutex;
+        std::atomic<size_t> generation{0};  // incremented on jumps, cancels older prefetches
+        std::unordered_set<std::string> queued;
+        PrefetchStatistics statistics;
+    };
+
+    /// @brief Decode details & size of a commit on the pool.
+    void fetch(const OSTreeRepo& repo,
+               const std::string& hash,
+               TaskPriority priority,
+               const std::function<void()>& onFetched);
+
+    ThreadPool& pool;
+    std::shared_ptr<SharedState> state;
+    const OSTreeRepo* lastRepo{nullptr};
+    size_t lastSelected{0};
+    std::string lastSelectedHash;  // hits & misses are only counted once per selection
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,179 @@
+#include "commitReader.hpp"
+
+// C++
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+// C
+#include <fcntl.h>
+#include <unistd.h>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+namespace cpplibostree {
+
+namespace {
+
+/// @brief Path of a commit object, relative to objects/.
+std::string commitObjectPath(const char* checksum) {
+    return std::string(checksum, 2) + "/" + std::string(checksum + 2) + ".commit";
+}
+
+/**
+ * @brief Walk the history of all refs.
+ *
+ * @param repo Opened repository.
+ * @param reader Reader to load the commits with.
+ * @param visitor Called with every loaded commit hash (may repeat shared history).
+ * @return Amount of loaded commits
+ */
+size_t walkAllRefs(OstreeRepo* repo,
+                   const CommitReader& reader,
+                   const std::function<void(const char* hash)>& visitor) {
+    GHashTable* refs{nullptr};
+    if (!ostree_repo_list_refs_ext(repo, nullptr, &refs, OSTREE_REPO_LIST_REFS_EXT_NONE, nullptr,
+                                   nullptr)) {
+        return 0;
+    }
+    size_t loaded{0};
+    GHashTableIter iter;
+    gpointer value{nullptr};
+    g_hash_table_iter_init(&iter, refs);
+    while (g_hash_table_iter_next(&iter, nullptr, &value)) {
+        g_autofree char* current = g_strdup(static_cast<const char*>(value));
+        while (current != nullptr) {
+            g_autoptr(GVariant) variant = nullptr;
+            if (!reader.Load(current, &variant, nullptr)) {
+                break;
+            }
+            visitor(current);
+            loaded++;
+            char* parent = ostree_commit_get_parent(variant);
+            g_free(current);
+            current = parent;
+        }
+    }
+    g_hash_table_unref(refs);
+    return loaded;
+}
+
+/// @brief Drop the object files of commits from the page cache.
+void evictCommitObjects(OstreeRepo* repo, const std::vector<std::string>& hashes) {
+    for (const auto& hash : hashes) {
+        const std::string path = "objects/" + commitObjectPath(hash.c_str());
+        const int fd = openat(ostree_repo_get_dfd(repo), path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+}  // namespace
+
+CommitReader::CommitReader(OstreeRepo* repo, bool mapObjects) : repo(repo) {
+    if (mapObjects) {
+        objectsDfd =
+            openat(ostree_repo_get_dfd(repo), "objects", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+}
+
+CommitReader::~CommitReader() {
+    if (objectsDfd >= 0) {
+        close(objectsDfd);
+    }
+}
+
+bool CommitReader::Load(const char* checksum, GVariant** variant, GError** error) const {
+    if (GVariant* mapped = mapCommit(checksum); mapped != nullptr) {
+        *variant = mapped;
+        mappedCount++;
+        return true;
+    }
+    fallbackCount++;
+    return ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, checksum, variant, error);
+}
+
+size_t CommitReader::GetMappedCount() const {
+    return mappedCount;
+}
+
+size_t CommitReader::GetFallbackCount() const {
+    return fallbackCount;
+}
+
+GVariant* CommitReader::mapCommit(const char* checksum) const {
+    // the checksum becomes part of a path -> only accept real ones
+    if (objectsDfd < 0 || !ostree_validate_checksum_string(checksum, nullptr)) {
+        return nullptr;
+    }
+    const int fd = openat(objectsDfd, commitObjectPath(checksum).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    // the mapping stays valid after closing the file
+    GMappedFile* file = g_mapped_file_new_from_fd(fd, FALSE, nullptr);
+    close(fd);
+    if (file == nullptr) {
+        return nullptr;
+    }
+    if (g_mapped_file_get_length(file) == 0) {
+        g_mapped_file_unref(file);
+        return nullptr;
+    }
+    // the bytes (and the variant) keep the mapping alive; objects are content addressed and
+    // never modified, so the variant can be trusted like libostree does
+    GBytes* bytes = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+    GVariant* variant =
+        g_variant_ref_sink(g_variant_new_from_bytes(OSTREE_COMMIT_GVARIANT_FORMAT, bytes, TRUE));
+    g_bytes_unref(bytes);
+    return variant;
+}
+
+bool BenchmarkCommitReaders(const std::string& repoPath, std::ostream& out) {
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    // all commits, to evict them before the cold runs
+    std::vector<std::string> hashes;
+    {
+        const CommitReader reader(repo, false);
+        walkAllRefs(repo, reader, [&](const char* hash) { hashes.emplace_back(hash); });
+    }
+
+    for (const bool mapObjects : {false, true}) {
+        for (const bool cold : {true, false}) {
+            if (cold) {
+                evictCommitObjects(repo, hashes);
+            }
+            const CommitReader reader(repo, mapObjects);
+            const auto start = std::chrono::steady_clock::now();
+            const size_t loaded = walkAllRefs(repo, reader, [](const char*) {});
+            const Milliseconds duration(std::chrono::steady_clock::now() - start);
+            out << std::left << std::setw(10) << (mapObjects ? "mmap" : "libostree")
+                << std::setw(6) << (cold ? "cold" : "warm") << std::right << std::fixed
+                << std::setprecision(3) << std::setw(12) << duration.count() << " ms  ("
+                << loaded << " commits, " << reader.GetMappedCount() << " mapped, "
+                << reader.GetFallbackCount() << " via libostree)\n";
+        }
+    }
+
+    g_object_unref(repo);
+    return true;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,70 @@
+/*_____________________________________________________________
+ | Commit Reader
+ |   Loads commit objects by memory-mapping their files
+ |   (objects/xx/yyyy.commit, stored the same way in all repo
+ |   modes) & wrapping them in zero-copy, trusted GVariants.
+ |   Anything unusual (object only in a parent repository, or
+ |   still being staged, ...) falls back to libostree.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstddef>
+#include <ostream>
+#include <string>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+namespace cpplibostree {
+
+class CommitReader {
+   public:
+    /**
+     * @brief Construct a new CommitReader.
+     *
+     * @param repo Opened repository, needs to outlive the reader.
+     * @param mapObjects Use the memory-mapped fast path (false = libostree only).
+     */
+    explicit CommitReader(OstreeRepo* repo, bool mapObjects = true);
+    ~CommitReader();
+    CommitReader(const CommitReader&) = delete;
+    CommitReader& operator=(const CommitReader&) = delete;
+
+    /**
+     * @brief Load a commit object (drop-in for `ostree_repo_load_variant()`).
+     *
+     * @param checksum Hash of the commit.
+     * @param variant Set to the commit variant (owned by the caller).
+     * @param error Set, if the commit could not be loaded by libostree either.
+     * @return true on success
+     */
+    bool Load(const char* checksum, GVariant** variant, GError** error) const;
+
+    /// Getter: commits loaded through the memory-mapped fast path
+    [[nodiscard]] size_t GetMappedCount() const;
+    /// Getter: commits loaded through libostree
+    [[nodiscard]] size_t GetFallbackCount() const;
+
+   private:
+    /// @brief Memory-map the object file of a commit, nullptr if that is not possible.
+    [[nodiscard]] GVariant* mapCommit(const char* checksum) const;
+
+    OstreeRepo* repo;
+    int objectsDfd{-1};  // objects/ directory of the repository, -1 = fast path disabled
+    mutable size_t mappedCount{0};
+    mutable size_t fallbackCount{0};
+};
+
+/**
+ * @brief Compare the memory-mapped reader with libostree: walk the history of all refs with
+ * both on a cold page cache (object files evicted with `posix_fadvise()`) and a warm one and
+ * write the timings to `out`.
+ *
+ * @param repoPath Path to the OSTree repository.
+ * @param out Stream to write to.
+ * @return true on success
+ */
+bool BenchmarkCommitReaders(const std::string& repoPath, std::ostream& out);
+
+}  // namespace cpplibostree
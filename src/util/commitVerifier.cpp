@@ -0,0 +1,238 @@
+#include "commitVerifier.hpp"
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+// C
+#include <fcntl.h>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+namespace cpplibostree {
+
+namespace {
+
+/**
+ * @brief Re-hash the content of a single object (the same way `ostree fsck` does). The hash
+ * implementation is the one libostree was built with (e.g. OpenSSL, which uses the SHA
+ * extensions of the CPU, if available).
+ *
+ * @param repo Opened repository.
+ * @param checksum Expected checksum of the object.
+ * @param type Type of the object.
+ * @param bytes Set to the size of the hashed content.
+ * @return Reason, if the object is broken
+ */
+std::optional<std::string> verifyObject(OstreeRepo* repo,
+                                        const std::string& checksum,
+                                        OstreeObjectType type,
+                                        uint64_t& bytes) {
+    GError* error{nullptr};
+    g_autoptr(GInputStream) input = nullptr;
+    g_autoptr(GFileInfo) fileInfo = nullptr;
+    g_autoptr(GVariant) xattrs = nullptr;
+    g_autofree guchar* computed = nullptr;
+
+    bool hashed{false};
+    if (type == OSTREE_OBJECT_TYPE_FILE) {
+        hashed = ostree_repo_load_file(repo, checksum.c_str(), &input, &fileInfo, &xattrs, nullptr,
+                                       &error);
+        bytes = hashed ? static_cast<uint64_t>(g_file_info_get_size(fileInfo)) : 0;
+    } else {
+        guint64 size{0};
+        hashed = ostree_repo_load_object_stream(repo, type, checksum.c_str(), &input, &size,
+                                                nullptr, &error);
+        bytes = size;
+    }
+    hashed = hashed && ostree_checksum_file_from_input(fileInfo, xattrs, input, type, &computed,
+                                                       nullptr, &error);
+    if (!hashed) {
+        std::string reason = error != nullptr ? error->message : "unreadable";
+        if (error != nullptr) {
+            g_error_free(error);
+        }
+        return reason;
+    }
+
+    g_autofree char* actual = ostree_checksum_from_bytes(computed);
+    if (checksum != actual) {
+        return "checksum mismatch, content hashes to " + std::string(actual);
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+double VerifyProgress::GetThroughput() const {
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? static_cast<double>(bytesHashed) / seconds : 0.0;
+}
+
+CommitVerifier::CommitVerifier(ThreadPool& pool)
+    : pool(pool), state(std::make_shared<SharedState>()) {}
+
+bool CommitVerifier::Start(const std::string& repoPath,
+                           const std::string& hash,
+                           std::function<void()> onProgress) {
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->progress.running) {
+            return false;
+        }
+        state->progress = VerifyProgress{};
+        state->progress.hash = hash;
+        state->progress.running = true;
+        state->start = std::chrono::steady_clock::now();
+        state->bytesHashed = 0;
+        state->batchesLeft = 0;
+        state->onProgress = std::move(onProgress);
+    }
+    pool.Submit([sharedState = state, &threadPool = pool, repoPath, hash] {
+        listObjects(sharedState, threadPool, repoPath, hash);
+    });
+    return true;
+}
+
+void CommitVerifier::Wait() const {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return !state->progress.running; });
+}
+
+std::optional<VerifyProgress> CommitVerifier::GetProgress() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->progress.hash.empty()) {
+        return std::nullopt;
+    }
+    VerifyProgress progress = state->progress;
+    progress.bytesHashed = state->bytesHashed.load();
+    if (progress.running) {
+        progress.elapsed = std::chrono::steady_clock::now() - state->start;
+    }
+    return progress;
+}
+
+void CommitVerifier::listObjects(const std::shared_ptr<SharedState>& state,
+                                 ThreadPool& pool,
+                                 const std::string& repoPath,
+                                 const std::string& hash) {
+    // objects of this commit only, not of its parents (maxdepth 0)
+    std::vector<ObjectName> objects;
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    GHashTable* reachable{nullptr};
+    if (repo != nullptr &&
+        ostree_repo_traverse_commit(repo, hash.c_str(), 0, &reachable, nullptr, &error)) {
+        GHashTableIter iter;
+        gpointer key{nullptr};
+        g_hash_table_iter_init(&iter, reachable);
+        while (g_hash_table_iter_next(&iter, &key, nullptr)) {
+            const char* checksum{nullptr};
+            OstreeObjectType type{};
+            ostree_object_name_deserialize(static_cast<GVariant*>(key), &checksum, &type);
+            objects.emplace_back(checksum, static_cast<int>(type));
+        }
+        g_hash_table_unref(reachable);
+    }
+    if (repo != nullptr) {
+        g_object_unref(repo);
+    }
+
+    // a missing dirtree, or dirmeta already stops the traversal
+    std::vector<std::string> problems;
+    if (error != nullptr) {
+        problems.push_back(hash + ".commit: " + error->message);
+        g_error_free(error);
+    }
+
+    const size_t batches = (objects.size() + VERIFY_BATCH_SIZE - 1) / VERIFY_BATCH_SIZE;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->progress.objectsTotal = objects.size();
+        // this task counts as a batch, so that the verification can't finish before it returns
+        state->batchesLeft = batches + 1;
+    }
+    for (size_t first{0}; first < objects.size(); first += VERIFY_BATCH_SIZE) {
+        const size_t last = std::min(first + VERIFY_BATCH_SIZE, objects.size());
+        std::vector<ObjectName> batch(
+            std::make_move_iterator(objects.begin() + static_cast<std::ptrdiff_t>(first)),
+            std::make_move_iterator(objects.begin() + static_cast<std::ptrdiff_t>(last)));
+        pool.Submit([state, repoPath, batch = std::move(batch)] {
+            verifyBatch(state, repoPath, batch);
+        });
+    }
+    finishBatch(state, 0, 0, std::move(problems));
+}
+
+void CommitVerifier::verifyBatch(const std::shared_ptr<SharedState>& state,
+                                 const std::string& repoPath,
+                                 const std::vector<ObjectName>& batch) {
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        std::string reason = "repository: " + std::string(error->message);
+        g_error_free(error);
+        finishBatch(state, batch.size(), 0, {std::move(reason)});
+        return;
+    }
+
+    size_t skipped{0};
+    std::vector<std::string> problems;
+    for (const auto& [checksum, type] : batch) {
+        const auto objectType = static_cast<OstreeObjectType>(type);
+        std::string name = checksum + "." + ostree_object_type_to_string(objectType);
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->verifiedObjects.contains(name)) {
+                skipped++;
+                continue;
+            }
+        }
+        uint64_t bytes{0};
+        auto problem = verifyObject(repo, checksum, objectType, bytes);
+        state->bytesHashed += bytes;
+        if (problem.has_value()) {
+            problems.push_back(name + ": " + problem.value());
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->verifiedObjects.insert(std::move(name));
+    }
+    g_object_unref(repo);
+    finishBatch(state, batch.size(), skipped, std::move(problems));
+}
+
+void CommitVerifier::finishBatch(const std::shared_ptr<SharedState>& state,
+                                 size_t done,
+                                 size_t skipped,
+                                 std::vector<std::string>&& problems) {
+    std::function<void()> onProgress;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        VerifyProgress& progress = state->progress;
+        progress.objectsDone += done;
+        progress.objectsSkipped += skipped;
+        progress.objectsBroken += problems.size();
+        for (auto& problem : problems) {
+            if (progress.problems.size() >= VERIFY_MAX_LISTED_PROBLEMS) {
+                break;
+            }
+            progress.problems.push_back(std::move(problem));
+        }
+        if (--state->batchesLeft == 0) {
+            progress.running = false;
+            progress.elapsed = std::chrono::steady_clock::now() - state->start;
+            state->finished.notify_all();
+        }
+        onProgress = state->onProgress;
+    }
+    if (onProgress) {
+        onProgress();
+    }
+}
+
+}  // namespace cpplibostree
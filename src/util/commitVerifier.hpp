@@ -0,0 +1,110 @@
+/*_____________________________________________________________
+ | Commit Verifier
+ |   Checks, that all objects of a commit are present & not
+ |   corrupted (like `ostree fsck` for a single commit): the
+ |   content of every object is re-hashed in batches on a
+ |   ThreadPool. Objects verified once are skipped for the
+ |   rest of the session.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "threadPool.hpp"
+
+namespace cpplibostree {
+
+/// objects re-hashed per pool task
+constexpr size_t VERIFY_BATCH_SIZE{128};
+/// problems listed in VerifyProgress::problems, further ones are only counted
+constexpr size_t VERIFY_MAX_LISTED_PROBLEMS{16};
+
+struct VerifyProgress {
+    std::string hash;  // verified commit
+    bool running{false};
+    size_t objectsTotal{0};    // all objects of the commit, 0 until they are listed
+    size_t objectsDone{0};     // including skipped & broken ones
+    size_t objectsSkipped{0};  // already verified earlier in this session
+    size_t objectsBroken{0};   // missing, unreadable, or checksum mismatch
+    uint64_t bytesHashed{0};
+    std::chrono::steady_clock::duration elapsed{0};
+    std::vector<std::string> problems;  // "<object>: <reason>"
+
+    /// @brief Hashed bytes per second.
+    [[nodiscard]] double GetThroughput() const;
+};
+
+class CommitVerifier {
+   public:
+    explicit CommitVerifier(ThreadPool& pool);
+
+    /**
+     * @brief Start verifying all objects of a commit in the background, unless a verification
+     * is already running.
+     *
+     * @param repoPath Path to the OSTree repository.
+     * @param hash Commit to verify.
+     * @param onProgress Called from a worker thread, whenever a batch got verified.
+     * @return true if the verification was started
+     */
+    bool Start(const std::string& repoPath, const std::string& hash,
+               std::function<void()> onProgress);
+
+    /// @brief Block until the running verification (if any) is finished.
+    void Wait() const;
+
+    /// Getter: running, or last finished verification, if any
+    [[nodiscard]] std::optional<VerifyProgress> GetProgress() const;
+
+   private:
+    /// state shared with the worker tasks, so that they may outlive the verifier
+    struct SharedState {
+        std::mutex mutex;
+        std::condition_variable finished;
+        VerifyProgress progress;
+        std::chrono::steady_clock::time_point start;
+        std::atomic<uint64_t> bytesHashed{0};
+        size_t batchesLeft{0};
+        std::function<void()> onProgress;
+        std::unordered_set<std::string> verifiedObjects;  // "<checksum>.<type>", whole session
+    };
+
+    /// object checksum & OstreeObjectType
+    using ObjectName = std::pair<std::string, int>;
+
+    /// @brief Lists the objects of the commit & submits the verification batches.
+    static void listObjects(const std::shared_ptr<SharedState>& state,
+                            ThreadPool& pool,
+                            const std::string& repoPath,
+                            const std::string& hash);
+
+    /// @brief Re-hashes a batch of objects & merges the result into the progress.
+    static void verifyBatch(const std::shared_ptr<SharedState>& state,
+                            const std::string& repoPath,
+                            const std::vector<ObjectName>& batch);
+
+    /// @brief Merges the counters & problems of a batch into the progress & finishes the
+    /// verification after the last batch.
+    static void finishBatch(const std::shared_ptr<SharedState>& state,
+                            size_t done,
+                            size_t skipped,
+                            std::vector<std::string>&& problems);
+
+    ThreadPool& pool;
+    std::shared_ptr<SharedState> state;
+};
+
+}  // namespace cpplibostree
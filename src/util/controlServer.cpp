@@ -0,0 +1,517 @@
+#include "controlServer.hpp"
+#include "unixSocket.hpp"
+
+// C++
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+// C
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+namespace cpplibostree {
+
+namespace {
+
+// JSON-RPC 2.0 error codes
+constexpr int PARSE_ERROR{-32700};
+constexpr int INVALID_REQUEST{-32600};
+constexpr int METHOD_NOT_FOUND{-32601};
+constexpr int INVALID_PARAMS{-32602};
+constexpr int ACTION_FAILED{-32000};
+
+/// maximum length of a request line, longer ones disconnect the client
+constexpr size_t MAX_REQUEST_SIZE{1024 * 1024};
+/// interval, in which finished actions are answered
+constexpr std::chrono::milliseconds ACTION_POLL_INTERVAL{20};
+/// default amount of results of a search
+constexpr size_t DEFAULT_SEARCH_LIMIT{100};
+
+/// @brief Check, if a text contains control characters (also line breaks).
+bool hasControlCharacters(std::string_view text) {
+    return std::any_of(text.begin(), text.end(),
+                       [](char c) { return std::iscntrl(static_cast<unsigned char>(c)) != 0; });
+}
+
+std::string resultResponse(const json::Value& id, const std::string& result) {
+    return "{\"jsonrpc\":\"2.0\",\"id\":" + json::Serialize(id) + ",\"result\":" + result + "}\n";
+}
+
+std::string errorResponse(const json::Value& id, int code, const std::string& message) {
+    return "{\"jsonrpc\":\"2.0\",\"id\":" + json::Serialize(id) +
+           ",\"error\":{\"code\":" + std::to_string(code) +
+           ",\"message\":" + json::Quote(message) + "}}\n";
+}
+
+std::string commitToJson(const Commit& commit) {
+    const int64_t timestamp =
+        std::chrono::duration_cast<std::chrono::seconds>(commit.timestamp.time_since_epoch())
+            .count();
+    return "{\"hash\":" + json::Quote(commit.hash) + ",\"branch\":" + json::Quote(commit.branch) +
+           ",\"parent\":" + json::Quote(commit.parent) +
+           ",\"subject\":" + json::Quote(commit.subject) +
+           ",\"version\":" + json::Quote(commit.version) +
+           ",\"timestamp\":" + std::to_string(timestamp) + "}";
+}
+
+std::string toLower(std::string_view text) {
+    std::string out(text);
+    std::transform(out.begin(), out.end(), out.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+/// @brief Case insensitive substring search, `query` is lower case already.
+bool containsLower(std::string_view text, const std::string& query) {
+    return toLower(text).find(query) != std::string::npos;
+}
+
+}  // namespace
+
+std::unique_ptr<ModelSnapshot> ModelSnapshot::Capture(const OSTreeRepo& repo) {
+    auto snapshot = std::make_unique<ModelSnapshot>();
+    snapshot->arenas = repo.GetCommitArenas();
+    snapshot->commits = repo.GetCommitList();
+    snapshot->branches = repo.GetBranches();
+    snapshot->branchHeads = repo.GetBranchHeads();
+    return snapshot;
+}
+
+ControlServer::ControlServer(std::string socketPath,
+                             std::vector<const OSTreeRepo*> repos,
+                             ThreadPool& pool,
+                             ControlActionHandler onAction)
+    : socketPath(std::move(socketPath)),
+      repos(std::move(repos)),
+      pool(pool),
+      onAction(std::move(onAction)) {}
+
+ControlServer::~ControlServer() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        eventfd_write(wakeFd, 1);
+        thread.join();
+    }
+    for (const auto& client : clients) {
+        ::close(client.fd);
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+    }
+    if (wakeFd >= 0) {
+        ::close(wakeFd);
+    }
+}
+
+bool ControlServer::Start() {
+    std::string error;
+    listenFd = ListenUnixSocket(socketPath, error);
+    if (listenFd < 0) {
+        g_printerr("Error opening control socket %s: %s\n", socketPath.c_str(), error.c_str());
+        return false;
+    }
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd < 0) {
+        g_printerr("Error opening control socket %s: can't create eventfd\n", socketPath.c_str());
+        return false;
+    }
+    snapshots.resize(repos.size());
+    thread = std::thread([this] { serve(); });
+    return true;
+}
+
+void ControlServer::Publish(size_t repo, std::unique_ptr<ModelSnapshot> snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        published[repo] = std::move(snapshot);
+    }
+    eventfd_write(wakeFd, 1);
+}
+
+void ControlServer::serve() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+        }
+        takePublishedSnapshots();
+
+        // answer finished actions
+        std::erase_if(pendingActions, [this](PendingAction& action) {
+            if (action.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return false;
+            }
+            auto client = std::find_if(clients.begin(), clients.end(), [&](const Client& c) {
+                return c.id == action.client;
+            });
+            if (client != clients.end()) {
+                client->output += action.result.get()
+                                      ? resultResponse(action.requestId, "true")
+                                      : errorResponse(action.requestId, ACTION_FAILED,
+                                                      "action failed");
+            }
+            return true;
+        });
+
+        std::vector<pollfd> fds;
+        fds.push_back({listenFd, POLLIN, 0});
+        fds.push_back({wakeFd, POLLIN, 0});
+        for (const auto& client : clients) {
+            fds.push_back(
+                {client.fd, static_cast<short>(client.output.empty() ? POLLIN : POLLIN | POLLOUT),
+                 0});
+        }
+        const int timeout =
+            pendingActions.empty() ? -1 : static_cast<int>(ACTION_POLL_INTERVAL.count());
+        if (::poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) {
+            g_printerr("Error on control socket %s\n", socketPath.c_str());
+            return;
+        }
+        if ((fds[1].revents & POLLIN) != 0) {
+            eventfd_t value{0};
+            eventfd_read(wakeFd, &value);
+        }
+
+        // clients first, accepting appends to the list
+        for (size_t i{0}; i + 2 < fds.size(); i++) {
+            Client& client = clients[i];
+            const short events = fds[i + 2].revents;
+            bool connected{true};
+            if ((events & (POLLIN | POLLHUP | POLLERR)) != 0) {
+                connected = readRequests(client);
+            }
+            while (connected && (events & POLLOUT) != 0 && !client.output.empty()) {
+                const ssize_t sent = ::send(client.fd, client.output.data(), client.output.size(),
+                                            MSG_NOSIGNAL);
+                if (sent < 0) {
+                    connected = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+                    break;
+                }
+                client.output.erase(0, static_cast<size_t>(sent));
+            }
+            if (!connected) {
+                ::close(client.fd);
+                client.fd = -1;
+            }
+        }
+        std::erase_if(clients, [](const Client& client) { return client.fd < 0; });
+        if ((fds.front().revents & POLLIN) != 0) {
+            const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd >= 0) {
+                Client client;
+                client.id = nextClientId++;
+                client.fd = fd;
+                clients.push_back(std::move(client));
+            }
+        }
+    }
+}
+
+void ControlServer::takePublishedSnapshots() {
+    std::unordered_map<size_t, std::unique_ptr<ModelSnapshot>> taken;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        taken.swap(published);
+    }
+    for (auto& [repo, snapshot] : taken) {
+        snapshot->commitIndex.Build(snapshot->commits);
+        snapshot->reachability.Build(snapshot->commits, snapshot->branchHeads);
+        // requests, that are answered meanwhile, keep the previous snapshot
+        snapshots.at(repo) = std::move(snapshot);
+    }
+}
+
+bool ControlServer::readRequests(Client& client) {
+    char chunk[4096];
+    while (true) {
+        const ssize_t received = ::recv(client.fd, chunk, sizeof(chunk), 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
+        client.input.append(chunk, static_cast<size_t>(received));
+    }
+
+    size_t lineEnd{0};
+    while ((lineEnd = client.input.find('\n')) != std::string::npos) {
+        const std::string line = client.input.substr(0, lineEnd);
+        client.input.erase(0, lineEnd + 1);
+        if (line.find_first_not_of(" \t\r") != std::string::npos) {
+            client.output += handleRequest(client, line);
+        }
+    }
+    return client.input.size() <= MAX_REQUEST_SIZE;
+}
+
+std::string ControlServer::handleRequest(const Client& client, const std::string& line) {
+    const json::Value noId;
+    auto request = json::Parse(line);
+    if (!request.has_value()) {
+        return errorResponse(noId, PARSE_ERROR, "parse error");
+    }
+    const json::Value* idValue = request->Find("id");
+    const json::Value* methodValue = request->Find("method");
+    if (request->type != json::Value::Type::OBJECT || methodValue == nullptr ||
+        methodValue->type != json::Value::Type::STRING) {
+        return errorResponse(idValue != nullptr ? *idValue : noId, INVALID_REQUEST,
+                             "invalid request");
+    }
+    // requests without an id are notifications, that are never answered
+    const bool notification = idValue == nullptr;
+    const json::Value id = notification ? noId : *idValue;
+    const std::string& method = methodValue->string;
+
+    json::Value params;
+    params.type = json::Value::Type::OBJECT;
+    if (const json::Value* paramsValue = request->Find("params"); paramsValue != nullptr) {
+        if (paramsValue->type != json::Value::Type::OBJECT) {
+            return notification ? ""
+                                : errorResponse(id, INVALID_PARAMS, "params must be an object");
+        }
+        params = *paramsValue;
+    }
+
+    std::string result;
+    std::string error;
+    if (runQuery(method, params, result, error)) {
+        if (notification) {
+            return "";
+        }
+        return error.empty() ? resultResponse(id, result)
+                             : errorResponse(id, INVALID_PARAMS, error);
+    }
+    if (method != "promote" && method != "drop" && method != "refresh") {
+        return notification ? "" : errorResponse(id, METHOD_NOT_FOUND, "method not found");
+    }
+
+    // actions are validated against the current snapshot, but run on the loaded state
+    ControlAction action;
+    action.method = method;
+    const double repo = params.GetNumber("repo", 0);
+    if (repo < 0 || std::trunc(repo) != repo || repo >= static_cast<double>(repos.size())) {
+        return notification ? "" : errorResponse(id, INVALID_PARAMS, "unknown repo");
+    }
+    action.repo = static_cast<size_t>(repo);
+    if (method != "refresh") {
+        const auto& snapshot = snapshots.at(action.repo);
+        std::optional<std::string> hash;
+        if (snapshot != nullptr) {
+            hash = resolveHash(*snapshot, params.GetString("hash"));
+        }
+        if (!hash.has_value()) {
+            return notification ? "" : errorResponse(id, INVALID_PARAMS, "unknown commit");
+        }
+        action.hash = std::move(hash.value());
+    }
+    if (method == "promote") {
+        action.ref = params.GetString("ref");
+        action.subject = params.GetString("subject");
+        if (!ostree_validate_rev(action.ref.c_str(), nullptr)) {
+            return notification ? "" : errorResponse(id, INVALID_PARAMS, "invalid ref");
+        }
+        if (hasControlCharacters(action.subject)) {
+            return notification ? "" : errorResponse(id, INVALID_PARAMS, "invalid subject");
+        }
+        if (const json::Value* metadata = params.Find("metadata"); metadata != nullptr) {
+            for (const auto& entry : metadata->array) {
+                if (entry.type != json::Value::Type::STRING ||
+                    entry.string.find('=') == std::string::npos ||
+                    hasControlCharacters(entry.string)) {
+                    return notification
+                               ? ""
+                               : errorResponse(id, INVALID_PARAMS, "metadata must be KEY=VALUE");
+                }
+                action.metadata.push_back(entry.string);
+            }
+        }
+    }
+    std::future<bool> actionResult = onAction(std::move(action));
+    if (!notification) {
+        PendingAction pending;
+        pending.client = client.id;
+        pending.requestId = id;
+        pending.result = std::move(actionResult);
+        pendingActions.push_back(std::move(pending));
+    }
+    return "";
+}
+
+bool ControlServer::runQuery(const std::string& method,
+                             const json::Value& params,
+                             std::string& result,
+                             std::string& error) {
+    if (method == "repos") {
+        result = "[";
+        for (size_t i{0}; i < repos.size(); i++) {
+            const auto& snapshot = snapshots[i];
+            result += (i > 0 ? ",{\"repo\":" : "{\"repo\":") + std::to_string(i) +
+                      ",\"path\":" + json::Quote(repos[i]->GetRepoPath()) +
+                      ",\"loaded\":" + (snapshot != nullptr ? "true" : "false") +
+                      ",\"refs\":" + std::to_string(snapshot ? snapshot->branches.size() : 0) +
+                      ",\"commits\":" + std::to_string(snapshot ? snapshot->commits.size() : 0) +
+                      "}";
+        }
+        result += "]";
+        return true;
+    }
+    if (method != "refs" && method != "resolve" && method != "commit" && method != "ancestry" &&
+        method != "sizes" && method != "search") {
+        return false;
+    }
+
+    // the snapshot stays valid for the whole request, even if a newer one is published
+    const double repo = params.GetNumber("repo", 0);
+    if (repo < 0 || std::trunc(repo) != repo || repo >= static_cast<double>(repos.size())) {
+        error = "unknown repo";
+        return true;
+    }
+    const std::shared_ptr<const ModelSnapshot> snapshot = snapshots.at(static_cast<size_t>(repo));
+    if (snapshot == nullptr) {
+        error = "repository still loading";
+        return true;
+    }
+
+    if (method == "refs") {
+        result = "[";
+        for (const auto& branch : snapshot->branches) {
+            auto head = snapshot->branchHeads.find(branch);
+            result += (result.size() > 1 ? ",{\"name\":" : "{\"name\":") + json::Quote(branch) +
+                      ",\"head\":" +
+                      json::Quote(head != snapshot->branchHeads.end() ? head->second : "") + "}";
+        }
+        result += "]";
+    } else if (method == "resolve") {
+        result = "[";
+        for (const auto& hash : snapshot->commitIndex.FindByPrefix(params.GetString("prefix"))) {
+            result += (result.size() > 1 ? "," : "") + json::Quote(hash);
+        }
+        result += "]";
+    } else if (method == "commit") {
+        auto hash = resolveHash(*snapshot, params.GetString("hash"));
+        if (!hash.has_value()) {
+            error = "unknown, or ambiguous commit";
+            return true;
+        }
+        std::string refs = "[";
+        if (auto commitId = snapshot->reachability.GetId(hash.value()); commitId.has_value()) {
+            for (const auto& ref : snapshot->reachability.GetContainingRefs(commitId.value())) {
+                refs += (refs.size() > 1 ? "," : "") + json::Quote(ref);
+            }
+        }
+        result = commitToJson(snapshot->commits.at(hash.value()));
+        result.pop_back();
+        result += ",\"refs\":" + refs + "]}";
+    } else if (method == "ancestry") {
+        auto a = resolveHash(*snapshot, params.GetString("a"));
+        auto b = resolveHash(*snapshot, params.GetString("b"));
+        if (!a.has_value() || !b.has_value()) {
+            error = "unknown, or ambiguous commit";
+            return true;
+        }
+        const ReachabilityIndex& index = snapshot->reachability;
+        auto aId = index.GetId(a.value());
+        auto bId = index.GetId(b.value());
+        if (!aId.has_value() || !bId.has_value()) {
+            error = "commit not indexed";
+            return true;
+        }
+        auto mergeBase = index.GetMergeBase(aId.value(), bId.value());
+        result = "{\"a\":" + json::Quote(a.value()) + ",\"b\":" + json::Quote(b.value()) +
+                 ",\"aIsAncestorOfB\":" +
+                 (index.IsAncestor(aId.value(), bId.value()) ? "true" : "false") +
+                 ",\"bIsAncestorOfA\":" +
+                 (index.IsAncestor(bId.value(), aId.value()) ? "true" : "false") +
+                 ",\"mergeBase\":" +
+                 (mergeBase.has_value() ? json::Quote(index.GetHash(mergeBase.value())) : "null") +
+                 "}";
+    } else if (method == "sizes") {
+        const OSTreeRepo* ostreeRepo = repos.at(static_cast<size_t>(repo));
+        result = "{";
+        const json::Value* hashes = params.Find("hashes");
+        for (const auto& entry : hashes != nullptr ? hashes->array : std::vector<json::Value>{}) {
+            auto hash = resolveHash(*snapshot, entry.string);
+            if (!hash.has_value()) {
+                continue;
+            }
+            auto size = ostreeRepo->GetCommitSize(hash.value());
+            result += (result.size() > 1 ? "," : "") + json::Quote(hash.value()) + ":" +
+                      (size.has_value() ? std::to_string(size.value()) : "null");
+            // unknown sizes are computed for a later request
+            if (!size.has_value() && requestedSizes.insert(hash.value()).second) {
+                pool.Submit([ostreeRepo, hash = hash.value(),
+                             parent = std::string(snapshot->commits.at(hash.value()).parent)] {
+                    ostreeRepo->ComputeCommitSize(hash, parent);
+                });
+            }
+        }
+        result += "}";
+    } else if (method == "search") {
+        const std::string query = toLower(params.GetString("query"));
+        const double limit = params.GetNumber("limit", DEFAULT_SEARCH_LIMIT);
+        const size_t maxResults = limit > 0 ? static_cast<size_t>(limit) : 0;
+        size_t found{0};
+        result = "[";
+        // reachability ids are ordered newest first (streamed older history is appended)
+        for (size_t id{0}; id < snapshot->commits.size() && found < maxResults; id++) {
+            const std::string& hash = snapshot->reachability.GetHash(id);
+            const Commit& commit = snapshot->commits.at(hash);
+            if (!query.empty() && !hash.starts_with(query) &&
+                !containsLower(commit.subject, query) && !containsLower(commit.version, query) &&
+                !containsLower(commit.branch, query)) {
+                continue;
+            }
+            result += (found++ > 0 ? "," : "") + commitToJson(commit);
+        }
+        result += "]";
+    }
+    return true;
+}
+
+std::optional<std::string> ControlServer::resolveHash(const ModelSnapshot& snapshot,
+                                                      const std::string& prefix) {
+    if (prefix.empty()) {
+        return std::nullopt;
+    }
+    auto matches = snapshot.commitIndex.FindByPrefix(prefix);
+    if (matches.size() != 1) {
+        return std::nullopt;
+    }
+    return std::string(matches.front());
+}
+
+}  // namespace cpplibostree
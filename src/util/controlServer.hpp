@@ -0,0 +1,190 @@
+/*_____________________________________________________________
+ | Control Server
+ |   JSON-RPC 2.0 endpoint on a Unix socket, to script the
+ |   repositories opened in the TUI (one request per line).
+ |   Queries are answered on the server thread from immutable
+ |   snapshots of the loaded state (refs, commits & indexes),
+ |   so they never wait for, or block the UI thread. Actions,
+ |   that change a repository, are handed to the owner of the
+ |   repositories & answered once they are done.
+ |
+ |   Methods (params: repo = index of the repository, def. 0):
+ |     repos                              list the repositories
+ |     refs                               refs & their heads
+ |     resolve  {prefix}                  hashes with a prefix
+ |     commit   {hash}                    commit & its refs
+ |     ancestry {a, b}                    ancestor & merge-base
+ |     sizes    {hashes}                  known sizes, others
+ |                                        are computed for later
+ |     search   {query, limit}            newest matching commits
+ |     promote  {hash, ref, subject, metadata}
+ |     drop     {hash}
+ |     refresh                            reload the repository
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "commitIndex.hpp"
+#include "cpplibostree.hpp"
+#include "json.hpp"
+#include "reachability.hpp"
+#include "threadPool.hpp"
+
+namespace cpplibostree {
+
+/// Immutable state of a repository, that queries are answered from
+struct ModelSnapshot {
+    std::vector<std::shared_ptr<const StringArena>> arenas;  // text of `commits`
+    CommitList commits;
+    std::vector<std::string> branches;
+    std::unordered_map<std::string, std::string> branchHeads;
+    // built by the server thread, before the snapshot is used
+    CommitIndex commitIndex;
+    ReachabilityIndex reachability;
+
+    /**
+     * @brief Copy the refs & the commit list of a repository, the text of the commits is
+     * shared (not copied). Only the owner of the repository may call this.
+     *
+     * @param repo Repository to copy.
+     * @return Snapshot without indexes (see ControlServer::Publish())
+     */
+    [[nodiscard]] static std::unique_ptr<ModelSnapshot> Capture(const OSTreeRepo& repo);
+};
+
+/// Action, that changes a repository (validated by the server)
+struct ControlAction {
+    size_t repo{0};                     // index of the repository
+    std::string method;                 // "promote", "drop", or "refresh"
+    std::string hash;                   // complete hash of the commit to promote, or drop
+    std::string ref;                    // target ref of a promotion
+    std::string subject;                // new subject of a promotion (empty = keep it)
+    std::vector<std::string> metadata;  // additional metadata of a promotion (KEY=VALUE)
+};
+
+/// Runs an action (e.g. on the UI thread), the future holds its success
+using ControlActionHandler = std::function<std::future<bool>(ControlAction action)>;
+
+class ControlServer {
+   public:
+    /**
+     * @brief Construct a new ControlServer, Start() opens the socket.
+     *
+     * @param socketPath Path of the Unix socket.
+     * @param repos Opened repositories, only used to read & compute commit sizes (thread safe).
+     * @param pool Pool to compute commit sizes on, has to outlive the server.
+     * @param onAction Handler for promotions, drops & refreshes.
+     */
+    ControlServer(std::string socketPath,
+                  std::vector<const OSTreeRepo*> repos,
+                  ThreadPool& pool,
+                  ControlActionHandler onAction);
+
+    /// @brief Stops the server thread & removes the socket.
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    /**
+     * @brief Listen on the socket & start the server thread.
+     *
+     * @return false if the socket could not be created
+     */
+    bool Start();
+
+    /**
+     * @brief Replace the snapshot of a repository. The indexes of the snapshot are built on the
+     * server thread, requests are answered from the previous snapshot meanwhile. Thread safe.
+     *
+     * @param repo Index of the repository.
+     * @param snapshot Snapshot, see ModelSnapshot::Capture().
+     */
+    void Publish(size_t repo, std::unique_ptr<ModelSnapshot> snapshot);
+
+   private:
+    struct Client {
+        uint64_t id{0};
+        int fd{-1};
+        std::string input;
+        std::string output;
+    };
+
+    /// Action, that is not answered yet
+    struct PendingAction {
+        uint64_t client{0};
+        json::Value requestId;
+        std::future<bool> result;
+    };
+
+    /// @brief Server thread: accept clients, answer requests & finished actions.
+    void serve();
+
+    /// @brief Build the indexes of newly published snapshots & make them current.
+    void takePublishedSnapshots();
+
+    /// @brief Read & answer all complete request lines of a client, false if it disconnected.
+    bool readRequests(Client& client);
+
+    /**
+     * @brief Answer a single request line.
+     *
+     * @param client Client, that sent the request.
+     * @param line JSON-RPC request.
+     * @return Response line, empty if it is answered later (action) or a notification
+     */
+    std::string handleRequest(const Client& client, const std::string& line);
+
+    /**
+     * @brief Run a query method.
+     *
+     * @param method Name of the method.
+     * @param params Parameters (object).
+     * @param result Set to the result document.
+     * @param error Set to the error message, if the params are invalid.
+     * @return false, if the method is no query
+     */
+    bool runQuery(const std::string& method,
+                  const json::Value& params,
+                  std::string& result,
+                  std::string& error);
+
+    /// @brief Resolve a complete, or abbreviated hash in a snapshot (nothing if not unique).
+    [[nodiscard]] static std::optional<std::string> resolveHash(const ModelSnapshot& snapshot,
+                                                               const std::string& prefix);
+
+    std::string socketPath;
+    std::vector<const OSTreeRepo*> repos;
+    ThreadPool& pool;
+    ControlActionHandler onAction;
+
+    int listenFd{-1};
+    int wakeFd{-1};  // eventfd, wakes the server thread on Publish() & on destruction
+    std::thread thread;
+    bool stopping{false};  // guarded by `mutex`
+
+    std::mutex mutex;  // guards `published` & `stopping`
+    std::unordered_map<size_t, std::unique_ptr<ModelSnapshot>> published;
+
+    // only accessed by the server thread
+    std::vector<std::shared_ptr<const ModelSnapshot>> snapshots;  // per repository
+    std::vector<Client> clients;
+    std::vector<PendingAction> pendingActions;
+    std::unordered_set<std::string> requestedSizes;  // commit sizes submitted to the pool
+    uint64_t nextClientId{1};
+};
+
+}  // namespace cpplibostree
@@ -1,16 +1,29 @@
 #include "cpplibostree.hpp"
+#include "commitIndex.hpp"
+#include "commitReader.hpp"
+#include "reachability.hpp"
+#include "refSnapshot.hpp"
+#include "signatureCache.hpp"
+#include "signatureVerifier.hpp"
 
 // C++
 #include <algorithm>
+#include <cctype>
 #include <chrono>
 #include <cstdlib>
-#include <sstream>
+#include <memory>
+#include <optional>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 // C
 #include <fcntl.h>
+#include <sys/wait.h>
 #include <glib-2.0/glib.h>
 #include <ostree.h>
 #include <cassert>
@@ -18,25 +31,292 @@
 
 namespace cpplibostree {
 
-OSTreeRepo::OSTreeRepo(std::string path) : repoPath(std::move(path)), commitList({}), branches({}) {
-    UpdateData();
+namespace {
+
+/// Current commit of a history in findHistoryJoins()
+struct HistoryWalker {
+    std::string hash;
+    guint64 timestamp{0};
+    std::string parent;  // empty, if the history ends
+};
+
+/// @brief Check, if a text contains control characters (also line breaks).
+bool hasControlCharacters(std::string_view text) {
+    return std::any_of(text.begin(), text.end(),
+                       [](char c) { return std::iscntrl(static_cast<unsigned char>(c)) != 0; });
 }
 
-bool OSTreeRepo::UpdateData() {
-    // parse branches
-    std::string branchString = getBranchesAsString();
-    std::stringstream bss(branchString);
-    std::string word;
-    while (bss >> word) {
-        branches.push_back(word);
+/// @brief Check a ref, before it is handed to the ostree CLI.
+bool isValidRef(const std::string& ref) {
+    GError* error{nullptr};
+    if (!ostree_validate_rev(ref.c_str(), &error)) {
+        g_printerr("Invalid ref: %s\n", error->message);
+        g_error_free(error);
+        return false;
     }
+    return true;
+}
 
-    // parse commits
-    commitList = parseCommitsAllBranches();
+/// @brief Check a commit hash, before it is handed to the ostree CLI.
+bool isValidHash(const std::string& hash) {
+    GError* error{nullptr};
+    if (!ostree_validate_checksum_string(hash.c_str(), &error)) {
+        g_printerr("Invalid commit: %s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
+    return true;
+}
 
+/// @brief Load the commit of a walker, false if it is missing.
+bool loadWalker(const CommitReader& reader, std::string hash, HistoryWalker& walker) {
+    g_autoptr(GVariant) variant = nullptr;
+    GError* error{nullptr};
+    if (!reader.Load(hash.c_str(), &variant, &error)) {
+        g_error_free(error);
+        return false;
+    }
+    g_autofree char* parent = ostree_commit_get_parent(variant);
+    walker.hash = std::move(hash);
+    walker.timestamp = ostree_commit_get_timestamp(variant);
+    walker.parent = parent != nullptr ? parent : "";
+    return true;
+}
+
+/**
+ * @brief Find the commit, where the history of each head joins the history of an earlier head
+ * (the first one, that an earlier head reaches as well). All histories are walked together,
+ * newest commits first, so that two histories meet in their first common commit. Only the
+ * current commit of each history & the commits of the current timestamp are remembered.
+ *
+ * @param reader Reader of the opened repository.
+ * @param heads Head commits, in the order of their branches.
+ * @return The join commit per head (empty: no earlier head reaches its history), nullopt if a
+ * parent is newer than its child (the walk relies on the timestamps).
+ */
+std::optional<std::vector<std::string>> findHistoryJoins(const CommitReader& reader,
+                                                         const std::vector<std::string>& heads) {
+    std::vector<std::string> joins(heads.size());
+    std::vector<HistoryWalker> walkers(heads.size());
+    std::unordered_map<std::string, size_t> positions;  // waiting walkers by commit
+    // newest commits first, earlier heads first on the same timestamp
+    auto order = [&](size_t a, size_t b) {
+        return walkers[a].timestamp != walkers[b].timestamp
+                   ? walkers[a].timestamp > walkers[b].timestamp
+                   : a < b;
+    };
+    std::set<size_t, decltype(order)> queue(order);
+
+    for (size_t i{0}; i < heads.size(); i++) {
+        if (positions.contains(heads[i])) {
+            joins[i] = heads[i];
+        } else if (loadWalker(reader, heads[i], walkers[i])) {
+            positions.emplace(heads[i], i);
+            queue.insert(i);
+        }
+    }
+
+    // commits left by a walker on the current timestamp, always by an earlier head, as those
+    // walk first (a later head reaching one of them joins there)
+    std::unordered_set<std::string> passed;
+    guint64 level{0};
+    while (!queue.empty()) {
+        const size_t i = *queue.begin();
+        queue.erase(queue.begin());
+        HistoryWalker& walker = walkers[i];
+        if (passed.empty() || walker.timestamp != level) {
+            passed.clear();
+            level = walker.timestamp;
+        }
+        // walk through all commits of the current timestamp
+        while (true) {
+            positions.erase(walker.hash);
+            passed.insert(walker.hash);
+            if (walker.parent.empty() || !loadWalker(reader, walker.parent, walker)) {
+                break;
+            }
+            if (walker.timestamp > level) {
+                return std::nullopt;
+            }
+            if (passed.contains(walker.hash)) {
+                joins[i] = walker.hash;
+                break;
+            }
+            if (auto other = positions.find(walker.hash); other != positions.end()) {
+                if (other->second < i) {
+                    joins[i] = walker.hash;
+                    break;
+                }
+                // the waiting walker of a later head joins this one
+                joins[other->second] = walker.hash;
+                queue.erase(other->second);
+                positions.erase(other);
+            }
+            if (walker.timestamp < level) {
+                positions.emplace(walker.hash, i);
+                queue.insert(i);
+                break;
+            }
+        }
+    }
+    return joins;
+}
+
+}  // namespace
+
+OSTreeRepo::OSTreeRepo(std::string path, bool loadData)
+    : repoPath(std::move(path)),
+      commitList({}),
+      branches({}),
+      reachabilityIndex(std::make_unique<ReachabilityIndex>()),
+      commitIndex(std::make_unique<CommitIndex>()),
+      signatureCache(std::make_unique<SignatureCache>(repoPath)) {
+    if (loadData) {
+        UpdateData();
+    }
+}
+
+OSTreeRepo::~OSTreeRepo() {
+    signatureCache->Save();
+}
+
+bool OSTreeRepo::UpdateData() {
+    ApplyRepoData(*LoadRepoData(GetLoadSettings()));
     return true;
 }
 
+std::optional<RepoData> OSTreeRepo::LoadRepoData(const LoadSettings& settings,
+                                                 const LoadProgressCallback& progress) const {
+    RepoData data;
+    // parse branches & their heads
+    parseBranches(data, settings.options);
+
+    // parse commits
+    for (size_t i{0}; i < data.branches.size(); i++) {
+        parseCommitsOfBranch(data.branches[i], data, settings.options);
+        if (progress && !progress(i + 1, data.branches.size())) {
+            return std::nullopt;
+        }
+    }
+    data.orphanedCommits = settings.orphanedCommits;
+    loadOrphanedCommits(data.orphanedCommits, data.commits, *data.arena);
+    return data;
+}
+
+std::optional<RepoData> OSTreeRepo::LoadRepoDelta(std::vector<std::string>& removedCommits) const {
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return std::nullopt;
+    }
+    RepoData data;
+    parseBranches(data, loadOptions);
+
+    // like in a complete load, every commit belongs to the first branch reaching it
+    std::unordered_set<std::string_view> reached;
+    for (const auto& branch : data.branches) {
+        auto head = data.branchHeads.find(branch);
+        if (head == data.branchHeads.end()) {
+            continue;
+        }
+        std::string_view branchText = data.arena->Store(branch);
+
+        // new commits are read from disk, until the walk reaches a loaded commit
+        std::string loadedHistory = head->second;
+        if (!commitList.contains(head->second)) {
+            loadedHistory.clear();
+            walkCommits(repo, head->second.c_str(), [&](std::string_view hash, GVariant* variant) {
+                if (reached.contains(hash) || commitList.contains(hash)) {
+                    loadedHistory = hash;
+                    return false;
+                }
+                Commit commit = parseCommit(variant, branchText, hash, *data.arena);
+                data.commits.insert({commit.hash, commit});
+                reached.insert(commit.hash);
+                return true;
+            });
+        }
+
+        // the rest is followed in memory, only commits of another branch are sent again
+        for (auto commit = commitList.find(loadedHistory);
+             commit != commitList.end() && !reached.contains(commit->first);
+             commit = commitList.find(commit->second.parent)) {
+            reached.insert(commit->first);
+            if (commit->second.branch == branch) {
+                continue;
+            }
+            Commit moved = commit->second;
+            moved.hash = data.arena->Store(moved.hash);
+            moved.subject = data.arena->Store(moved.subject);
+            moved.version = data.arena->Store(moved.version);
+            moved.parent = data.arena->Store(moved.parent);
+            moved.branch = branchText;
+            data.commits.insert({moved.hash, moved});
+        }
+    }
+    g_object_unref(repo);
+
+    // loaded orphans are kept, unless a ref reaches them now
+    removedCommits.clear();
+    for (const auto& [hash, commit] : commitList) {
+        if (!reached.contains(hash) && commit.branch != ORPHANED_BRANCH) {
+            removedCommits.emplace_back(hash);
+        }
+    }
+    data.orphanedCommits = orphanedCommits;
+    return data;
+}
+
+void OSTreeRepo::ApplyRepoData(RepoData&& data) {
+    branches = std::move(data.branches);
+    skippedBranches = std::move(data.skippedBranches);
+    branchHeads = std::move(data.branchHeads);
+    historyFrontiers = std::move(data.historyFrontiers);
+    orphanedCommits = std::move(data.orphanedCommits);
+    loadGeneration++;
+    stateVersion++;
+    commitList = std::move(data.commits);
+    commitArenas.clear();
+    commitArenas.push_back(std::move(data.arena));
+    resetLoadedHashes();
+    {
+        std::lock_guard<std::mutex> lock(commitDetailsMutex);
+        commitDetails.clear();
+    }
+    // cached signatures of other keyrings are verified again on access
+    signatureCache->UpdateKeyringFingerprint();
+    reachabilityIndex->Build(commitList, branchHeads);
+    commitIndex->Build(commitList);
+}
+
+void OSTreeRepo::ApplyRepoDelta(RepoData&& data, const std::vector<std::string>& removedCommits) {
+    branches = std::move(data.branches);
+    skippedBranches = std::move(data.skippedBranches);
+    branchHeads = std::move(data.branchHeads);
+    historyFrontiers = std::move(data.historyFrontiers);
+    loadGeneration++;
+    stateVersion++;
+    for (const auto& hash : removedCommits) {
+        commitList.erase(hash);
+    }
+    // moved commits (reached through another branch now) are replaced
+    for (const auto& [hash, commit] : data.commits) {
+        commitList.insert_or_assign(hash, commit);
+    }
+    commitArenas.push_back(std::move(data.arena));
+    compactCommitArenas();
+    resetLoadedHashes();
+    {
+        std::lock_guard<std::mutex> lock(commitDetailsMutex);
+        commitDetails.clear();
+    }
+    signatureCache->UpdateKeyringFingerprint();
+    reachabilityIndex->Build(commitList, branchHeads);
+    commitIndex->Build(commitList);
+}
+
 // METHODS
 
 OstreeRepo* OSTreeRepo::_c() {
@@ -63,25 +343,414 @@ const std::vector<std::string>& OSTreeRepo::GetBranches() const {
     return branches;
 }
 
-bool OSTreeRepo::IsCommitSigned(const Commit& commit) {
-    return commit.signatures.size() > 0;
+const std::vector<std::string>& OSTreeRepo::GetSkippedBranches() const {
+    return skippedBranches;
+}
+
+const std::unordered_map<std::string, std::string>& OSTreeRepo::GetBranchHeads() const {
+    return branchHeads;
+}
+
+const ReachabilityIndex& OSTreeRepo::GetReachabilityIndex() const {
+    return *reachabilityIndex;
+}
+
+const CommitIndex& OSTreeRepo::GetCommitIndex() const {
+    return *commitIndex;
+}
+
+const std::unordered_map<std::string, std::string>& OSTreeRepo::GetHistoryFrontiers() const {
+    return historyFrontiers;
+}
+
+const std::vector<std::string>& OSTreeRepo::GetOrphanedCommits() const {
+    return orphanedCommits;
+}
+
+void OSTreeRepo::SetLoadOptions(const LoadOptions& options) {
+    loadOptions = options;
+}
+
+LoadSettings OSTreeRepo::GetLoadSettings() const {
+    return {loadOptions, orphanedCommits};
+}
+
+StringArenaStatistics OSTreeRepo::GetCommitTextStatistics() const {
+    StringArenaStatistics total;
+    for (const auto& arena : commitArenas) {
+        const auto& statistics = arena->GetStatistics();
+        total.blocks += statistics.blocks;
+        total.usedBytes += statistics.usedBytes;
+        total.allocatedBytes += statistics.allocatedBytes;
+    }
+    return total;
+}
+
+const std::vector<std::shared_ptr<const StringArena>>& OSTreeRepo::GetCommitArenas() const {
+    return commitArenas;
+}
+
+size_t OSTreeRepo::GetStateVersion() const {
+    return stateVersion;
+}
+
+size_t OSTreeRepo::GetLoadGeneration() const {
+    return loadGeneration;
+}
+
+bool OSTreeRepo::HasMoreHistory() const {
+    return !historyFrontiers.empty();
+}
+
+HistoryPageRequest OSTreeRepo::GetHistoryPageRequest() const {
+    return {historyFrontiers, loadGeneration, loadedHashes};
+}
+
+void OSTreeRepo::resetLoadedHashes() {
+    std::unordered_set<std::string> hashes;
+    hashes.reserve(commitList.size());
+    for (const auto& [hash, commit] : commitList) {
+        hashes.emplace(hash);
+    }
+    loadedHashes.clear();
+    appendLoadedHashes(std::move(hashes));
+}
+
+void OSTreeRepo::appendLoadedHashes(std::unordered_set<std::string> hashes) {
+    if (hashes.empty()) {
+        return;
+    }
+    // runs of pending requests are shared, so they are copied instead of being extended
+    while (!loadedHashes.empty() && loadedHashes.back()->size() <= hashes.size()) {
+        hashes.insert(loadedHashes.back()->begin(), loadedHashes.back()->end());
+        loadedHashes.pop_back();
+    }
+    loadedHashes.push_back(
+        std::make_shared<const std::unordered_set<std::string>>(std::move(hashes)));
+}
+
+HistoryPage OSTreeRepo::LoadHistoryPage(const HistoryPageRequest& request,
+                                        size_t pageSize) const {
+    HistoryPage page;
+    // the load, the frontiers belong to (the member changes on the owner's thread)
+    page.loadGeneration = request.loadGeneration;
+    auto isLoaded = [&](std::string_view hash) {
+        const std::string key(hash);
+        return page.commits.contains(hash) ||
+               std::any_of(request.loaded.begin(), request.loaded.end(),
+                           [&](const auto& run) { return run->contains(key); });
+    };
+
+    // open repo
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return page;
+    }
+
+    for (const auto& [branch, frontier] : request.frontiers) {
+        size_t loaded{0};
+        std::string_view branchText = page.arena->Store(branch);
+        walkCommits(repo, frontier.c_str(), [&](std::string_view hash, GVariant* variant) {
+            // reached history, that is already loaded (e.g. through another branch)
+            if (isLoaded(hash)) {
+                return false;
+            }
+            if (loaded >= pageSize) {
+                page.historyFrontiers[branch] = hash;
+                return false;
+            }
+            Commit commit = parseCommit(variant, branchText, hash, *page.arena);
+            page.commits.insert({commit.hash, commit});
+            loaded++;
+            return true;
+        });
+    }
+
+    g_object_unref(repo);
+    return page;
+}
+
+bool OSTreeRepo::MergeHistoryPage(HistoryPage&& page) {
+    if (page.loadGeneration != loadGeneration) {
+        return false;
+    }
+    std::vector<std::string> added;
+    added.reserve(page.commits.size());
+    for (const auto& [hash, commit] : page.commits) {
+        if (!commitList.contains(hash)) {
+            added.emplace_back(hash);
+        }
+    }
+    commitList.merge(page.commits);
+    commitArenas.push_back(std::move(page.arena));
+    appendLoadedHashes({added.begin(), added.end()});
+    stateVersion++;
+    historyFrontiers.clear();
+    for (auto& [branch, frontier] : page.historyFrontiers) {
+        // history might already be loaded through another branch
+        if (!commitList.contains(frontier)) {
+            historyFrontiers[branch] = std::move(frontier);
+        }
+    }
+    // only older history is added, the refs did not move
+    commitIndex->Append(commitList, added);
+    reachabilityIndex->Append(commitList, std::move(added), branchHeads);
+    return true;
+}
+
+size_t OSTreeRepo::SetOrphanedCommits(std::vector<std::string> hashes) {
+    std::erase_if(commitList, [](const auto& entry) {
+        return entry.second.branch == ORPHANED_BRANCH;
+    });
+    orphanedCommits = std::move(hashes);
+    if (!orphanedCommits.empty()) {
+        auto arena = std::make_shared<StringArena>();
+        loadOrphanedCommits(orphanedCommits, commitList, *arena);
+        commitArenas.push_back(std::move(arena));
+    }
+    compactCommitArenas();
+    stateVersion++;
+    reachabilityIndex->Build(commitList, branchHeads);
+    commitIndex->Build(commitList);
+    return orphanedCommits.size();
+}
+
+void OSTreeRepo::compactCommitArenas() {
+    size_t storedBytes{0};
+    for (const auto& arena : commitArenas) {
+        storedBytes += arena->GetStatistics().usedBytes;
+    }
+    // branch names are stored once per arena, they are left out
+    size_t liveBytes{0};
+    for (const auto& [hash, commit] : commitList) {
+        liveBytes += commit.hash.size() + commit.subject.size() + commit.version.size() +
+                     commit.parent.size();
+    }
+    if (commitArenas.size() <= 1 || storedBytes <= 2 * liveBytes) {
+        return;
+    }
+
+    auto arena = std::make_shared<StringArena>();
+    std::unordered_map<std::string_view, std::string_view> branchTexts;
+    CommitList compacted;
+    compacted.reserve(commitList.size());
+    for (const auto& [hash, old] : commitList) {
+        Commit commit = old;
+        commit.hash = arena->Store(old.hash);
+        commit.subject = arena->Store(old.subject);
+        commit.version = arena->Store(old.version);
+        commit.parent = arena->Store(old.parent);
+        auto [branch, inserted] = branchTexts.try_emplace(old.branch);
+        if (inserted) {
+            branch->second = arena->Store(old.branch);
+        }
+        commit.branch = branch->second;
+        compacted.emplace(commit.hash, commit);
+    }
+    commitList = std::move(compacted);
+    commitArenas.clear();
+    commitArenas.push_back(std::move(arena));
+}
+
+void OSTreeRepo::loadOrphanedCommits(std::vector<std::string>& hashes,
+                                     CommitList& commits,
+                                     StringArena& arena) const {
+    if (hashes.empty()) {
+        return;
+    }
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        hashes.clear();
+        return;
+    }
+    const std::string_view branch = arena.Store(ORPHANED_BRANCH);
+    const CommitReader reader(repo);
+    // pruned, or reachable again since the scan (already loaded on a real branch)
+    std::erase_if(hashes, [&](const std::string& hash) {
+        if (commits.contains(hash)) {
+            return true;
+        }
+        g_autoptr(GVariant) variant = nullptr;
+        if (!reader.Load(hash.c_str(), &variant, nullptr)) {
+            return true;
+        }
+        Commit commit = parseCommit(variant, branch, hash, arena);
+        commits.insert({commit.hash, commit});
+        return false;
+    });
+    g_object_unref(repo);
+}
+
+std::shared_ptr<const CommitDetails> OSTreeRepo::GetCommitDetails(const std::string& hash) const {
+    if (auto known = FindCommitDetails(hash); known != nullptr) {
+        return known;
+    }
+
+    // open repo
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return std::make_shared<const CommitDetails>();
+    }
+
+    g_autoptr(GVariant) variant = nullptr;
+    if (!ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, hash.c_str(), &variant,
+                                  &error)) {
+        g_printerr("Error loading commit %s: %s\n", hash.c_str(), error->message);
+        g_error_free(error);
+        g_object_unref(repo);
+        return std::make_shared<const CommitDetails>();
+    }
+    auto details = std::make_shared<const CommitDetails>(
+        parseCommitDetails(repo, variant, hash, *signatureCache, SignatureVerifier(repo)));
+    g_object_unref(repo);
+
+    std::lock_guard<std::mutex> lock(commitDetailsMutex);
+    // another thread might have decoded the same commit in the meantime
+    return commitDetails.try_emplace(hash, std::move(details)).first->second;
+}
+
+std::shared_ptr<const CommitDetails> OSTreeRepo::FindCommitDetails(const std::string& hash) const {
+    std::lock_guard<std::mutex> lock(commitDetailsMutex);
+    auto it = commitDetails.find(hash);
+    return it == commitDetails.end() ? nullptr : it->second;
+}
+
+bool OSTreeRepo::SaveSignatureCache() const {
+    return signatureCache->Save();
+}
+
+std::vector<std::string> OSTreeRepo::GetStaleSignatureCommits() const {
+    return signatureCache->GetStaleCommits();
+}
+
+std::vector<std::vector<Signature>> OSTreeRepo::VerifySignatures(
+    const std::vector<std::string>& hashes) const {
+    std::vector<std::vector<Signature>> signatures(hashes.size());
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return signatures;
+    }
+    // loaded on the first commit, that is not cached
+    std::optional<SignatureVerifier> verifier;
+    const CommitReader reader(repo);
+    for (size_t i{0}; i < hashes.size(); i++) {
+        const std::string& hash = hashes[i];
+        if (auto cached = signatureCache->Find(hash); cached.has_value()) {
+            signatures[i] = std::move(cached.value());
+            continue;
+        }
+        g_autoptr(GVariant) variant = nullptr;
+        if (!reader.Load(hash.c_str(), &variant, nullptr)) {
+            signatureCache->Remove(hash);
+            continue;
+        }
+        g_autoptr(GVariant) detached = nullptr;
+        ostree_repo_read_commit_detached_metadata(repo, hash.c_str(), &detached, nullptr,
+                                                  nullptr);
+        if (!verifier.has_value()) {
+            verifier.emplace(repo);
+        }
+        signatures[i] = verifier->Verify(repo, hash, variant, detached);
+        signatureCache->Store(hash, signatures[i]);
+    }
+    g_object_unref(repo);
+    return signatures;
+}
+
+bool OSTreeRepo::IsCommitSigned(const CommitDetails& details) {
+    return details.signatures.size() > 0;
+}
+
+std::optional<uint64_t> OSTreeRepo::GetCommitSize(const std::string& hash) const {
+    std::lock_guard<std::mutex> lock(commitSizeMutex);
+    auto it = commitSizes.find(hash);
+    if (it == commitSizes.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+uint64_t OSTreeRepo::ComputeCommitSize(const std::string& hash, const std::string& parent) const {
+    if (auto known = GetCommitSize(hash); known.has_value()) {
+        return known.value();
+    }
+
+    // open repo
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return 0;
+    }
+
+    // objects of the commit & its parent (the parent might be missing)
+    GHashTable* commitObjects{nullptr};
+    GHashTable* parentObjects{nullptr};
+    if (!ostree_repo_traverse_commit(repo, hash.c_str(), 0, &commitObjects, nullptr, nullptr)) {
+        g_object_unref(repo);
+        return 0;
+    }
+    if (parent != "(no parent)") {
+        ostree_repo_traverse_commit(repo, parent.c_str(), 0, &parentObjects, nullptr, nullptr);
+    }
+
+    // sum up all objects, that are new in this commit
+    uint64_t size{0};
+    GHashTableIter iter;
+    gpointer key{nullptr};
+    g_hash_table_iter_init(&iter, commitObjects);
+    while (g_hash_table_iter_next(&iter, &key, nullptr)) {
+        if (parentObjects != nullptr && g_hash_table_contains(parentObjects, key)) {
+            continue;
+        }
+        const char* checksum{nullptr};
+        OstreeObjectType objectType{};
+        ostree_object_name_deserialize(static_cast<GVariant*>(key), &checksum, &objectType);
+        guint64 objectSize{0};
+        if (ostree_repo_query_object_storage_size(repo, objectType, checksum, &objectSize, nullptr,
+                                                  nullptr)) {
+            size += objectSize;
+        }
+    }
+
+    // free
+    g_hash_table_unref(commitObjects);
+    if (parentObjects != nullptr) {
+        g_hash_table_unref(parentObjects);
+    }
+    g_object_unref(repo);
+
+    std::lock_guard<std::mutex> lock(commitSizeMutex);
+    commitSizes[hash] = size;
+    return size;
 }
 
 Commit OSTreeRepo::parseCommit(GVariant* variant,
-                               const std::string& branch,
-                               const std::string& hash) {
+                               std::string_view branch,
+                               std::string_view hash,
+                               StringArena& arena) {
     Commit commit;
 
     const gchar* subject{nullptr};
-    const gchar* body{nullptr};
-    const gchar* version{nullptr};
     guint64 timestamp{0};
     g_autofree char* parent{nullptr};
 
-    // see OSTREE_COMMIT_GVARIANT_FORMAT
-    g_variant_get(variant, "(a{sv}aya(say)&s&stayay)", nullptr, nullptr, nullptr, &subject, &body,
-                  &timestamp, nullptr, nullptr);
-    assert(body);
+    // see OSTREE_COMMIT_GVARIANT_FORMAT, the body is left to parseCommitDetails()
+    g_variant_get(variant, "(a{sv}aya(say)&s&stayay)", nullptr, nullptr, nullptr, &subject,
+                  nullptr, &timestamp, nullptr, nullptr);
     assert(timestamp);
 
     // timestamp
@@ -91,228 +760,251 @@ Commit OSTreeRepo::parseCommit(GVariant* variant,
     // parent
     parent = ostree_commit_get_parent(variant);
     if (parent) {
-        commit.parent = parent;
+        commit.parent = arena.Store(parent);
     } else {
         commit.parent = "(no parent)";
     }
 
-    // content checksum
-    g_autofree char* contents = ostree_commit_get_content_checksum(variant);
-    assert(contents);
-    commit.contentChecksum = contents;
-
     // version
     g_autoptr(GVariant) metadata = NULL;
-    const char* ret = NULL;
+    const char* version = NULL;
     metadata = g_variant_get_child_value(variant, 0);
-    if (g_variant_lookup(metadata, OSTREE_COMMIT_META_KEY_VERSION, "&s", &ret)) {
-        version = g_strdup(ret);
-        commit.version = version;
+    if (g_variant_lookup(metadata, OSTREE_COMMIT_META_KEY_VERSION, "&s", &version)) {
+        commit.version = arena.Store(version);
     }
 
     // subject
     if (subject[0]) {
-        std::string val = subject;
-        commit.subject = val;
+        commit.subject = arena.Store(subject);
     } else {
         commit.subject = "(no subject)";
     }
 
+    commit.branch = branch;
+    commit.hash = arena.Store(hash);
+
+    return commit;
+}
+
+CommitDetails OSTreeRepo::parseCommitDetails(OstreeRepo* repo,
+                                             GVariant* variant,
+                                             const std::string& hash,
+                                             SignatureCache& cache,
+                                             const SignatureVerifier& verifier) {
+    CommitDetails details;
+
     // body
-    if (body[0]) {
-        commit.body = body;
-    }
+    const gchar* body{nullptr};
+    g_variant_get_child(variant, 4, "&s", &body);
+    assert(body);
+    details.body = body;
 
-    commit.branch = branch;
-    commit.hash = hash;
+    // content checksum
+    g_autofree char* contents = ostree_commit_get_content_checksum(variant);
+    assert(contents);
+    details.contentChecksum = contents;
+
+    // metadata, the child shares the buffer of the (usually memory mapped) commit object
+    details.metadata = SharedVariant(g_variant_get_child_value(variant, 0), g_variant_unref);
+    GVariant* detached{nullptr};
+    if (ostree_repo_read_commit_detached_metadata(repo, hash.c_str(), &detached, nullptr,
+                                                  nullptr) &&
+        detached != nullptr) {
+        details.detachedMetadata = SharedVariant(detached, g_variant_unref);
+    }
 
-    // Signatures ___ refactor into own method
-    // open repo
-    GError* error = nullptr;
-    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
-    if (repo == nullptr) {
-        g_printerr("Error opening repository: %s\n", error->message);
-        g_error_free(error);
-        assert(repo);
-    }
-    // see ostree print_object for reference
-    g_autoptr(OstreeGpgVerifyResult) result = nullptr;
-    g_autoptr(GError) local_error = nullptr;
-    result = ostree_repo_verify_commit_ext(repo, commit.hash.c_str(), nullptr, nullptr, nullptr,
-                                           &local_error);
-    if (g_error_matches(local_error, OSTREE_GPG_ERROR, OSTREE_GPG_ERROR_NO_SIGNATURE) ||
-        local_error != nullptr) {
-        /* Ignore */
+    // signatures
+    if (auto cached = cache.Find(hash); cached.has_value()) {
+        details.signatures = std::move(cached.value());
     } else {
-        assert(result);
-        guint n_sigs = ostree_gpg_verify_result_count_all(result);
-        // parse all found signatures
-        for (guint ii = 0; ii < n_sigs; ii++) {
-            g_autoptr(GVariant) variant = nullptr;
-            variant = ostree_gpg_verify_result_get_all(result, ii);
-            // see ostree_gpg_verify_result_describe_variant for reference
-            gint64 timestamp{0};
-            gint64 exp_timestamp{0};
-            gint64 key_exp_timestamp{0};
-            gint64 key_exp_timestamp_primary{0};
-            const char* fingerprint{nullptr};
-            const char* fingerprintPrimary{nullptr};
-            const char* pubkey_algo{nullptr};
-            const char* user_name{nullptr};
-            const char* user_email{nullptr};
-            gboolean valid{false};
-            gboolean sigExpired{false};
-            gboolean keyExpired{false};
-            gboolean keyRevoked{false};
-            gboolean keyMissing{false};
-
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_VALID, "b", &valid);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_SIG_EXPIRED, "b", &sigExpired);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXPIRED, "b", &keyExpired);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_REVOKED, "b", &keyRevoked);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_MISSING, "b", &keyMissing);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_FINGERPRINT, "&s", &fingerprint);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_FINGERPRINT_PRIMARY, "&s",
-                                &fingerprintPrimary);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_TIMESTAMP, "x", &timestamp);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_EXP_TIMESTAMP, "x",
-                                &exp_timestamp);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_PUBKEY_ALGO_NAME, "&s",
-                                &pubkey_algo);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_USER_NAME, "&s", &user_name);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_USER_EMAIL, "&s", &user_email);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXP_TIMESTAMP, "x",
-                                &key_exp_timestamp);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXP_TIMESTAMP_PRIMARY, "x",
-                                &key_exp_timestamp_primary);
-
-            // create signature struct
-            Signature sig;
-
-            sig.valid = valid;
-            sig.sigExpired = sigExpired;
-            sig.keyExpired = keyExpired;
-            sig.keyRevoked = keyRevoked;
-            sig.keyMissing = keyMissing;
-            sig.fingerprint = fingerprint;
-            sig.fingerprintPrimary = fingerprintPrimary;
-            sig.timestamp = Timepoint(std::chrono::seconds(timestamp));
-            sig.expireTimestamp = Timepoint(std::chrono::seconds(exp_timestamp));
-            sig.pubkeyAlgorithm = pubkey_algo;
-            sig.username = user_name;
-            sig.usermail = user_email;
-            sig.keyExpireTimestamp = Timepoint(std::chrono::seconds(key_exp_timestamp));
-            sig.keyExpireTimestampPrimary =
-                Timepoint(std::chrono::seconds(key_exp_timestamp_primary));
-
-            commit.signatures.push_back(std::move(sig));
-        }
+        details.signatures =
+            verifier.Verify(repo, hash, variant, details.detachedMetadata.get());
+        cache.Store(hash, details.signatures);
     }
 
-    return commit;
+    return details;
 }
 
 // modified log_commit() from
 // https://github.com/ostreedev/ostree/blob/main/src/ostree/ot-builtin-log.c#L40
-gboolean OSTreeRepo::parseCommitsRecursive(OstreeRepo* repo,
-                                           const gchar* checksum,
-                                           GError** error,
-                                           CommitList* commitList,
-                                           const std::string& branch,
-                                           gboolean isRecurse) {
-    GError* local_error{nullptr};
-
-    g_autoptr(GVariant) variant = nullptr;
-    if (!ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, checksum, &variant,
-                                  &local_error)) {
-        return isRecurse && g_error_matches(local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
-    }
-
-    commitList->insert({static_cast<std::string>(checksum),
-                        parseCommit(variant, branch, static_cast<std::string>(checksum))});
+gboolean OSTreeRepo::walkCommits(OstreeRepo* repo,
+                                 const gchar* checksum,
+                                 const CommitVisitor& visitor) const {
+    g_autofree char* current = g_strdup(checksum);
+    gboolean isParent{false};
+    const CommitReader reader(repo);
+
+    while (current != nullptr) {
+        GError* local_error{nullptr};
+        g_autoptr(GVariant) variant = nullptr;
+        if (!reader.Load(current, &variant, &local_error)) {
+            // history might end in a commit, that has not been pulled
+            gboolean ret =
+                isParent && g_error_matches(local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+            g_error_free(local_error);
+            return ret;
+        }
 
-    // parent recursion
-    g_autofree char* parent = ostree_commit_get_parent(variant);
+        if (!visitor(current, variant)) {
+            return true;
+        }
 
-    return !(parent && !parseCommitsRecursive(repo, parent, error, commitList, branch, true));
+        // continue with parent
+        char* parent = ostree_commit_get_parent(variant);
+        g_free(current);
+        current = parent;
+        isParent = true;
+    }
+    return true;
 }
 
-CommitList OSTreeRepo::parseCommitsOfBranch(const std::string& branch) {
-    auto ret = CommitList();
-
+void OSTreeRepo::parseCommitsOfBranch(const std::string& branch,
+                                      RepoData& data,
+                                      const LoadOptions& options) const {
     // open repo
     GError* error = nullptr;
     OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
     if (repo == nullptr) {
         g_printerr("Error opening repository: %s\n", error->message);
         g_error_free(error);
-        return ret;
+        return;
     }
 
-    // recursive commit log
-    g_autofree char* checksum = nullptr;
-    if (!ostree_repo_resolve_rev(repo, branch.c_str(), false, &checksum, &error)) {
-        return ret;
+    // commit log
+    auto head = data.branchHeads.find(branch);
+    if (head == data.branchHeads.end()) {
+        g_object_unref(repo);
+        return;
     }
 
-    parseCommitsRecursive(repo, checksum, &error, &ret, branch);
+    size_t loaded{0};
+    std::string_view branchText = data.arena->Store(branch);
+    walkCommits(repo, head->second.c_str(), [&](std::string_view hash, GVariant* variant) {
+        // reached history of a previously parsed branch
+        if (data.commits.contains(hash)) {
+            return false;
+        }
+        // cut off history, can be loaded later on with LoadHistoryPage()
+        if (exceedsLoadOptions(variant, loaded, options)) {
+            data.historyFrontiers[branch] = hash;
+            return false;
+        }
+        Commit commit = parseCommit(variant, branchText, hash, *data.arena);
+        data.commits.insert({commit.hash, commit});
+        loaded++;
+        return true;
+    });
 
-    return ret;
+    g_object_unref(repo);
 }
 
-CommitList OSTreeRepo::parseCommitsAllBranches() {
-    std::istringstream branches_string(getBranchesAsString());
-    std::string branch;
+bool OSTreeRepo::exceedsLoadOptions(GVariant* variant,
+                                    size_t loadedCommits,
+                                    const LoadOptions& options) {
+    // always load the head
+    if (loadedCommits == 0) {
+        return false;
+    }
+    if (options.depth > 0 && loadedCommits >= options.depth) {
+        return true;
+    }
+    if (options.since.has_value()) {
+        auto timestamp = Timepoint(std::chrono::seconds(ostree_commit_get_timestamp(variant)));
+        return timestamp < options.since.value();
+    }
+    return false;
+}
+
+bool OSTreeRepo::StreamCommits(const CommitCallback& callback) const {
+    // open repo
+    GError* error = nullptr;
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
 
-    CommitList commits_all_branches;
+    // all heads are read first, so that they are known when commits get reported
+    RepoData data;
+    parseBranches(data, loadOptions);
+    std::vector<std::string> heads;
+    std::unordered_map<std::string, std::vector<std::string>> headRefs;
+    for (const auto& branch : data.branches) {
+        heads.push_back(data.branchHeads.at(branch));
+        headRefs[heads.back()].push_back(branch);
+    }
 
-    while (branches_string >> branch) {
-        auto commits = parseCommitsOfBranch(branch);
-        commits_all_branches.insert(commits.begin(), commits.end());
+    // every commit belongs to the first branch reaching it: each history is only walked until
+    // it joins the one of an earlier branch. Cut off histories might not reach the join, so
+    // reported hashes are remembered instead (bounded by the limits), also as the fallback.
+    const bool limited = loadOptions.depth > 0 || loadOptions.since.has_value();
+    const CommitReader reader(repo);
+    const std::optional<std::vector<std::string>> joins =
+        limited ? std::nullopt : findHistoryJoins(reader, heads);
+    std::unordered_set<std::string> reported;
+    StringArena arena;
+    const SignatureVerifier verifier(repo);
+    const std::vector<std::string> noRefs;
+    for (size_t i{0}; i < heads.size(); i++) {
+        const std::string& branch = data.branches[i];
+        size_t loaded{0};
+        walkCommits(repo, heads[i].c_str(), [&](std::string_view hash, GVariant* variant) {
+            if (joins.has_value() ? hash == joins->at(i) : reported.contains(std::string(hash))) {
+                return false;
+            }
+            // cut off history, like in UpdateData()
+            if (exceedsLoadOptions(variant, loaded, loadOptions)) {
+                return false;
+            }
+            if (!joins.has_value()) {
+                reported.emplace(hash);
+            }
+            loaded++;
+            // the arena only has to hold a single commit, its block is reused
+            arena.Reset();
+            std::string_view branchText = arena.Store(branch);
+            auto refs = headRefs.find(std::string(hash));
+            callback(parseCommit(variant, branchText, hash, arena),
+                     parseCommitDetails(repo, variant, std::string(hash), *signatureCache,
+                                        verifier),
+                     refs == headRefs.end() ? noRefs : refs->second);
+            return true;
+        });
     }
 
-    return commits_all_branches;
+    g_object_unref(repo);
+    return true;
 }
 
-std::string OSTreeRepo::getBranchesAsString() {
-    std::string branches_str;
-
+void OSTreeRepo::parseBranches(RepoData& data, const LoadOptions& options) const {
     // open repo
     GError* error{nullptr};
     OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
-
     if (repo == nullptr) {
         g_printerr("Error opening repository: %s\n", error->message);
         g_error_free(error);
-        return "";
+        return;
     }
-
-    // get a list of refs
-    GHashTable* refs_hash{nullptr};
-    gboolean result = ostree_repo_list_refs_ext(repo, nullptr, &refs_hash,
-                                                OSTREE_REPO_LIST_REFS_EXT_NONE, nullptr, &error);
-    if (!result) {
-        g_printerr("Error listing refs: %s\n", error->message);
-        g_error_free(error);
-        g_object_unref(repo);
+    std::optional<RefSnapshot> snapshot = ReadRefSnapshot(repo);
+    g_object_unref(repo);
+    if (!snapshot.has_value()) {
         // TODO exit with error
-        return "";
+        return;
     }
 
-    // iterate through the refs
-    GHashTableIter iter;
-    gpointer key{nullptr};
-    gpointer value{nullptr};
-    g_hash_table_iter_init(&iter, refs_hash);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        const gchar* ref_name = static_cast<const gchar*>(key);
-        branches_str += " " + std::string(ref_name);
+    for (auto& [ref, head] : snapshot->refs) {
+        const bool matches =
+            options.refs.empty() ||
+            std::any_of(options.refs.begin(), options.refs.end(),
+                        [&](const RefPattern& pattern) { return pattern.Matches(ref); });
+        if (!matches) {
+            data.skippedBranches.push_back(std::move(ref));
+            continue;
+        }
+        data.branchHeads[ref] = std::move(head);
+        data.branches.push_back(std::move(ref));
     }
-
-    // free
-    g_hash_table_unref(refs_hash);
-
-    return branches_str;
 }
 
 /// TODO This implementation should not rely on the ostree CLI -> change to libostree usage.
@@ -321,19 +1013,29 @@ bool OSTreeRepo::PromoteCommit(const std::string& hash,
                                const std::vector<std::string> addMetadataStrings,
                                const std::string& newSubject,
                                bool keepMetadata) {
-    if (hash.size() <= 0 || newRef.size() <= 0) {
+    if (!isValidRef(newRef) || !isValidHash(hash)) {
+        return false;
+    }
+    if (hasControlCharacters(newSubject) ||
+        std::any_of(addMetadataStrings.begin(), addMetadataStrings.end(),
+                    [](const std::string& str) { return hasControlCharacters(str); })) {
+        g_printerr("Invalid subject, or metadata: contains control characters\n");
         return false;
     }
 
-    std::string command = "ostree commit";
-    command += " --repo=" + repoPath;
-    command += " -b " + newRef;
-    command += (newSubject.size() <= 0 ? "" : " -s \"" + newSubject + "\"");
-    command += (keepMetadata ? "" : " --keep-metadata");
-    for (auto str : addMetadataStrings) {
-        command += " --add-metadata-string=\"" + str + "\"";
+    std::vector<std::string> command{"ostree", "commit"};
+    command.push_back("--repo=" + repoPath);
+    command.push_back("--branch=" + newRef);
+    if (!newSubject.empty()) {
+        command.push_back("--subject=" + newSubject);
+    }
+    if (!keepMetadata) {
+        command.emplace_back("--keep-metadata");
     }
-    command += " --tree=ref=" + hash;
+    for (const auto& str : addMetadataStrings) {
+        command.push_back("--add-metadata-string=" + str);
+    }
+    command.push_back("--tree=ref=" + hash);
 
     return runCLICommand(command);
 }
@@ -341,32 +1043,77 @@ bool OSTreeRepo::PromoteCommit(const std::string& hash,
 /// TODO This implementation should not rely on the ostree CLI -> change to libostree usage.
 bool OSTreeRepo::RemoveCommitFromBranchAndPrune(const Commit& commit) {
     // reset head if it is last commit on the branch
-    if (IsMostRecentCommitOnBranch(commit)) {
-        std::string command = "ostree reset";
-        command += " --repo=" + repoPath;
-        command += " " + commit.branch;
-        command += " " + commit.branch + "^";
+    return RemoveCommitAndPrune(std::string(commit.hash), std::string(commit.branch),
+                                IsMostRecentCommitOnBranch(commit));
+}
 
-        if (!runCLICommand(command)) {
+bool OSTreeRepo::RemoveCommitAndPrune(const std::string& hash,
+                                      const std::string& branch,
+                                      bool resetHead) {
+    // orphaned commits have no ref to reset
+    if (!isValidHash(hash) || (resetHead && !isValidRef(branch))) {
+        return false;
+    }
+    if (resetHead) {
+        if (!runCLICommand({"ostree", "reset", "--repo=" + repoPath, branch, branch + "^"})) {
             return false;
         };
     }
 
     // prune commit
-    std::string command2 = "ostree prune";
-    command2 += " --repo=" + repoPath;
-    command2 += " --delete-commit=" + commit.hash;
+    return runCLICommand({"ostree", "prune", "--repo=" + repoPath, "--delete-commit=" + hash});
+}
 
-    return runCLICommand(command2);
+bool OSTreeRepo::PruneOrphanedCommits(size_t& objectsPruned, uint64_t& bytesPruned) const {
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
+    gint objectsTotal{0};
+    gint pruned{0};
+    guint64 freed{0};
+    // every ref is traversed completely, so only unreachable objects are deleted
+    const bool success =
+        ostree_repo_prune(repo, OSTREE_REPO_PRUNE_FLAGS_REFS_ONLY, -1, &objectsTotal, &pruned,
+                          &freed, nullptr, &error);
+    if (success) {
+        objectsPruned = static_cast<size_t>(pruned);
+        bytesPruned = freed;
+    } else {
+        g_printerr("Error pruning repository: %s\n", error->message);
+        g_error_free(error);
+    }
+    g_object_unref(repo);
+    return success;
 }
 
 bool OSTreeRepo::ResetBranchHeadAndPrune(const std::string& branch) {
     return RemoveCommitFromBranchAndPrune(GetMostRecentCommitOfBranch(branch));
 }
 
-bool OSTreeRepo::runCLICommand(const std::string& command) {
-    std::unique_ptr<FILE, int (*)(FILE*)> pipe(popen(command.c_str(), "r"), &pclose);
-    if (!pipe) {
+bool OSTreeRepo::runCLICommand(const std::vector<std::string>& command) {
+    // no shell in between, every argument is passed as it is
+    std::vector<gchar*> argv;
+    for (const auto& argument : command) {
+        argv.push_back(const_cast<gchar*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    g_autofree gchar* standardError{nullptr};
+    gint waitStatus{0};
+    GError* error{nullptr};
+    if (!g_spawn_sync(nullptr, argv.data(), nullptr,
+                      static_cast<GSpawnFlags>(G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL),
+                      nullptr, nullptr, nullptr, &standardError, &waitStatus, &error)) {
+        g_printerr("Error running %s: %s\n", argv.at(0), error->message);
+        g_error_free(error);
+        return false;
+    }
+    if (!WIFEXITED(waitStatus) || WEXITSTATUS(waitStatus) != 0) {
+        g_printerr("%s %s failed: %s", argv.at(0), argv.at(1), standardError);
         return false;
     }
     return true;
@@ -374,7 +1121,7 @@ bool OSTreeRepo::runCLICommand(const std::string& command) {
 
 const Commit& OSTreeRepo::GetMostRecentCommitOfBranch(const std::string& branch) const {
     Timepoint latestTimestamp;
-    std::string latestHash;
+    std::string_view latestHash;
 
     for (const auto& [hash, check] : commitList) {
         if (check.timestamp <= latestTimestamp) {
@@ -394,7 +1141,7 @@ const Commit& OSTreeRepo::GetMostRecentCommitOfBranch(const std::string& branch)
 }
 
 bool OSTreeRepo::IsMostRecentCommitOnBranch(const Commit& commit) const {
-    return GetMostRecentCommitOfBranch(commit.branch).hash == commit.hash;
+    return GetMostRecentCommitOfBranch(std::string(commit.branch)).hash == commit.hash;
 }
 
 bool OSTreeRepo::IsMostRecentCommitOnBranch(const std::string& hash) const {
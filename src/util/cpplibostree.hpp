@@ -15,8 +15,15 @@
 // C++
 #include <sys/types.h>
 #include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 // C
 #include <fcntl.h>
@@ -26,12 +33,19 @@
 #include <glib.h>
 #include <ostree.h>
 
+#include "refPattern.hpp"
+#include "stringArena.hpp"
+
 namespace cpplibostree {
 
+/// pseudo-branch of loaded commits, that no ref reaches (not a valid ref name)
+constexpr std::string_view ORPHANED_BRANCH{"(orphaned)"};
+
 using Clock = std::chrono::utc_clock;
 using Timepoint = std::chrono::time_point<Clock>;
 
 struct Signature {
+    std::string scheme{"gpg"};  // "gpg", or "ed25519" (`ostree sign`), see signatureVerifier.hpp
     bool valid{false};
     bool sigExpired{true};
     bool keyExpired{true};
@@ -48,20 +62,83 @@ struct Signature {
     Timepoint keyExpireTimestampPrimary;
 } __attribute__((aligned(128)));
 
+/// Commit data needed to draw the commit tree. All text points into the StringArena of the
+/// OSTreeRepo, that loaded the commit, and stays valid until its next UpdateData().
 struct Commit {
-    std::string hash;
+    std::string_view hash;
+    std::string_view subject{"OSTree TUI Error - invalid commit state"};
+    std::string_view version;
+    Timepoint timestamp;
+    std::string_view parent;
+    std::string_view branch;
+} __attribute__((aligned(128)));
+
+/// Reference to an immutable GVariant, that may be shared across threads
+using SharedVariant = std::shared_ptr<GVariant>;
+
+/// Rarely needed commit data, decoded on demand (see OSTreeRepo::GetCommitDetails())
+struct CommitDetails {
     std::string contentChecksum;
-    std::string subject{"OSTree TUI Error - invalid commit state"};
     std::string body;
-    std::string version;
-    Timepoint timestamp;
-    std::string parent;
-    std::string branch;
     std::vector<Signature> signatures;
-} __attribute__((aligned(128)));
+    // a{sv} dictionaries, not decoded until displayed (see commitMetadata.hpp)
+    SharedVariant metadata;
+    SharedVariant detachedMetadata;  // .commitmeta, might be missing
+};
+
+// map commit hash to commit (keys point to Commit::hash)
+using CommitList = std::unordered_map<std::string_view, Commit>;
+
+class CommitIndex;
+class ReachabilityIndex;
+class SignatureCache;
+class SignatureVerifier;
+
+/// Limits for the initially loaded history of every branch (the head is always loaded)
+struct LoadOptions {
+    size_t depth{0};                 // maximum commits per branch, 0 = unlimited
+    std::optional<Timepoint> since;  // only load commits from this point in time on
+    std::vector<RefPattern> refs;    // only load refs matching any pattern, empty = all refs
+};
+
+/// Older commits, loaded by OSTreeRepo::LoadHistoryPage()
+struct HistoryPage {
+    size_t loadGeneration{0};
+    std::unique_ptr<StringArena> arena{std::make_unique<StringArena>()};
+    CommitList commits;
+    std::unordered_map<std::string, std::string> historyFrontiers;
+};
 
-// map commit hash to commit
-using CommitList = std::unordered_map<std::string, Commit>;
+/// Immutable runs of loaded commit hashes, shared with history page loads on other threads
+using LoadedHashRuns = std::vector<std::shared_ptr<const std::unordered_set<std::string>>>;
+
+/// Where OSTreeRepo::LoadHistoryPage() continues, taken on the owner's thread (see
+/// GetHistoryPageRequest())
+struct HistoryPageRequest {
+    std::unordered_map<std::string, std::string> frontiers;  // see GetHistoryFrontiers()
+    size_t loadGeneration{0};                                // see GetLoadGeneration()
+    LoadedHashRuns loaded;  // a page ends, where it reaches the loaded history
+};
+
+/// What OSTreeRepo::LoadRepoData() loads, taken on the owner's thread (see GetLoadSettings())
+struct LoadSettings {
+    LoadOptions options;
+    std::vector<std::string> orphanedCommits;  // loaded on the ORPHANED_BRANCH
+};
+
+/// Refs & commits, loaded by OSTreeRepo::LoadRepoData()
+struct RepoData {
+    std::vector<std::string> branches;
+    std::vector<std::string> skippedBranches;
+    std::unordered_map<std::string, std::string> branchHeads;
+    std::unique_ptr<StringArena> arena{std::make_unique<StringArena>()};
+    CommitList commits;
+    std::unordered_map<std::string, std::string> historyFrontiers;
+    std::vector<std::string> orphanedCommits;
+};
+
+/// Progress of OSTreeRepo::LoadRepoData(): walked & total branches, return false to cancel
+using LoadProgressCallback = std::function<bool(size_t loadedBranches, size_t totalBranches)>;
 
 /**
  * @brief OSTreeRepo functions as a C++ wrapper around libostree's OstreeRepo.
@@ -71,16 +148,47 @@ using CommitList = std::unordered_map<std::string, Commit>;
 class OSTreeRepo {
    private:
     std::string repoPath;
+    // text of all loaded commits, one arena per UpdateData(), merged history page & delta
+    // (shared with copies of the commit list, see GetCommitArenas() & compactCommitArenas())
+    std::vector<std::shared_ptr<const StringArena>> commitArenas;
     CommitList commitList;
+    size_t stateVersion{0};  // incremented whenever the loaded state changes
     std::vector<std::string> branches;
+    std::vector<std::string> skippedBranches;  // refs not matching LoadOptions::refs
+    std::unordered_map<std::string, std::string> branchHeads;  // map branch -> head commit hash
+    std::unique_ptr<ReachabilityIndex> reachabilityIndex;
+    std::unique_ptr<CommitIndex> commitIndex;
+    std::unique_ptr<SignatureCache> signatureCache;  // verified signatures, kept on disk
+
+    // partial history loading
+    LoadOptions loadOptions;
+    size_t loadGeneration{0};  // incremented on every UpdateData()
+    // hashes of the commit list, one run per load & merged page (merged like a binary counter)
+    LoadedHashRuns loadedHashes;
+    // map branch -> first commit, that is not loaded yet
+    std::unordered_map<std::string, std::string> historyFrontiers;
+
+    // commits, that no ref reaches, shown on the ORPHANED_BRANCH (reloaded on every UpdateData())
+    std::vector<std::string> orphanedCommits;
+
+    // commit sizes never change, so they are kept across reloads
+    mutable std::mutex commitSizeMutex;
+    mutable std::unordered_map<std::string, uint64_t> commitSizes;
+
+    // lazily decoded commit details, dropped on every UpdateData() (signatures may change)
+    mutable std::mutex commitDetailsMutex;
+    mutable std::unordered_map<std::string, std::shared_ptr<const CommitDetails>> commitDetails;
 
    public:
     /**
      * @brief Construct a new OSTreeRepo.
      *
      * @param repoPath Path to the OSTree Repository
+     * @param loadData Parse all commits right away (see UpdateData()).
      */
-    explicit OSTreeRepo(std::string repoPath);
+    explicit OSTreeRepo(std::string repoPath, bool loadData = true);
+
+    ~OSTreeRepo();
 
     /**
      * @brief Return a C-style pointer to a libostree OstreeRepo. This exists, to be
@@ -96,6 +204,33 @@ class OSTreeRepo {
     [[nodiscard]] const CommitList& GetCommitList() const;
     /// Getter
     [[nodiscard]] const std::vector<std::string>& GetBranches() const;
+    /// Getter: refs, that are not loaded at all, because they do not match LoadOptions::refs
+    [[nodiscard]] const std::vector<std::string>& GetSkippedBranches() const;
+    /// Getter: map branch -> hash of its head commit
+    [[nodiscard]] const std::unordered_map<std::string, std::string>& GetBranchHeads() const;
+    /// Getter: reachability of all loaded commits, rebuilt on every UpdateData()
+    [[nodiscard]] const ReachabilityIndex& GetReachabilityIndex() const;
+    /// Getter: sorted checksums of all loaded commits, rebuilt whenever commits are loaded
+    [[nodiscard]] const CommitIndex& GetCommitIndex() const;
+    /// Getter: map branch -> first commit, that is not loaded yet
+    [[nodiscard]] const std::unordered_map<std::string, std::string>& GetHistoryFrontiers() const;
+    /// Getter: orphaned commits loaded on the ORPHANED_BRANCH
+    [[nodiscard]] const std::vector<std::string>& GetOrphanedCommits() const;
+    /// Setter: limits for the history loaded by UpdateData()
+    void SetLoadOptions(const LoadOptions& options);
+    /// Getter: copy of the load options & orphaned commits, for a load on another thread
+    [[nodiscard]] LoadSettings GetLoadSettings() const;
+    /// Getter: memory used for the text of all loaded commits
+    [[nodiscard]] StringArenaStatistics GetCommitTextStatistics() const;
+    /// Getter: storage of the text of all loaded commits, keeps a copy of the commit list valid
+    /// after the next reload (e.g. for a snapshot read on another thread)
+    [[nodiscard]] const std::vector<std::shared_ptr<const StringArena>>& GetCommitArenas() const;
+    /// Getter: changes whenever refs, or commits get loaded, or unloaded
+    [[nodiscard]] size_t GetStateVersion() const;
+    /// Getter: changes whenever the repository gets (re-)loaded, see LoadHistoryPage()
+    [[nodiscard]] size_t GetLoadGeneration() const;
+    /// Getter: frontiers, load generation & loaded hashes for the next LoadHistoryPage()
+    [[nodiscard]] HistoryPageRequest GetHistoryPageRequest() const;
 
     // Methods
 
@@ -107,21 +242,186 @@ class OSTreeRepo {
      */
     bool UpdateData();
 
+    /**
+     * @brief Load the refs & commits, like UpdateData() does, without touching the loaded
+     * state. This only reads the repository on disk & the given settings, so it may run on a
+     * worker thread. The result has to be applied with ApplyRepoData().
+     *
+     * @param settings GetLoadSettings(), taken when the load got requested.
+     * @param progress Called after every walked branch, might cancel the load.
+     * @return Loaded data, or nothing if cancelled
+     */
+    [[nodiscard]] std::optional<RepoData> LoadRepoData(
+        const LoadSettings& settings,
+        const LoadProgressCallback& progress = nullptr) const;
+
+    /**
+     * @brief Load the changes of the refs since the last load of a complete history (without
+     * LoadOptions limits). Only commits, that are not loaded yet, are read from disk: the walk
+     * of a ref continues over the loaded commits in memory, so every commit belongs to the
+     * same branch as after a complete load. Objects removed without a ref change (e.g. pruned
+     * history) are not detected. The result has to be applied with ApplyRepoDelta().
+     *
+     * @param removedCommits Set to the loaded commits, that no ref reaches anymore.
+     * @return Refs & the added (or moved) commits, or nothing if the repository can't be opened
+     */
+    [[nodiscard]] std::optional<RepoData> LoadRepoDelta(
+        std::vector<std::string>& removedCommits) const;
+
+    /**
+     * @brief Replace the loaded state by data loaded with LoadRepoData() & rebuild the
+     * indexes. History pages loaded before are ignored afterwards.
+     *
+     * @param data Data loaded by LoadRepoData().
+     */
+    void ApplyRepoData(RepoData&& data);
+
+    /**
+     * @brief Apply the changes of the repository since the last load (e.g. received from the
+     * index daemon, see repoDaemon.hpp): The refs are replaced, the loaded commits are kept,
+     * except for the removed ones, and the indexes are rebuilt. History pages loaded before
+     * are ignored afterwards.
+     *
+     * @param data All refs & heads, but only the added (or moved) commits.
+     * @param removedCommits Commits, that are gone.
+     */
+    void ApplyRepoDelta(RepoData&& data, const std::vector<std::string>& removedCommits);
+
+    /**
+     * @brief Check, if the history of any branch was cut off by the LoadOptions.
+     *
+     * @return true if older commits can be loaded with LoadHistoryPage()
+     */
+    [[nodiscard]] bool HasMoreHistory() const;
+
+    /**
+     * @brief Load the next older commits of all branches, whose history is cut off. This
+     * only reads the repository on disk (not the loaded state), so it may run on a worker
+     * thread. The walk of a branch stops at the first commit, that is already loaded. The
+     * result has to be applied with MergeHistoryPage().
+     *
+     * @param request GetHistoryPageRequest(), taken on the owner's thread.
+     * @param pageSize Maximum amount of commits to load per branch.
+     * @return Loaded commits & new frontiers
+     */
+    [[nodiscard]] HistoryPage LoadHistoryPage(const HistoryPageRequest& request,
+                                              size_t pageSize) const;
+
+    /**
+     * @brief Add the commits of a history page to the commit list. Pages, that were loaded
+     * before the last UpdateData(), are ignored.
+     *
+     * @param page Page loaded by LoadHistoryPage().
+     * @return true if the page got merged
+     */
+    bool MergeHistoryPage(HistoryPage&& page);
+
+    /**
+     * @brief Load commits, that no ref reaches (see RepoStatistics::orphanedCommits), into the
+     * commit list, on the pseudo-branch ORPHANED_BRANCH. They are loaded again on every
+     * UpdateData(), until they got pruned. Commits, that are missing, or reachable again, are
+     * skipped.
+     *
+     * @param hashes Orphaned commits, an empty list removes the loaded ones.
+     * @return Amount of loaded orphaned commits
+     */
+    size_t SetOrphanedCommits(std::vector<std::string> hashes);
+
+    /// Callback for a single decoded commit & the refs pointing to it, only valid during the call
+    using CommitCallback = std::function<void(const Commit& commit,
+                                              const CommitDetails& details,
+                                              const std::vector<std::string>& refs)>;
+
+    /**
+     * @brief Walk the commits of all branches with the same loader as UpdateData(), but hand
+     * every commit (including its details) to `callback` right after it was decoded, instead of
+     * storing it in the commit list (or any other state of the repository). The load options
+     * apply, like in UpdateData(). Commits reachable from multiple branches are only reported
+     * once. Without limits, the memory does not grow with the history.
+     *
+     * @param callback Called once per commit.
+     * @return false, if the repository could not be opened
+     */
+    bool StreamCommits(const CommitCallback& callback) const;
+
+    /**
+     * @brief Get the details (body, content checksum & signatures) of a commit. They are
+     * decoded & verified on first access and cached until the next UpdateData(). Thread safe.
+     *
+     * @param hash Hash of the commit.
+     * @return Details of the commit (empty, if the commit could not be loaded)
+     */
+    [[nodiscard]] std::shared_ptr<const CommitDetails> GetCommitDetails(
+        const std::string& hash) const;
+
+    /**
+     * @brief Get the details of a commit, only if GetCommitDetails() already decoded them.
+     * Thread safe.
+     *
+     * @param hash Hash of the commit.
+     * @return Details of the commit, or nullptr if not decoded yet
+     */
+    [[nodiscard]] std::shared_ptr<const CommitDetails> FindCommitDetails(
+        const std::string& hash) const;
+
+    /**
+     * @brief Write the signature cache file now (see signatureCache.hpp), instead of only on
+     * destruction. Thread safe.
+     *
+     * @return true on success
+     */
+    bool SaveSignatureCache() const;
+
+    /// Getter: commits, whose cached signatures were verified with other (older) keyrings
+    [[nodiscard]] std::vector<std::string> GetStaleSignatureCommits() const;
+
+    /**
+     * @brief Get the signatures of a batch of commits, without decoding their details: cached
+     * ones are taken from the signature cache, all others are verified (sharing one verifier)
+     * and cached. Commits, that got pruned, are dropped from the cache. Thread safe, batches may
+     * be verified in parallel.
+     *
+     * @param hashes Hashes of the commits (e.g. see GetStaleSignatureCommits()).
+     * @return Signatures of every commit (empty, if not signed, or missing)
+     */
+    std::vector<std::vector<Signature>> VerifySignatures(
+        const std::vector<std::string>& hashes) const;
+
     /**
      * @brief Check if a certain commit is signed. This simply accesses the
-     * size() of commit.signatures.
+     * size() of details.signatures.
      *
-     * @param commit
+     * @param details see GetCommitDetails()
      * @return true if the commit is signed
      * @return false if the commit is not signed
      */
-    [[nodiscard]] static bool IsCommitSigned(const Commit& commit);
+    [[nodiscard]] static bool IsCommitSigned(const CommitDetails& details);
+
+    /**
+     * @brief Get the size of a commit, if it was already computed by ComputeCommitSize().
+     *
+     * @param hash Hash of the commit.
+     * @return Size in bytes, or nothing if not yet known.
+     */
+    [[nodiscard]] std::optional<uint64_t> GetCommitSize(const std::string& hash) const;
+
+    /**
+     * @brief Compute (and cache) the size of a commit: The storage size of all objects in
+     * its tree, that are not part of its parents tree. This traverses both trees, so it
+     * should not be called on the UI thread. Thread safe.
+     *
+     * @param hash Hash of the commit.
+     * @param parent Hash of the parent commit (or "(no parent)").
+     * @return Size in bytes
+     */
+    uint64_t ComputeCommitSize(const std::string& hash, const std::string& parent) const;
 
     // read & write access to OSTree repo:
 
     /**
      * @brief Promotes a commit to another branch. Similar to:
      * `ostree commit --repo=repo -b newRef -s newSubject --tree=ref=hash`
+     * Invalid refs & a subject, or metadata with control characters are rejected.
      *
      * @param hash hash of the commit to promote
      * @param newRef branch to promote to
@@ -152,6 +452,28 @@ class OSTreeRepo {
      */
     bool RemoveCommitFromBranchAndPrune(const Commit& commit);
 
+    /**
+     * @brief Like RemoveCommitFromBranchAndPrune(), without looking at the loaded state (so it
+     * may run on a worker thread).
+     *
+     * @param hash Commit to remove.
+     * @param branch Branch of the commit.
+     * @param resetHead Reset the head of the branch (the commit is its most recent one).
+     * @return True on success.
+     */
+    bool RemoveCommitAndPrune(const std::string& hash, const std::string& branch, bool resetHead);
+
+    /**
+     * @brief Prune all objects, that no ref reaches (including all orphaned commits), similar
+     * to `ostree prune --refs-only`. Only touches the repository on disk, the pruned orphaned
+     * commits are unloaded by the next UpdateData().
+     *
+     * @param objectsPruned Set to the amount of deleted objects.
+     * @param bytesPruned Set to the freed storage.
+     * @return True on success.
+     */
+    bool PruneOrphanedCommits(size_t& objectsPruned, uint64_t& bytesPruned) const;
+
     /**
      * @brief Resets the specified branch head by one commit, similar to `git reset HEAD~`
      *
@@ -186,67 +508,118 @@ class OSTreeRepo {
 
    private:
     /**
-     * @brief Parse commits from a ostree log output to a commitList, mapping
-     * the hashes to commits.
+     * @brief Parse all commits of a branch into the commit list of `data`. Stops at the first
+     * commit, that is already part of the list (reached history of another branch).
      *
-     * @param branch
-     * @return std::unordered_map<std::string,Commit>
+     * @param branch Branch to parse.
+     * @param data Data to parse the commits & the history frontier into.
+     * @param options Limits of the loaded history.
      */
-    CommitList parseCommitsOfBranch(const std::string& branch);
+    void parseCommitsOfBranch(const std::string& branch,
+                              RepoData& data,
+                              const LoadOptions& options) const;
 
     /**
-     * @brief Performs parseCommitsOfBranch() on all available branches and
-     * merges all commit lists into one.
+     * @brief Load orphaned commits into a commit list (the indexes are not rebuilt).
      *
-     * @return std::unordered_map<std::string,Commit>
+     * @param hashes Orphaned commits, the missing & already loaded ones are removed.
+     * @param commits Commit list to load the commits into.
+     * @param arena Storage for the text of the loaded commits.
      */
-    CommitList parseCommitsAllBranches();
+    void loadOrphanedCommits(std::vector<std::string>& hashes,
+                             CommitList& commits,
+                             StringArena& arena) const;
 
     /**
-     * @brief Execute a command on the CLI.
+     * @brief Copy the text of all loaded commits into a single new arena, once most of the
+     * stored text belongs to replaced or removed commits (e.g. after many deltas). The old
+     * arenas are released, unless a copy of the commit list still holds them. The indexes
+     * have to be rebuilt afterwards.
+     */
+    void compactCommitArenas();
+
+    /// @brief Replace the loaded hashes with the ones of the commit list.
+    void resetLoadedHashes();
+
+    /// @brief Add a run of newly loaded hashes, smaller runs are merged into it.
+    void appendLoadedHashes(std::unordered_set<std::string> hashes);
+
+    /**
+     * @brief Execute a command on the CLI (without a shell, the arguments are not interpreted).
      *
      * @warning If possible, use proper `libostree` access, not per command line access.
      *
-     * @param command Command to execute.
-     * @return true on success
+     * @param command Program & its arguments.
+     * @return true, if the command exited with status 0
      */
-    [[deprecated]] bool runCLICommand(const std::string& command);
+    [[deprecated]] bool runCLICommand(const std::vector<std::string>& command);
 
     /**
-     * @brief Get all branches as a single string, separated by spaces.
-     *
-     * @return std::string All branch names, separated by spaces
+     * @brief Read the refs of the repository (see ReadRefSnapshot()) into `data.branches` and
+     * their heads into `data.branchHeads`. Refs, that do not match the LoadOptions::refs
+     * patterns, go to `data.skippedBranches` instead & are never walked.
      */
-    [[nodiscard]] std::string getBranchesAsString();
+    void parseBranches(RepoData& data, const LoadOptions& options) const;
 
     /**
-     * @brief Parse a libostree GVariant commit to a C++ commit struct.
+     * @brief Parse a libostree GVariant commit to a C++ commit struct. Only the fields needed
+     * for the commit tree are decoded, see parseCommitDetails() for the rest.
      *
      * @param variant pointer to GVariant commit
-     * @param branch branch of the commit
+     * @param branch branch of the commit (already stored in `arena`)
      * @param hash commit hash
+     * @param arena storage for the text of the commit
      * @return Commit struct
      */
-    Commit parseCommit(GVariant* variant, const std::string& branch, const std::string& hash);
+    static Commit parseCommit(GVariant* variant,
+                              std::string_view branch,
+                              std::string_view hash,
+                              StringArena& arena);
 
     /**
-     * @brief Parse all commits in a OstreeRepo into a commit vector.
+     * @brief Decode the details of a libostree GVariant commit & verify its signatures (unless
+     * they are cached).
+     *
+     * @param repo pointer to libostree Ostree repository
+     * @param variant pointer to GVariant commit
+     * @param hash commit hash
+     * @param cache cache for the verified signatures
+     * @param verifier verifier for signatures, that are not cached
+     * @return CommitDetails struct
+     */
+    static CommitDetails parseCommitDetails(OstreeRepo* repo,
+                                            GVariant* variant,
+                                            const std::string& hash,
+                                            SignatureCache& cache,
+                                            const SignatureVerifier& verifier);
+
+    /**
+     * @brief Check, if a commit lies outside of the LoadOptions.
+     *
+     * @param variant pointer to GVariant commit
+     * @param loadedCommits amount of commits already loaded on this branch
+     * @param options limits of the loaded history
+     * @return true if the commit should not be loaded initially
+     */
+    [[nodiscard]] static bool exceedsLoadOptions(GVariant* variant,
+                                                 size_t loadedCommits,
+                                                 const LoadOptions& options);
+
+    /// Visitor for walkCommits(), return false to stop walking the history
+    using CommitVisitor = std::function<bool(std::string_view hash, GVariant* variant)>;
+
+    /**
+     * @brief Walk the history of a commit (the commit itself & all its parents).
      *
      * @param repo pointer to libostree Ostree repository
      * @param checksum checksum of first commit
-     * @param error gets set, if an error occurred during parsing
-     * @param commitList commit list to parse the commits into
-     * @param branch branch to read the commit from
-     * @param isRecurse !Do not use!, or set to false. Used only for recursion.
-     * @return true if parsing was successful
-     * @return false if an error occurred during parsing
-     */
-    gboolean parseCommitsRecursive(OstreeRepo* repo,
-                                   const gchar* checksum,
-                                   GError** error,
-                                   CommitList* commitList,
-                                   const std::string& branch,
-                                   gboolean isRecurse = false);
+     * @param visitor called for every loaded commit
+     * @return true if walking was successful (a missing parent commit is not an error)
+     * @return false if an error occurred during loading
+     */
+    gboolean walkCommits(OstreeRepo* repo,
+                         const gchar* checksum,
+                         const CommitVisitor& visitor) const;
 };
 
 }  // namespace cpplibostree
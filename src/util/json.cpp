@@ -0,0 +1,383 @@
+#include "json.hpp"
+
+// C++
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace cpplibostree::json {
+
+namespace {
+
+/// nesting limit of arrays & objects, deeper documents are rejected
+constexpr size_t MAX_DEPTH{64};
+
+/// Recursive descent parser over a single document
+class Parser {
+   public:
+    explicit Parser(std::string_view text) : text(text) {}
+
+    std::optional<Value> ParseDocument() {
+        Value value;
+        if (!parseValue(value, 0)) {
+            return std::nullopt;
+        }
+        skipWhitespace();
+        if (pos != text.size()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+   private:
+    void skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' ||
+                                     text[pos] == '\n' || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    bool consume(std::string_view literal) {
+        if (text.substr(pos, literal.size()) != literal) {
+            return false;
+        }
+        pos += literal.size();
+        return true;
+    }
+
+    bool parseValue(Value& value, size_t depth) {
+        skipWhitespace();
+        if (pos >= text.size() || depth > MAX_DEPTH) {
+            return false;
+        }
+        switch (text[pos]) {
+            case '{':
+                value.type = Value::Type::OBJECT;
+                return parseObject(value, depth);
+            case '[':
+                value.type = Value::Type::ARRAY;
+                return parseArray(value, depth);
+            case '"':
+                value.type = Value::Type::STRING;
+                return parseString(value.string);
+            case 't':
+                value.type = Value::Type::BOOLEAN;
+                value.boolean = true;
+                return consume("true");
+            case 'f':
+                value.type = Value::Type::BOOLEAN;
+                return consume("false");
+            case 'n':
+                return consume("null");
+            default:
+                value.type = Value::Type::NUMBER;
+                return parseNumber(value.number);
+        }
+    }
+
+    bool parseObject(Value& value, size_t depth) {
+        pos++;
+        skipWhitespace();
+        if (consume("}")) {
+            return true;
+        }
+        while (true) {
+            skipWhitespace();
+            std::string key;
+            if (pos >= text.size() || text[pos] != '"' || !parseString(key)) {
+                return false;
+            }
+            skipWhitespace();
+            Value member;
+            if (!consume(":") || !parseValue(member, depth + 1)) {
+                return false;
+            }
+            value.object.emplace_back(std::move(key), std::move(member));
+            skipWhitespace();
+            if (consume("}")) {
+                return true;
+            }
+            if (!consume(",")) {
+                return false;
+            }
+        }
+    }
+
+    bool parseArray(Value& value, size_t depth) {
+        pos++;
+        skipWhitespace();
+        if (consume("]")) {
+            return true;
+        }
+        while (true) {
+            Value element;
+            if (!parseValue(element, depth + 1)) {
+                return false;
+            }
+            value.array.push_back(std::move(element));
+            skipWhitespace();
+            if (consume("]")) {
+                return true;
+            }
+            if (!consume(",")) {
+                return false;
+            }
+        }
+    }
+
+    bool parseNumber(double& number) {
+        // strict JSON grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+        const size_t start = pos;
+        auto digits = [this] {
+            const size_t first = pos;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+                pos++;
+            }
+            return pos > first;
+        };
+        consume("-");
+        if (consume("0")) {
+            // no leading zeros
+        } else if (!digits()) {
+            return false;
+        }
+        if (consume(".") && !digits()) {
+            return false;
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            pos++;
+            if (!consume("+")) {
+                consume("-");
+            }
+            if (!digits()) {
+                return false;
+            }
+        }
+        const std::string literal(text.substr(start, pos - start));
+        number = std::strtod(literal.c_str(), nullptr);
+        // out of range, like 1e999
+        return std::isfinite(number);
+    }
+
+    bool parseHex4(uint32_t& code) {
+        if (pos + 4 > text.size()) {
+            return false;
+        }
+        code = 0;
+        for (size_t i{0}; i < 4; i++) {
+            const char c = text[pos++];
+            code <<= 4U;
+            if (c >= '0' && c <= '9') {
+                code |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                code |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                code |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0U | (code >> 6U));
+            out += static_cast<char>(0x80U | (code & 0x3fU));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xe0U | (code >> 12U));
+            out += static_cast<char>(0x80U | ((code >> 6U) & 0x3fU));
+            out += static_cast<char>(0x80U | (code & 0x3fU));
+        } else {
+            out += static_cast<char>(0xf0U | (code >> 18U));
+            out += static_cast<char>(0x80U | ((code >> 12U) & 0x3fU));
+            out += static_cast<char>(0x80U | ((code >> 6U) & 0x3fU));
+            out += static_cast<char>(0x80U | (code & 0x3fU));
+        }
+    }
+
+    bool parseString(std::string& out) {
+        pos++;
+        while (pos < text.size()) {
+            const char c = text[pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return false;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) {
+                return false;
+            }
+            switch (text[pos++]) {
+                case '"':
+                    out += '"';
+                    break;
+                case '\\':
+                    out += '\\';
+                    break;
+                case '/':
+                    out += '/';
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    uint32_t code{0};
+                    if (!parseHex4(code)) {
+                        return false;
+                    }
+                    // characters outside the BMP are escaped as a surrogate pair
+                    if (code >= 0xd800 && code < 0xdc00) {
+                        uint32_t low{0};
+                        if (!consume("\\u") || !parseHex4(low) || low < 0xdc00 ||
+                            low >= 0xe000) {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xd800) << 10U) + (low - 0xdc00);
+                    } else if (code >= 0xdc00 && code < 0xe000) {
+                        return false;
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    std::string_view text;
+    size_t pos{0};
+};
+
+}  // namespace
+
+std::string Escape(std::string_view value) {
+    constexpr std::string_view HEX_DIGITS{"0123456789abcdef"};
+    std::string out;
+    out.reserve(value.size());
+    for (const char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    const auto code = static_cast<unsigned char>(c);
+                    out += "\\u00";
+                    out += HEX_DIGITS.at(code >> 4U);
+                    out += HEX_DIGITS.at(code & 0xfU);
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+std::string Quote(std::string_view value) {
+    return "\"" + Escape(value) + "\"";
+}
+
+const Value* Value::Find(std::string_view key) const {
+    for (const auto& [name, member] : object) {
+        if (name == key) {
+            return &member;
+        }
+    }
+    return nullptr;
+}
+
+std::string Value::GetString(std::string_view key, std::string fallback) const {
+    const Value* member = Find(key);
+    return member != nullptr && member->type == Type::STRING ? member->string : fallback;
+}
+
+double Value::GetNumber(std::string_view key, double fallback) const {
+    const Value* member = Find(key);
+    return member != nullptr && member->type == Type::NUMBER ? member->number : fallback;
+}
+
+std::optional<Value> Parse(std::string_view text) {
+    return Parser(text).ParseDocument();
+}
+
+std::string Serialize(const Value& value) {
+    switch (value.type) {
+        case Value::Type::BOOLEAN:
+            return value.boolean ? "true" : "false";
+        case Value::Type::NUMBER: {
+            // JSON has no infinity & NaN
+            if (!std::isfinite(value.number)) {
+                return "null";
+            }
+            // exactly representable integers, like ids & timestamps
+            if (std::trunc(value.number) == value.number && std::fabs(value.number) < 1e15) {
+                return std::to_string(static_cast<int64_t>(value.number));
+            }
+            std::ostringstream out;
+            out << std::setprecision(17) << value.number;
+            return out.str();
+        }
+        case Value::Type::STRING:
+            return Quote(value.string);
+        case Value::Type::ARRAY: {
+            std::string out = "[";
+            for (const auto& element : value.array) {
+                out += (out.size() > 1 ? "," : "") + Serialize(element);
+            }
+            return out + "]";
+        }
+        case Value::Type::OBJECT: {
+            std::string out = "{";
+            for (const auto& [key, member] : value.object) {
+                out += (out.size() > 1 ? "," : "") + Quote(key) + ":" + Serialize(member);
+            }
+            return out + "}";
+        }
+        case Value::Type::NUL:
+            break;
+    }
+    return "null";
+}
+
+}  // namespace cpplibostree::json
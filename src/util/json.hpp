@@ -0,0 +1,78 @@
+/*_____________________________________________________________
+ | JSON helpers
+ |   Minimal JSON string handling for the machine readable
+ |   outputs of ostree-tui & a small parser for the requests
+ |   it receives (e.g. over the daemon socket).
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cpplibostree::json {
+
+/**
+ * @brief Escape a string for usage inside a JSON string literal.
+ *
+ * @param value Raw string.
+ * @return Escaped string (without surrounding quotes)
+ */
+[[nodiscard]] std::string Escape(std::string_view value);
+
+/**
+ * @brief Build a JSON string literal.
+ *
+ * @param value Raw string.
+ * @return Escaped string in quotes
+ */
+[[nodiscard]] std::string Quote(std::string_view value);
+
+/// Parsed JSON value
+struct Value {
+    enum class Type : uint8_t { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type{Type::NUL};
+    bool boolean{false};
+    double number{0};
+    std::string string;
+    std::vector<Value> array;
+    std::vector<std::pair<std::string, Value>> object;  // members in document order
+
+    /**
+     * @brief Look up a member of an object.
+     *
+     * @param key Name of the member.
+     * @return Value of the member, or nullptr if missing (or not an object)
+     */
+    [[nodiscard]] const Value* Find(std::string_view key) const;
+
+    /// @brief String member of an object, `fallback` if missing, or not a string.
+    [[nodiscard]] std::string GetString(std::string_view key, std::string fallback = "") const;
+
+    /// @brief Number member of an object, `fallback` if missing, or not a number.
+    [[nodiscard]] double GetNumber(std::string_view key, double fallback = 0) const;
+};
+
+/**
+ * @brief Parse a JSON document (RFC 8259), e.g. a single NDJSON line.
+ *
+ * @param text Document.
+ * @return Parsed value, or nothing if the document is malformed
+ */
+[[nodiscard]] std::optional<Value> Parse(std::string_view text);
+
+/**
+ * @brief Serialize a value to a single line document (integral numbers without fraction,
+ * infinite numbers & NaN as null).
+ *
+ * @param value Value to serialize.
+ * @return JSON document
+ */
+[[nodiscard]] std::string Serialize(const Value& value);
+
+}  // namespace cpplibostree::json
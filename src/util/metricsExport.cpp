@@ -0,0 +1,189 @@
+#include "metricsExport.hpp"
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iomanip>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+// external
+#include <glib.h>
+
+#include "repoStatistics.hpp"
+#include "signatureVerifier.hpp"
+#include "threadPool.hpp"
+
+namespace cpplibostree {
+
+namespace {
+using Seconds = std::chrono::duration<double>;
+
+/// @brief Escape a label value (backslash, double quote & line feed).
+std::string escapeLabel(std::string_view value) {
+    std::string out;
+    out.reserve(value.size());
+    for (const char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+/// @brief Writes the samples of one metric family, all labeled with the repository path.
+class MetricWriter {
+   public:
+    MetricWriter(std::ostream& out, const std::string& repoPath)
+        : out(out), repoLabel("repo=\"" + escapeLabel(repoPath) + "\"") {}
+
+    /// @brief Start a metric family (all metrics are gauges).
+    void Family(const std::string& name, const std::string& help) {
+        this->name = name;
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " gauge\n";
+    }
+
+    /// @brief Sample of the current family, optionally with one more label.
+    template <typename Value>
+    void Sample(Value value, const std::string& label = "", std::string_view labelValue = "") {
+        out << name << "{" << repoLabel;
+        if (!label.empty()) {
+            out << "," << label << "=\"" << escapeLabel(labelValue) << "\"";
+        }
+        out << "} " << value << "\n";
+    }
+
+   private:
+    std::ostream& out;
+    std::string repoLabel;
+    std::string name;
+};
+}  // namespace
+
+bool ExportMetrics(OSTreeRepo& repo, const std::string& path, std::ostream& log) {
+    // load phase
+    auto phaseStart = std::chrono::steady_clock::now();
+    if (!repo.UpdateData()) {
+        log << "can't load repository " << repo.GetRepoPath() << "\n";
+        return false;
+    }
+    const Seconds loadDuration = std::chrono::steady_clock::now() - phaseStart;
+
+    // signature phase: all heads in parallel batches, cached signatures are only looked up
+    ThreadPool pool;
+    phaseStart = std::chrono::steady_clock::now();
+    std::vector<std::string> heads;
+    for (const auto& [ref, head] : repo.GetBranchHeads()) {
+        if (repo.GetCommitList().contains(head) &&
+            std::find(heads.begin(), heads.end(), head) == heads.end()) {
+            heads.push_back(head);
+        }
+    }
+    std::vector<std::future<std::vector<std::vector<Signature>>>> batches;
+    for (size_t begin{0}; begin < heads.size(); begin += SIGNATURE_BATCH_SIZE) {
+        const size_t end = std::min(begin + SIGNATURE_BATCH_SIZE, heads.size());
+        std::vector<std::string> batch(heads.begin() + static_cast<std::ptrdiff_t>(begin),
+                                       heads.begin() + static_cast<std::ptrdiff_t>(end));
+        batches.push_back(pool.Submit(
+            [&repo, batch = std::move(batch)] { return repo.VerifySignatures(batch); }));
+    }
+    std::unordered_map<std::string, bool> signedHeads;
+    for (size_t i{0}; i < batches.size(); i++) {
+        const auto signatures = batches[i].get();
+        for (size_t j{0}; j < signatures.size(); j++) {
+            signedHeads[heads[i * SIGNATURE_BATCH_SIZE + j]] = !signatures[j].empty();
+        }
+    }
+    repo.SaveSignatureCache();
+    const Seconds signatureDuration = std::chrono::steady_clock::now() - phaseStart;
+
+    // scan phase, the heads are verified again from the cache
+    RepoStatisticsCollector collector(pool);
+    collector.Start(repo, nullptr);
+    collector.Wait();
+    const std::optional<RepoStatistics> statistics = collector.GetResult();
+    if (!statistics.has_value()) {
+        log << "can't scan repository " << repo.GetRepoPath() << "\n";
+        return false;
+    }
+
+    std::ostringstream out;
+    MetricWriter metrics(out, repo.GetRepoPath());
+    metrics.Family("ostree_repo_refs", "Refs of the repository.");
+    metrics.Sample(statistics->refCount);
+    metrics.Family("ostree_repo_commits", "Commits reachable from the loaded refs.");
+    metrics.Sample(repo.GetCommitList().size());
+    metrics.Family("ostree_repo_commit_objects", "Commit objects on disk.");
+    metrics.Sample(statistics->commitCount);
+    metrics.Family("ostree_repo_orphaned_commits", "Commit objects, that no ref reaches.");
+    metrics.Sample(statistics->orphanedCommits.size());
+    metrics.Family("ostree_repo_unsigned_heads", "Ref heads without a signature.");
+    metrics.Sample(statistics->unsignedHeads);
+
+    // per ref
+    const auto now = Clock::now();
+    metrics.Family("ostree_repo_ref_head_age_seconds", "Age of the head commit of a ref.");
+    for (const auto& ref : repo.GetBranches()) {
+        auto head = repo.GetBranchHeads().find(ref);
+        if (head == repo.GetBranchHeads().end() || !repo.GetCommitList().contains(head->second)) {
+            continue;
+        }
+        const auto age = std::chrono::duration_cast<std::chrono::seconds>(
+            now - repo.GetCommitList().at(head->second).timestamp);
+        metrics.Sample(age.count(), "ref", ref);
+    }
+    metrics.Family("ostree_repo_ref_head_signed", "1 if the head commit of a ref is signed.");
+    for (const auto& ref : repo.GetBranches()) {
+        auto head = repo.GetBranchHeads().find(ref);
+        if (head != repo.GetBranchHeads().end() && signedHeads.contains(head->second)) {
+            metrics.Sample(signedHeads.at(head->second) ? 1 : 0, "ref", ref);
+        }
+    }
+
+    // objects
+    metrics.Family("ostree_repo_objects", "Loose objects by type.");
+    for (const auto& [type, objects] : statistics->objectTypes) {
+        metrics.Sample(objects.count, "type", type);
+    }
+    metrics.Family("ostree_repo_object_bytes", "Bytes of the loose objects by type.");
+    for (const auto& [type, objects] : statistics->objectTypes) {
+        metrics.Sample(objects.bytes, "type", type);
+    }
+    metrics.Family("ostree_repo_loose_object_bytes", "Bytes of the objects directory.");
+    metrics.Sample(statistics->looseObjectBytes);
+    metrics.Family("ostree_repo_size_bytes", "Bytes of the complete repository directory.");
+    metrics.Sample(statistics->totalBytes);
+
+    // phases
+    out << std::fixed << std::setprecision(6);
+    metrics.Family("ostree_repo_export_phase_seconds", "Duration of a phase of this export.");
+    metrics.Sample(loadDuration.count(), "phase", "load");
+    metrics.Sample(signatureDuration.count(), "phase", "signatures");
+    metrics.Sample(Seconds(statistics->scanDuration).count(), "phase", "scan");
+
+    // written to a temporary file & renamed
+    const std::string text = out.str();
+    GError* error{nullptr};
+    if (!g_file_set_contents(path.c_str(), text.c_str(), static_cast<gssize>(text.size()),
+                             &error)) {
+        log << "can't write " << path << ": " << error->message << "\n";
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,31 @@
+/*_____________________________________________________________
+ | Metrics Export
+ |   Non-interactive export of repository gauges in the text
+ |   format of Prometheus, for the textfile collector of the
+ |   node exporter (e.g. written by a cron job every minute).
+ |   The repository is loaded & scanned with the same engines
+ |   as the TUI, verified signatures are cached across runs.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <ostream>
+#include <string>
+
+#include "cpplibostree.hpp"
+
+namespace cpplibostree {
+
+/**
+ * @brief Load a repository, verify the signatures of all ref heads, scan its objects (see
+ * RepoStatisticsCollector) and write the resulting gauges to a file. The file is replaced
+ * atomically, the collector never reads a partially written one.
+ *
+ * @param repo Repository to export (does not need to be loaded, the load options apply).
+ * @param path Path of the metrics file (should end with .prom).
+ * @param log Stream for error messages.
+ * @return true on success
+ */
+bool ExportMetrics(OSTreeRepo& repo, const std::string& path, std::ostream& log);
+
+}  // namespace cpplibostree
@@ -0,0 +1,380 @@
+#include "reachability.hpp"
+
+// C++
+#include <algorithm>
+#include <bit>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cpplibostree {
+
+namespace {
+constexpr size_t WORD_BITS{64};
+}  // namespace
+
+// CommitBitset
+
+CommitBitset::CommitBitset(size_t size) : words((size + WORD_BITS - 1) / WORD_BITS, 0) {}
+
+void CommitBitset::Resize(size_t size) {
+    words.resize((size + WORD_BITS - 1) / WORD_BITS, 0);
+}
+
+void CommitBitset::Set(size_t id) {
+    words.at(id / WORD_BITS) |= uint64_t{1} << (id % WORD_BITS);
+}
+
+bool CommitBitset::Test(size_t id) const {
+    if (id / WORD_BITS >= words.size()) {
+        return false;
+    }
+    return (words[id / WORD_BITS] >> (id % WORD_BITS)) & 1U;
+}
+
+void CommitBitset::Unite(const CommitBitset& other) {
+    words.resize(std::max(words.size(), other.words.size()), 0);
+    for (size_t i{0}; i < other.words.size(); i++) {
+        words[i] |= other.words[i];
+    }
+}
+
+void CommitBitset::Subtract(const CommitBitset& other) {
+    for (size_t i{0}; i < std::min(words.size(), other.words.size()); i++) {
+        words[i] &= ~other.words[i];
+    }
+}
+
+size_t CommitBitset::Count() const {
+    size_t count{0};
+    for (const auto word : words) {
+        count += static_cast<size_t>(std::popcount(word));
+    }
+    return count;
+}
+
+std::vector<size_t> CommitBitset::GetIds() const {
+    std::vector<size_t> ids;
+    for (size_t i{0}; i < words.size(); i++) {
+        uint64_t word = words[i];
+        while (word != 0) {
+            ids.push_back(i * WORD_BITS + static_cast<size_t>(std::countr_zero(word)));
+            word &= word - 1;
+        }
+    }
+    return ids;
+}
+
+// ReachabilityIndex
+
+void ReachabilityIndex::Build(const CommitList& commitList,
+                              const std::unordered_map<std::string, std::string>& refHeads) {
+    idToHash.clear();
+    hashToId.clear();
+    parentIds.clear();
+    missingParents.clear();
+    segments.clear();
+    localGenerations.clear();
+    segmentParents.clear();
+    segmentOffsets.clear();
+    segmentSizes.clear();
+    jumpIds.clear();
+    refHeadIds.clear();
+    refReachable.clear();
+
+    std::vector<std::string> hashes;
+    hashes.reserve(commitList.size());
+    for (const auto& [hash, commit] : commitList) {
+        hashes.emplace_back(hash);
+    }
+    Append(commitList, std::move(hashes), refHeads);
+}
+
+void ReachabilityIndex::Append(const CommitList& commitList,
+                               std::vector<std::string> hashes,
+                               const std::unordered_map<std::string, std::string>& refHeads) {
+    // dense ids, newest first
+    std::sort(hashes.begin(), hashes.end(), [&](const std::string& a, const std::string& b) {
+        return commitList.at(a).timestamp > commitList.at(b).timestamp;
+    });
+    const size_t firstId = idToHash.size();
+    for (auto& hash : hashes) {
+        if (!hashToId.contains(hash)) {
+            const size_t id = idToHash.size();
+            hashToId[idToHash.emplace_back(std::move(hash))] = id;
+        }
+    }
+    const std::vector<size_t> attached = linkCommits(commitList, firstId);
+
+    // known refs reach the history attached below their commits, new heads are walked
+    for (auto& [ref, reachable] : refReachable) {
+        reachable.Resize(idToHash.size());
+        for (const size_t id : attached) {
+            if (!reachable.Test(id)) {
+                continue;
+            }
+            for (auto current = parentIds[id]; current.has_value() && !reachable.Test(*current);
+                 current = parentIds[*current]) {
+                reachable.Set(*current);
+            }
+        }
+    }
+    for (const auto& [ref, head] : refHeads) {
+        auto headId = GetId(head);
+        if (refHeadIds.contains(ref) || !headId.has_value()) {
+            continue;
+        }
+        refHeadIds[ref] = headId.value();
+        refReachable[ref] = GetAncestors(headId.value());
+    }
+
+    othersReachableCache.clear();
+    empty = CommitBitset(idToHash.size());
+}
+
+std::optional<size_t> ReachabilityIndex::GetId(std::string_view hash) const {
+    auto it = hashToId.find(hash);
+    if (it == hashToId.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+const std::string& ReachabilityIndex::GetHash(size_t id) const {
+    return idToHash.at(id);
+}
+
+const CommitBitset& ReachabilityIndex::GetReachable(const std::string& ref) const {
+    auto it = refReachable.find(ref);
+    return it == refReachable.end() ? empty : it->second;
+}
+
+size_t ReachabilityIndex::GetGeneration(size_t id) const {
+    return static_cast<size_t>(generation(id));
+}
+
+bool ReachabilityIndex::IsAncestor(size_t ancestor, size_t descendant) const {
+    if (ancestor == descendant) {
+        return true;
+    }
+    const auto [ancestorSet, ancestorOffset] = findSegment(segments.at(ancestor));
+    const auto [descendantSet, descendantOffset] = findSegment(segments.at(descendant));
+    const int64_t target = localGenerations[ancestor] + ancestorOffset;
+    int64_t currentGeneration = localGenerations[descendant] + descendantOffset;
+    if (ancestorSet != descendantSet || target >= currentGeneration) {
+        return false;
+    }
+    // climb to the generation of the ancestor, every commit above the oldest one has a parent
+    size_t current = descendant;
+    while (currentGeneration > target) {
+        const size_t jump = jumpIds[current];
+        const int64_t jumpGeneration = generation(jump);
+        if (jump != current && jumpGeneration >= target) {
+            current = jump;
+            currentGeneration = jumpGeneration;
+        } else {
+            current = parentIds[current].value();
+            currentGeneration--;
+        }
+    }
+    return current == ancestor;
+}
+
+std::optional<size_t> ReachabilityIndex::GetMergeBase(size_t a, size_t b) const {
+    if (findSegment(segments.at(a)).first != findSegment(segments.at(b)).first) {
+        return std::nullopt;
+    }
+    // climb from a, until its ancestor is one of b (being an ancestor of b holds for all older
+    // commits from there on, so whole jumps can be skipped, if their target is no ancestor)
+    size_t current = a;
+    while (!IsAncestor(current, b)) {
+        const std::optional<size_t> parent = parentIds.at(current);
+        if (!parent.has_value()) {
+            return std::nullopt;
+        }
+        const size_t jump = jumpIds[current];
+        current = jump != current && !IsAncestor(jump, b) ? jump : parent.value();
+    }
+    return current;
+}
+
+std::vector<std::string> ReachabilityIndex::GetContainingRefs(size_t id) const {
+    std::vector<std::string> refs;
+    for (const auto& [ref, headId] : refHeadIds) {
+        if (IsAncestor(id, headId)) {
+            refs.push_back(ref);
+        }
+    }
+    std::sort(refs.begin(), refs.end());
+    return refs;
+}
+
+std::optional<size_t> ReachabilityIndex::GetRefHeadId(const std::string& ref) const {
+    auto head = refHeadIds.find(ref);
+    if (head == refHeadIds.end()) {
+        return std::nullopt;
+    }
+    return head->second;
+}
+
+CommitBitset ReachabilityIndex::GetAncestors(size_t id) const {
+    CommitBitset ancestors(idToHash.size());
+    std::optional<size_t> current = id;
+    while (current.has_value() && !ancestors.Test(current.value())) {
+        ancestors.Set(current.value());
+        current = parentIds.at(current.value());
+    }
+    return ancestors;
+}
+
+std::vector<std::string> ReachabilityIndex::PreviewDrop(const std::string& hash,
+                                                        const std::string& branch) const {
+    auto id = GetId(hash);
+    if (!id.has_value()) {
+        return {hash};
+    }
+
+    CommitBitset lost;
+    auto head = refHeadIds.find(branch);
+    if (head != refHeadIds.end() && head->second == id.value()) {
+        // branch gets reset to the parent
+        lost = CommitBitset(idToHash.size());
+        lost.Set(id.value());
+    } else {
+        // history of the branch ends before the dropped commit
+        lost = GetAncestors(id.value());
+    }
+    lost.Subtract(getReachableFromOthers(branch));
+
+    // the dropped commit itself is always removed, the others follow its history (appended
+    // history has no "newest first" ids)
+    std::vector<size_t> lostIds = lost.GetIds();
+    std::sort(lostIds.begin(), lostIds.end(),
+              [this](size_t a, size_t b) { return generation(a) > generation(b); });
+    std::vector<std::string> hashes{hash};
+    for (const auto lostId : lostIds) {
+        if (lostId != id.value()) {
+            hashes.push_back(idToHash.at(lostId));
+        }
+    }
+    return hashes;
+}
+
+std::vector<size_t> ReachabilityIndex::linkCommits(const CommitList& commitList,
+                                                   size_t firstId) {
+    const size_t count = idToHash.size();
+    parentIds.resize(count);
+    segments.resize(count);
+    localGenerations.resize(count);
+    jumpIds.resize(count);
+
+    // parent links of the new commits & of older commits, whose parent is one of them
+    for (size_t id{firstId}; id < count; id++) {
+        const std::string_view parent = commitList.at(idToHash[id]).parent;
+        parentIds[id] = GetId(parent);
+        if (!parentIds[id].has_value()) {
+            missingParents[std::string(parent)].push_back(id);
+        }
+    }
+    std::vector<size_t> attached;
+    for (size_t id{firstId}; id < count; id++) {
+        auto waiting = missingParents.find(idToHash[id]);
+        if (waiting == missingParents.end()) {
+            continue;
+        }
+        for (const size_t child : waiting->second) {
+            parentIds[child] = id;
+            attached.push_back(child);
+        }
+        missingParents.erase(waiting);
+    }
+
+    // generations & jump pointers of the new commits, parents before their children
+    std::vector<bool> placed(count - firstId, false);
+    std::vector<size_t> chain;
+    for (size_t id{firstId}; id < count; id++) {
+        for (std::optional<size_t> current = id; current.has_value() &&
+                                                 current.value() >= firstId &&
+                                                 !placed[current.value() - firstId];
+             current = parentIds[current.value()]) {
+            placed[current.value() - firstId] = true;
+            chain.push_back(current.value());
+        }
+        for (auto commit = chain.rbegin(); commit != chain.rend(); commit++) {
+            const std::optional<size_t> parent = parentIds[*commit];
+            if (!parent.has_value()) {
+                // oldest loaded commit of a history: a new segment
+                segments[*commit] = segmentParents.size();
+                segmentParents.push_back(segmentParents.size());
+                segmentOffsets.push_back(0);
+                segmentSizes.push_back(1);
+                localGenerations[*commit] = 1;
+                jumpIds[*commit] = *commit;
+                continue;
+            }
+            segments[*commit] = segments[parent.value()];
+            localGenerations[*commit] = localGenerations[parent.value()] + 1;
+            segmentSizes[findSegment(segments[*commit]).first]++;
+            // jump twice as far, if the last two jumps had the same length
+            const size_t parentJump = jumpIds[parent.value()];
+            jumpIds[*commit] = generation(parent.value()) - generation(parentJump) ==
+                                       generation(parentJump) - generation(jumpIds[parentJump])
+                                   ? jumpIds[parentJump]
+                                   : parent.value();
+        }
+        chain.clear();
+    }
+
+    // older commits, that were the oldest loaded one of their history so far: their set of
+    // segments moves below the new parent (the smaller set is linked to the larger one)
+    for (const size_t root : attached) {
+        const size_t parent = parentIds[root].value();
+        const size_t rootSet = findSegment(segments[root]).first;
+        const size_t parentSet = findSegment(segments[parent]).first;
+        if (rootSet == parentSet) {
+            continue;
+        }
+        const int64_t shift = generation(parent) + 1 - generation(root);
+        if (segmentSizes[rootSet] <= segmentSizes[parentSet]) {
+            segmentParents[rootSet] = parentSet;
+            segmentOffsets[rootSet] += shift - segmentOffsets[parentSet];
+            segmentSizes[parentSet] += segmentSizes[rootSet];
+        } else {
+            segmentOffsets[rootSet] += shift;
+            segmentParents[parentSet] = rootSet;
+            segmentOffsets[parentSet] -= segmentOffsets[rootSet];
+            segmentSizes[rootSet] += segmentSizes[parentSet];
+        }
+        jumpIds[root] = parent;
+    }
+    return attached;
+}
+
+std::pair<size_t, int64_t> ReachabilityIndex::findSegment(size_t segment) const {
+    int64_t offset{segmentOffsets[segment]};
+    while (segmentParents[segment] != segment) {
+        segment = segmentParents[segment];
+        offset += segmentOffsets[segment];
+    }
+    return {segment, offset};
+}
+
+int64_t ReachabilityIndex::generation(size_t id) const {
+    return localGenerations[id] + findSegment(segments[id]).second;
+}
+
+const CommitBitset& ReachabilityIndex::getReachableFromOthers(const std::string& ref) const {
+    auto cached = othersReachableCache.find(ref);
+    if (cached != othersReachableCache.end()) {
+        return cached->second;
+    }
+    CommitBitset others(idToHash.size());
+    for (const auto& [otherRef, reachable] : refReachable) {
+        if (otherRef != ref) {
+            others.Unite(reachable);
+        }
+    }
+    return othersReachableCache.emplace(ref, std::move(others)).first->second;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,182 @@
+/*_____________________________________________________________
+ | Reachability Index
+ |   Maps every loaded commit to a dense id & stores, which
+ |   commits are reachable from which ref as one bitset per ref.
+ |   Used to preview exactly which commits become unreachable,
+ |   when a commit gets dropped.
+ |   Ancestry queries (is-ancestor, merge-base) use generation
+ |   numbers & jump pointers over the parent links instead of
+ |   walking the history. Older history, that is loaded later,
+ |   is appended without rebuilding the index.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cpplibostree.hpp"
+
+namespace cpplibostree {
+
+/// Fixed size bitset over dense commit ids.
+class CommitBitset {
+   public:
+    CommitBitset() = default;
+    explicit CommitBitset(size_t size);
+
+    /// @brief Grow to a new size, the added ids are not set.
+    void Resize(size_t size);
+    void Set(size_t id);
+    [[nodiscard]] bool Test(size_t id) const;
+    /// @brief this |= other
+    void Unite(const CommitBitset& other);
+    /// @brief this &= ~other
+    void Subtract(const CommitBitset& other);
+    [[nodiscard]] size_t Count() const;
+    /// @brief All set ids in ascending order.
+    [[nodiscard]] std::vector<size_t> GetIds() const;
+
+   private:
+    std::vector<uint64_t> words;
+};
+
+class ReachabilityIndex {
+   public:
+    ReachabilityIndex() = default;
+
+    /**
+     * @brief (Re-)Build the index. Dense ids are assigned in order of descending
+     * commit timestamps, so id order equals "newest first".
+     *
+     * @param commitList All loaded commits.
+     * @param refHeads Map ref -> hash of its head commit.
+     */
+    void Build(const CommitList& commitList,
+               const std::unordered_map<std::string, std::string>& refHeads);
+
+    /**
+     * @brief Add commits (e.g. a page of older history) without rebuilding the index. They
+     * get the next dense ids (newest first among themselves), so the id order is only
+     * "newest first" after Build(). The refs must not have moved since the last Build().
+     *
+     * @param commitList All loaded commits, including the new ones.
+     * @param hashes Hashes of the new commits.
+     * @param refHeads Map ref -> hash of its head commit.
+     */
+    void Append(const CommitList& commitList,
+                std::vector<std::string> hashes,
+                const std::unordered_map<std::string, std::string>& refHeads);
+
+    /// Getter: dense id of a commit hash
+    [[nodiscard]] std::optional<size_t> GetId(std::string_view hash) const;
+    /// Getter: commit hash of a dense id
+    [[nodiscard]] const std::string& GetHash(size_t id) const;
+    /// Getter: commits reachable from a ref (empty, if the ref is unknown)
+    [[nodiscard]] const CommitBitset& GetReachable(const std::string& ref) const;
+
+    /// Getter: generation number of a commit (1 for the oldest loaded commit of a history)
+    [[nodiscard]] size_t GetGeneration(size_t id) const;
+
+    /**
+     * @brief Check if a commit is part of the (loaded) history of another one in O(log n).
+     * Every commit is its own ancestor.
+     *
+     * @param ancestor Dense id of the possible ancestor.
+     * @param descendant Dense id of the possible descendant.
+     * @return true if `ancestor` is reachable from `descendant`
+     */
+    [[nodiscard]] bool IsAncestor(size_t ancestor, size_t descendant) const;
+
+    /**
+     * @brief Find the newest common ancestor of two commits (where their histories diverged)
+     * in O(log n).
+     *
+     * @param a Dense id of the first commit.
+     * @param b Dense id of the second commit.
+     * @return Dense id of the merge-base, or nothing if the loaded histories are unrelated
+     */
+    [[nodiscard]] std::optional<size_t> GetMergeBase(size_t a, size_t b) const;
+
+    /**
+     * @brief Get all refs, that contain a commit (the head of the ref is a descendant).
+     *
+     * @param id Dense id of the commit.
+     * @return Sorted ref names
+     */
+    [[nodiscard]] std::vector<std::string> GetContainingRefs(size_t id) const;
+
+    /// Getter: dense id of the head commit of a ref, if loaded
+    [[nodiscard]] std::optional<size_t> GetRefHeadId(const std::string& ref) const;
+
+    /**
+     * @brief Get a commit and all its (loaded) ancestors.
+     *
+     * @param id Dense id of the commit.
+     * @return Bitset of the commit & its ancestors
+     */
+    [[nodiscard]] CommitBitset GetAncestors(size_t id) const;
+
+    /**
+     * @brief Calculate which commits are not reachable anymore, after the commit got dropped
+     * from its branch (see `OSTreeRepo::RemoveCommitFromBranchAndPrune()`).
+     *
+     * - head of branch: the branch is reset to the parent, only the commit itself is lost
+     * - otherwise: the commit and all its predecessors are lost
+     *
+     * Commits, that are still reachable from other refs, are not included.
+     *
+     * @param hash Commit to drop.
+     * @param branch Branch to drop the commit from.
+     * @return Hashes of all commits, that become unreachable (newest first). The dropped commit
+     * itself is always included.
+     */
+    [[nodiscard]] std::vector<std::string> PreviewDrop(const std::string& hash,
+                                                       const std::string& branch) const;
+
+   private:
+    /**
+     * @brief Link the commits from `firstId` on to their parents & calculate their generations
+     * & jump pointers (parents first).
+     *
+     * @return Ids of older commits, whose parent is one of the new commits
+     */
+    std::vector<size_t> linkCommits(const CommitList& commitList, size_t firstId);
+
+    /// @brief Union-find root of a segment & the offset of its generations.
+    [[nodiscard]] std::pair<size_t, int64_t> findSegment(size_t segment) const;
+
+    /// @brief Generation of a commit (local generation + offset of its segment).
+    [[nodiscard]] int64_t generation(size_t id) const;
+
+    /// @brief Union of the reachable sets of all refs except `ref` (cached per ref).
+    [[nodiscard]] const CommitBitset& getReachableFromOthers(const std::string& ref) const;
+
+    std::deque<std::string> idToHash;  // deque: appending keeps the keys of hashToId valid
+    std::unordered_map<std::string_view, size_t> hashToId;  // keys point into idToHash
+    std::vector<std::optional<size_t>> parentIds;
+    // parent hash -> commits, whose parent is not loaded (yet)
+    std::unordered_map<std::string, std::vector<size_t>> missingParents;
+    // ancestry: generations are stored relative to segments (commits placed below the same
+    // oldest commit), so that history attached below them shifts whole segments at once
+    // (weighted union-find, a set is one connected history)
+    std::vector<size_t> segments;           // segment of every commit
+    std::vector<int64_t> localGenerations;  // generation within the segment
+    std::vector<size_t> segmentParents;     // union-find parent (roots: itself)
+    std::vector<int64_t> segmentOffsets;    // offset relative to the union-find parent
+    std::vector<size_t> segmentSizes;       // commits of a set (union-find roots only)
+    std::vector<size_t> jumpIds;  // skew-binary jump pointers to an ancestor (roots: itself)
+    std::unordered_map<std::string, size_t> refHeadIds;
+    std::unordered_map<std::string, CommitBitset> refReachable;
+    mutable std::unordered_map<std::string, CommitBitset> othersReachableCache;
+    CommitBitset empty;
+};
+
+}  // namespace cpplibostree
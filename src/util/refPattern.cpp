@@ -0,0 +1,100 @@
+#include "refPattern.hpp"
+
+// C++
+#include <string>
+#include <utility>
+
+namespace cpplibostree {
+
+namespace {
+
+/**
+ * @brief Translate a glob into an equivalent ECMAScript regex.
+ *
+ * @param glob Glob, like `stable-?.*`.
+ * @return Regex, like `stable-[^/]\.[^/]*`
+ */
+std::string globToRegex(std::string_view glob) {
+    std::string regex;
+    for (size_t i{0}; i < glob.size(); i++) {
+        const char c = glob[i];
+        if (c == '*' && i + 1 < glob.size() && glob[i + 1] == '*') {
+            regex += ".*";
+            i++;
+        } else if (c == '*') {
+            regex += "[^/]*";
+        } else if (c == '?') {
+            regex += "[^/]";
+        } else if (c == '[') {
+            // character class, copied as is (`[!...]` is the negation of globs)
+            const size_t end = glob.find(']', i + 1);
+            if (end == std::string_view::npos) {
+                regex += "\\[";
+                continue;
+            }
+            std::string_view characters = glob.substr(i + 1, end - i - 1);
+            regex += "[";
+            if (characters.starts_with('!')) {
+                regex += "^";
+                characters.remove_prefix(1);
+            }
+            for (const char member : characters) {
+                regex += member == '\\' ? "\\\\" : std::string(1, member);
+            }
+            regex += "]";
+            i = end;
+        } else if (std::string_view("\\^$.|+(){}").find(c) != std::string_view::npos) {
+            regex += '\\';
+            regex += c;
+        } else {
+            regex += c;
+        }
+    }
+    return regex;
+}
+
+}  // namespace
+
+RefPattern::RefPattern(std::string pattern, RefPatternSyntax syntax, std::regex regex)
+    : pattern(std::move(pattern)), syntax(syntax), regex(std::move(regex)) {}
+
+std::optional<RefPattern> RefPattern::Compile(const std::string& pattern,
+                                              RefPatternSyntax syntax) {
+    if (syntax == RefPatternSyntax::SUBSTRING) {
+        return RefPattern(pattern, syntax, std::regex());
+    }
+    try {
+        std::regex regex(syntax == RefPatternSyntax::GLOB ? globToRegex(pattern) : pattern,
+                         std::regex::ECMAScript | std::regex::optimize);
+        return RefPattern(pattern, syntax, std::move(regex));
+    } catch (const std::regex_error&) {
+        return std::nullopt;
+    }
+}
+
+RefPatternSyntax RefPattern::GuessSyntax(std::string_view pattern) {
+    return pattern.find_first_of("*?[") == std::string_view::npos ? RefPatternSyntax::SUBSTRING
+                                                                   : RefPatternSyntax::GLOB;
+}
+
+bool RefPattern::Matches(std::string_view ref) const {
+    if (syntax == RefPatternSyntax::SUBSTRING) {
+        return ref.find(pattern) != std::string_view::npos;
+    }
+    return std::regex_match(ref.begin(), ref.end(), regex);
+}
+
+bool RefPattern::Narrows(const RefPattern& other) const {
+    return syntax == RefPatternSyntax::SUBSTRING && other.syntax == RefPatternSyntax::SUBSTRING &&
+           pattern.find(other.pattern) != std::string::npos;
+}
+
+const std::string& RefPattern::GetPattern() const {
+    return pattern;
+}
+
+RefPatternSyntax RefPattern::GetSyntax() const {
+    return syntax;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,75 @@
+/*_____________________________________________________________
+ | Ref Pattern
+ |   Glob, regex, or substring pattern for ref names. Patterns
+ |   are compiled once & then matched against many refs (e.g.
+ |   the ref filter search, or the `--refs` option).
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstdint>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+
+namespace cpplibostree {
+
+enum class RefPatternSyntax : uint8_t {
+    SUBSTRING,  // ref contains the pattern
+    GLOB,       // `*` & `?` within one path segment, `**` across segments, `[...]`
+    REGEX,      // ECMAScript regular expression
+};
+
+class RefPattern {
+   public:
+    /**
+     * @brief Compile a pattern. Globs & regexes have to match the complete ref name.
+     *
+     * @param pattern Pattern to compile.
+     * @param syntax Syntax of the pattern.
+     * @return Compiled pattern, or nothing if the pattern is invalid
+     */
+    [[nodiscard]] static std::optional<RefPattern> Compile(const std::string& pattern,
+                                                           RefPatternSyntax syntax);
+
+    /**
+     * @brief Guess the syntax of a pattern typed by the user: Patterns with glob characters
+     * (`*`, `?`, `[`) are globs, everything else is a substring.
+     *
+     * @param pattern Pattern to check.
+     * @return GLOB, or SUBSTRING
+     */
+    [[nodiscard]] static RefPatternSyntax GuessSyntax(std::string_view pattern);
+
+    /**
+     * @brief Check, if a ref matches the pattern.
+     *
+     * @param ref Ref name, like `os/x86_64/stable`.
+     * @return true on match
+     */
+    [[nodiscard]] bool Matches(std::string_view ref) const;
+
+    /**
+     * @brief Check, if every ref matching `other` also matches this pattern, because this
+     * pattern is a substring of it. Used to narrow down previous results while typing.
+     *
+     * @param other Previously matched pattern.
+     * @return true if it is safe to only match the previous results
+     */
+    [[nodiscard]] bool Narrows(const RefPattern& other) const;
+
+    /// Getter
+    [[nodiscard]] const std::string& GetPattern() const;
+    /// Getter
+    [[nodiscard]] RefPatternSyntax GetSyntax() const;
+
+   private:
+    RefPattern(std::string pattern, RefPatternSyntax syntax, std::regex regex);
+
+    std::string pattern;
+    RefPatternSyntax syntax{RefPatternSyntax::SUBSTRING};
+    std::regex regex;  // compiled glob, or regex (unused for substrings)
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,182 @@
+#include "refSnapshot.hpp"
+
+// C++
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+// C
+#include <dirent.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+namespace cpplibostree {
+
+namespace {
+
+/// size of a binary SHA256 checksum
+constexpr size_t CHECKSUM_BYTES{32};
+
+bool isNewer(const timespec& a, const timespec& b) {
+    return a.tv_sec != b.tv_sec ? a.tv_sec > b.tv_sec : a.tv_nsec > b.tv_nsec;
+}
+
+/**
+ * @brief Scan a directory tree of ref files. Refs are always replaced by renaming a new file
+ * into place, so every added, changed, or deleted ref updates the modification time of its
+ * directory and the ref files themselves don't need to be checked.
+ *
+ * @param parentDfd Directory containing the tree.
+ * @param name Name of the tree.
+ * @param newest Set to the newest modification time of all directories, if newer.
+ * @param hasRefs Set to true, if the tree contains any ref.
+ * @return false, if the tree could not be read (a missing tree is empty)
+ */
+bool scanRefDirectory(int parentDfd, const char* name, timespec& newest, bool& hasRefs) {
+    const int dfd = openat(parentDfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0) {
+        return errno == ENOENT;
+    }
+    struct stat directoryStat {};
+    if (fstat(dfd, &directoryStat) != 0) {
+        close(dfd);
+        return false;
+    }
+    if (isNewer(directoryStat.st_mtim, newest)) {
+        newest = directoryStat.st_mtim;
+    }
+    DIR* directory = fdopendir(dfd);  // takes over dfd
+    if (directory == nullptr) {
+        close(dfd);
+        return false;
+    }
+    bool success{true};
+    for (dirent* entry = readdir(directory); success && entry != nullptr;
+         entry = readdir(directory)) {
+        const std::string_view entryName(entry->d_name);
+        if (entryName == "." || entryName == "..") {
+            continue;
+        }
+        bool isDirectory = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat entryStat {};
+            success = fstatat(dirfd(directory), entry->d_name, &entryStat, 0) == 0;
+            isDirectory = success && S_ISDIR(entryStat.st_mode);
+        }
+        if (isDirectory) {
+            success = scanRefDirectory(dirfd(directory), entry->d_name, newest, hasRefs);
+        } else {
+            hasRefs = true;
+        }
+    }
+    closedir(directory);
+    return success;
+}
+
+/// @brief Check if the summary lists exactly the current refs.
+bool isSummaryCurrent(int repoDfd) {
+    struct stat summaryStat {};
+    if (fstatat(repoDfd, "summary", &summaryStat, 0) != 0) {
+        return false;
+    }
+    // remote & mirrored refs are not part of the summary
+    timespec newest{};
+    bool hasRefs{false};
+    if (!scanRefDirectory(repoDfd, "refs/remotes", newest, hasRefs) ||
+        !scanRefDirectory(repoDfd, "refs/mirrors", newest, hasRefs) || hasRefs) {
+        return false;
+    }
+    newest = {};
+    if (!scanRefDirectory(repoDfd, "refs/heads", newest, hasRefs)) {
+        return false;
+    }
+    return isNewer(summaryStat.st_mtim, newest);
+}
+
+/// @brief Read the refs from the memory-mapped summary file.
+std::optional<RefSnapshot> readSummary(int repoDfd) {
+    const int fd = openat(repoDfd, "summary", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    GMappedFile* file = g_mapped_file_new_from_fd(fd, FALSE, nullptr);
+    close(fd);
+    if (file == nullptr) {
+        return std::nullopt;
+    }
+    GBytes* bytes = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+    // the summary is not content addressed -> not trusted
+    g_autoptr(GVariant) summary =
+        g_variant_ref_sink(g_variant_new_from_bytes(OSTREE_SUMMARY_GVARIANT_FORMAT, bytes, FALSE));
+    g_bytes_unref(bytes);
+
+    // a(s(taya{sv})): ref name, (size, checksum, metadata)
+    RefSnapshot snapshot;
+    snapshot.fromSummary = true;
+    g_autoptr(GVariant) refs = g_variant_get_child_value(summary, 0);
+    const gsize refCount = g_variant_n_children(refs);
+    snapshot.refs.reserve(refCount);
+    for (gsize i{0}; i < refCount; i++) {
+        g_autoptr(GVariant) ref = g_variant_get_child_value(refs, i);
+        g_autoptr(GVariant) data = g_variant_get_child_value(ref, 1);
+        g_autoptr(GVariant) checksumBytes = g_variant_get_child_value(data, 1);
+        const gchar* name{nullptr};
+        g_variant_get_child(ref, 0, "&s", &name);
+        gsize length{0};
+        const auto* checksum =
+            static_cast<const guchar*>(g_variant_get_fixed_array(checksumBytes, &length, 1));
+        if (length != CHECKSUM_BYTES) {
+            return std::nullopt;
+        }
+        g_autofree char* hash = ostree_checksum_from_bytes(checksum);
+        snapshot.refs.emplace_back(name, hash);
+    }
+    return snapshot;
+}
+
+/// @brief Read the refs by resolving every ref file.
+std::optional<RefSnapshot> readRefFiles(OstreeRepo* repo) {
+    GError* error{nullptr};
+    GHashTable* refs{nullptr};
+    if (!ostree_repo_list_refs_ext(repo, nullptr, &refs, OSTREE_REPO_LIST_REFS_EXT_NONE, nullptr,
+                                   &error)) {
+        g_printerr("Error listing refs: %s\n", error->message);
+        g_error_free(error);
+        return std::nullopt;
+    }
+    RefSnapshot snapshot;
+    snapshot.refs.reserve(g_hash_table_size(refs));
+    GHashTableIter iter;
+    gpointer key{nullptr};
+    gpointer value{nullptr};
+    g_hash_table_iter_init(&iter, refs);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        snapshot.refs.emplace_back(static_cast<const char*>(key),
+                                   static_cast<const char*>(value));
+    }
+    g_hash_table_unref(refs);
+    std::sort(snapshot.refs.begin(), snapshot.refs.end());
+    return snapshot;
+}
+
+}  // namespace
+
+std::optional<RefSnapshot> ReadRefSnapshot(OstreeRepo* repo) {
+    const int repoDfd = ostree_repo_get_dfd(repo);
+    if (isSummaryCurrent(repoDfd)) {
+        if (auto snapshot = readSummary(repoDfd); snapshot.has_value()) {
+            return snapshot;
+        }
+    }
+    return readRefFiles(repo);
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,34 @@
+/*_____________________________________________________________
+ | Ref Snapshot
+ |   All refs of a repository with their head commits, read in
+ |   one step. If the summary file is current (newer than all
+ |   local refs & there are no remote refs), the refs are read
+ |   from the memory-mapped summary, instead of resolving every
+ |   ref file on its own.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+// external
+#include <ostree.h>
+
+namespace cpplibostree {
+
+struct RefSnapshot {
+    std::vector<std::pair<std::string, std::string>> refs;  // ref -> head commit, sorted by ref
+    bool fromSummary{false};                                // read from the summary file
+};
+
+/**
+ * @brief Read all refs & their head commits.
+ *
+ * @param repo Opened repository.
+ * @return Snapshot, or nothing if the refs can't be listed
+ */
+[[nodiscard]] std::optional<RefSnapshot> ReadRefSnapshot(OstreeRepo* repo);
+
+}  // namespace cpplibostree
@@ -0,0 +1,101 @@
+#include "refTree.hpp"
+
+// C++
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cpplibostree {
+
+void RefTree::Build(std::vector<std::string> newRefs) {
+    refs = std::move(newRefs);
+    std::sort(refs.begin(), refs.end());
+    nodes.clear();
+
+    // refs sharing a prefix are neighbors after sorting, so every directory is opened once &
+    // closed as soon as a ref outside of it shows up
+    const bool expanded = refs.size() <= REF_TREE_EXPANDED_REFS;
+    std::vector<size_t> openDirectories;  // node indices, outermost first
+    std::vector<std::string_view> openSegments;
+    auto closeDirectory = [&](size_t refIndex) {
+        RefTreeNode& directory = nodes.at(openDirectories.back());
+        directory.refEnd = refIndex;
+        directory.subtreeEnd = nodes.size();
+        openDirectories.pop_back();
+        openSegments.pop_back();
+    };
+    for (size_t i{0}; i < refs.size(); i++) {
+        // split into path segments
+        std::vector<std::string_view> segments;
+        std::string_view rest(refs[i]);
+        for (size_t slash = rest.find('/'); slash != std::string_view::npos;
+             slash = rest.find('/')) {
+            segments.push_back(rest.substr(0, slash));
+            rest.remove_prefix(slash + 1);
+        }
+        // close directories, that do not contain this ref
+        size_t common{0};
+        while (common < openSegments.size() && common < segments.size() &&
+               openSegments[common] == segments[common]) {
+            common++;
+        }
+        while (openSegments.size() > common) {
+            closeDirectory(i);
+        }
+        // open the missing ones
+        for (size_t depth{common}; depth < segments.size(); depth++) {
+            openDirectories.push_back(nodes.size());
+            openSegments.push_back(segments[depth]);
+            nodes.push_back({.label = std::string(segments[depth]),
+                             .depth = depth,
+                             .isRef = false,
+                             .expanded = expanded,
+                             .refBegin = i});
+        }
+        nodes.push_back({.label = std::string(rest),
+                         .depth = segments.size(),
+                         .isRef = true,
+                         .refBegin = i,
+                         .refEnd = i + 1,
+                         .subtreeEnd = nodes.size() + 1});
+    }
+    while (!openDirectories.empty()) {
+        closeDirectory(refs.size());
+    }
+    updateRows();
+}
+
+bool RefTree::SetExpanded(size_t node, bool expanded) {
+    RefTreeNode& directory = nodes.at(node);
+    if (directory.isRef || directory.expanded == expanded) {
+        return false;
+    }
+    directory.expanded = expanded;
+    updateRows();
+    return true;
+}
+
+const std::vector<std::string>& RefTree::GetRefs() const {
+    return refs;
+}
+
+const RefTreeNode& RefTree::GetNode(size_t node) const {
+    return nodes.at(node);
+}
+
+const std::vector<size_t>& RefTree::GetRows() const {
+    return rows;
+}
+
+void RefTree::updateRows() {
+    rows.clear();
+    for (size_t node{0}; node < nodes.size();) {
+        rows.push_back(node);
+        // skip the content of collapsed directories
+        node = nodes[node].isRef || nodes[node].expanded ? node + 1 : nodes[node].subtreeEnd;
+    }
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,67 @@
+/*_____________________________________________________________
+ | Ref Tree
+ |   Refs grouped by their path segments (os/x86_64/stable),
+ |   as a tree with collapsible directories. Every directory
+ |   covers a continuous range of the sorted refs, so a whole
+ |   subtree can be addressed at once.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cpplibostree {
+
+struct RefTreeNode {
+    std::string label;     // last path segment
+    size_t depth{0};       // amount of parent directories
+    bool isRef{false};     // ref, or directory
+    bool expanded{false};  // directories only
+    size_t refBegin{0};    // refs of the node: [refBegin, refEnd) of RefTree::GetRefs()
+    size_t refEnd{0};
+    size_t subtreeEnd{0};  // first node after the subtree of this node
+};
+
+class RefTree {
+   public:
+    RefTree() = default;
+
+    /**
+     * @brief (Re-)Build the tree. All directories start collapsed, unless there are only a few
+     * refs.
+     *
+     * @param refs Ref names, in any order.
+     */
+    void Build(std::vector<std::string> refs);
+
+    /**
+     * @brief Expand, or collapse a directory.
+     *
+     * @param node Index of the directory node.
+     * @param expanded New state.
+     * @return true, if the state changed
+     */
+    bool SetExpanded(size_t node, bool expanded);
+
+    /// Getter: sorted ref names
+    [[nodiscard]] const std::vector<std::string>& GetRefs() const;
+    /// Getter: node by index
+    [[nodiscard]] const RefTreeNode& GetNode(size_t node) const;
+    /// Getter: indices of the nodes, that are not hidden by a collapsed directory (in order)
+    [[nodiscard]] const std::vector<size_t>& GetRows() const;
+
+   private:
+    /// @brief Recalculate the visible rows.
+    void updateRows();
+
+    std::vector<std::string> refs;
+    std::vector<RefTreeNode> nodes;  // pre-order, directories before their content
+    std::vector<size_t> rows;
+};
+
+/// refs, up to which all directories are initially expanded
+constexpr size_t REF_TREE_EXPANDED_REFS{32};
+
+}  // namespace cpplibostree
@@ -0,0 +1,466 @@
+#include "repoDaemon.hpp"
+#include "json.hpp"
+#include "repoStatistics.hpp"
+#include "signatureVerifier.hpp"
+#include "unixSocket.hpp"
+
+// C++
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+// C
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+// external
+#include <glib.h>
+
+namespace cpplibostree {
+
+namespace {
+
+/// set by SIGINT & SIGTERM, checked by the serve loop of RepoDaemon::Run()
+volatile std::sig_atomic_t stopRequested{0};
+
+void requestStop(int /*signal*/) {
+    stopRequested = 1;
+}
+
+/// maximum length of a request line, longer ones disconnect the client
+constexpr size_t MAX_REQUEST_SIZE{64 * 1024};
+
+void appendRefs(std::string& out, const OSTreeRepo& repo) {
+    for (const auto& branch : repo.GetBranches()) {
+        auto head = repo.GetBranchHeads().find(branch);
+        out += "{\"type\":\"ref\",\"name\":" + json::Quote(branch) + ",\"head\":" +
+               json::Quote(head != repo.GetBranchHeads().end() ? head->second : "") + "}\n";
+    }
+}
+
+void appendCommit(std::string& out, const Commit& commit) {
+    const int64_t timestamp =
+        std::chrono::duration_cast<std::chrono::seconds>(commit.timestamp.time_since_epoch())
+            .count();
+    out += "{\"type\":\"commit\",\"hash\":" + json::Quote(commit.hash) +
+           ",\"branch\":" + json::Quote(commit.branch) +
+           ",\"parent\":" + json::Quote(commit.parent) +
+           ",\"subject\":" + json::Quote(commit.subject) +
+           ",\"version\":" + json::Quote(commit.version) +
+           ",\"timestamp\":" + std::to_string(timestamp) + "}\n";
+}
+
+}  // namespace
+
+std::string GetDaemonSocketPath(const std::string& repoPath) {
+    std::error_code ec;
+    std::string canonical = std::filesystem::weakly_canonical(repoPath, ec).string();
+    if (ec) {
+        canonical = repoPath;
+    }
+    g_autofree gchar* pathHash = g_compute_checksum_for_data(
+        G_CHECKSUM_SHA256, reinterpret_cast<const guchar*>(canonical.data()), canonical.size());
+    return (std::filesystem::path(g_get_user_runtime_dir()) / "ostree-tui" /
+            ("daemon-" + std::string(pathHash, 16) + ".sock"))
+        .string();
+}
+
+// RepoDaemon
+
+RepoDaemon::RepoDaemon(const std::string& repoPath)
+    : repo(repoPath, false), socketPath(GetDaemonSocketPath(repoPath)) {}
+
+RepoDaemon::~RepoDaemon() {
+    for (const auto& client : clients) {
+        ::close(client.fd);
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+    }
+}
+
+bool RepoDaemon::Run(std::ostream& log) {
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    // changes during the load are picked up by the first check
+    changeStamp = RepoStatisticsCollector::GetRepoChangeStamp(repo.GetRepoPath());
+    const auto loadStart = std::chrono::steady_clock::now();
+    repo.UpdateData();
+    log << "loaded " << repo.GetCommitList().size() << " commits of " << repo.GetBranches().size()
+        << " refs in " << Milliseconds(std::chrono::steady_clock::now() - loadStart).count()
+        << " ms\n";
+    std::vector<std::string> hashes;
+    hashes.reserve(repo.GetCommitList().size());
+    for (const auto& [hash, commit] : repo.GetCommitList()) {
+        hashes.emplace_back(hash);
+    }
+    warmSignatures(hashes);
+
+    if (!listen(log)) {
+        return false;
+    }
+    log << "serving " << repo.GetRepoPath() << " on " << socketPath << "\n";
+
+    stopRequested = 0;
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    auto lastCheck = std::chrono::steady_clock::now();
+    while (stopRequested == 0) {
+        std::vector<pollfd> fds;
+        fds.push_back({listenFd, POLLIN, 0});
+        for (const auto& client : clients) {
+            fds.push_back(
+                {client.fd, static_cast<short>(client.output.empty() ? POLLIN : POLLIN | POLLOUT),
+                 0});
+        }
+        if (::poll(fds.data(), fds.size(), static_cast<int>(DAEMON_POLL_INTERVAL.count())) < 0 &&
+            errno != EINTR) {
+            log << "error waiting for clients: " << std::strerror(errno) << "\n";
+            break;
+        }
+
+        // clients first, accepting appends to the list
+        for (size_t i{0}; i + 1 < fds.size(); i++) {
+            Client& client = clients[i];
+            const short events = fds[i + 1].revents;
+            bool connected{true};
+            if ((events & (POLLIN | POLLHUP | POLLERR)) != 0) {
+                connected = readRequests(client);
+            }
+            if (connected && (events & POLLOUT) != 0) {
+                connected = flush(client);
+            }
+            if (!connected) {
+                ::close(client.fd);
+                client.fd = -1;
+            }
+        }
+        std::erase_if(clients, [](const Client& client) { return client.fd < 0; });
+        if ((fds.front().revents & POLLIN) != 0) {
+            acceptClient(log);
+        }
+
+        // reload, if the repository changed on disk (or a client asked for it)
+        const auto now = std::chrono::steady_clock::now();
+        if (!refreshRequested && now - lastCheck < DAEMON_POLL_INTERVAL) {
+            continue;
+        }
+        lastCheck = now;
+        const uint64_t stamp = RepoStatisticsCollector::GetRepoChangeStamp(repo.GetRepoPath());
+        if (refreshRequested || stamp != changeStamp) {
+            changeStamp = stamp;
+            refreshRequested = false;
+            reload(log);
+        }
+    }
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    log << "stopped\n";
+    return true;
+}
+
+bool RepoDaemon::listen(std::ostream& log) {
+    std::string error;
+    listenFd = ListenUnixSocket(socketPath, error);
+    if (listenFd < 0) {
+        log << "can't listen on " << socketPath << ": " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+void RepoDaemon::acceptClient(std::ostream& log) {
+    const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    Client client;
+    client.fd = fd;
+    client.output = "{\"type\":\"hello\",\"version\":" + std::to_string(DAEMON_PROTOCOL_VERSION) +
+                    "}\n" + snapshot();
+    client.outputLimit = client.output.size() + DAEMON_MAX_QUEUED_BYTES;
+    clients.push_back(std::move(client));
+    log << "client attached (" << clients.size() << " attached)\n";
+}
+
+bool RepoDaemon::readRequests(Client& client) {
+    char chunk[4096];
+    while (true) {
+        const ssize_t received = ::recv(client.fd, chunk, sizeof(chunk), 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        client.input.append(chunk, static_cast<size_t>(received));
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        return false;
+    }
+
+    size_t lineEnd{0};
+    while ((lineEnd = client.input.find('\n')) != std::string::npos) {
+        auto request = json::Parse(std::string_view(client.input).substr(0, lineEnd));
+        if (request.has_value() && request->GetString("method") == "refresh") {
+            refreshRequested = true;
+        }
+        client.input.erase(0, lineEnd + 1);
+    }
+    return client.input.size() <= MAX_REQUEST_SIZE;
+}
+
+bool RepoDaemon::flush(Client& client) {
+    while (client.outputSent < client.output.size()) {
+        const ssize_t sent = ::send(client.fd, client.output.data() + client.outputSent,
+                                    client.output.size() - client.outputSent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.outputSent += static_cast<size_t>(sent);
+    }
+    // everything sent, a snapshot is not kept around
+    client.output.clear();
+    client.output.shrink_to_fit();
+    client.outputSent = 0;
+    client.outputLimit = DAEMON_MAX_QUEUED_BYTES;
+    return true;
+}
+
+void RepoDaemon::reload(std::ostream& log) {
+    // moved refs: only their new commits are read from disk
+    std::vector<std::string> removedCommits;
+    std::optional<RepoData> data = repo.LoadRepoDelta(removedCommits);
+    if (!data.has_value()) {
+        return;
+    }
+    const bool refsChanged =
+        data->branches != repo.GetBranches() || data->branchHeads != repo.GetBranchHeads();
+    const CommitList& loaded = repo.GetCommitList();
+    if (!refsChanged) {
+        // same refs, but objects were added or removed (e.g. pruned history): a complete load
+        // is compared with the loaded commits
+        data = repo.LoadRepoData(repo.GetLoadSettings());
+        if (!data.has_value()) {
+            return;
+        }
+        removedCommits.clear();
+        for (const auto& [hash, commit] : loaded) {
+            if (!data->commits.contains(hash)) {
+                removedCommits.emplace_back(hash);
+            }
+        }
+        std::erase_if(data->commits, [&loaded](const auto& entry) {
+            auto previous = loaded.find(entry.first);
+            return previous != loaded.end() && previous->second.branch == entry.second.branch;
+        });
+    }
+
+    // only the changes are sent: added commits, commits reached through another branch now &
+    // removed commits
+    std::string changes;
+    std::vector<std::string> added;
+    for (const auto& [hash, commit] : data->commits) {
+        if (!loaded.contains(hash)) {
+            added.emplace_back(hash);
+        }
+        appendCommit(changes, commit);
+    }
+    for (const auto& hash : removedCommits) {
+        changes += "{\"type\":\"removed\",\"hash\":" + json::Quote(hash) + "}\n";
+    }
+    const size_t moved = data->commits.size() - added.size();
+    repo.ApplyRepoDelta(std::move(data.value()), removedCommits);
+
+    // commits of other keyrings (changed meanwhile) are verified again
+    std::vector<std::string> unverified = repo.GetStaleSignatureCommits();
+    unverified.insert(unverified.end(), added.begin(), added.end());
+    warmSignatures(unverified);
+
+    if (changes.empty() && !refsChanged) {
+        return;
+    }
+    std::string update = "{\"type\":\"begin\",\"snapshot\":false}\n";
+    appendRefs(update, repo);
+    update += changes + "{\"type\":\"end\"}\n";
+    // clients, that don't keep up, are dropped (they load the repository themselves then)
+    size_t dropped{0};
+    for (auto& client : clients) {
+        if (client.output.size() - client.outputSent + update.size() > client.outputLimit) {
+            ::close(client.fd);
+            client.fd = -1;
+            dropped++;
+            continue;
+        }
+        client.output += update;
+    }
+    std::erase_if(clients, [](const Client& client) { return client.fd < 0; });
+    if (dropped > 0) {
+        log << "dropped " << dropped << " clients, that did not read their updates\n";
+    }
+    log << "reloaded: " << added.size() << " added, " << moved << " moved, "
+        << removedCommits.size() << " removed commits, sent to " << clients.size()
+        << " clients\n";
+}
+
+std::string RepoDaemon::snapshot() const {
+    std::string out = "{\"type\":\"begin\",\"snapshot\":true}\n";
+    appendRefs(out, repo);
+    for (const auto& [hash, commit] : repo.GetCommitList()) {
+        appendCommit(out, commit);
+    }
+    return out + "{\"type\":\"end\"}\n";
+}
+
+void RepoDaemon::warmSignatures(const std::vector<std::string>& hashes) {
+    if (hashes.empty()) {
+        return;
+    }
+    auto remaining = std::make_shared<std::atomic<size_t>>(
+        (hashes.size() + SIGNATURE_BATCH_SIZE - 1) / SIGNATURE_BATCH_SIZE);
+    for (size_t begin{0}; begin < hashes.size(); begin += SIGNATURE_BATCH_SIZE) {
+        const size_t end = std::min(begin + SIGNATURE_BATCH_SIZE, hashes.size());
+        std::vector<std::string> batch(hashes.begin() + static_cast<std::ptrdiff_t>(begin),
+                                       hashes.begin() + static_cast<std::ptrdiff_t>(end));
+        signaturePool.Submit(
+            [this, batch = std::move(batch), remaining] {
+                repo.VerifySignatures(batch);
+                if (--*remaining == 0) {
+                    repo.SaveSignatureCache();
+                }
+            },
+            TaskPriority::LOW);
+    }
+}
+
+// DaemonClient
+
+DaemonClient::DaemonClient(int fd) : fd(fd) {}
+
+DaemonClient::~DaemonClient() {
+    ::close(fd);
+}
+
+std::unique_ptr<DaemonClient> DaemonClient::Connect(const std::string& repoPath) {
+    const int fd = ConnectUnixSocket(GetDaemonSocketPath(repoPath));
+    if (fd < 0) {
+        return nullptr;
+    }
+    std::unique_ptr<DaemonClient> client(new DaemonClient(fd));
+
+    // a daemon, that does not greet right away, is treated as gone
+    timeval timeout{};
+    timeout.tv_sec = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string line;
+    if (!client->readLine(line)) {
+        return nullptr;
+    }
+    auto hello = json::Parse(line);
+    if (!hello.has_value() || hello->GetString("type") != "hello" ||
+        hello->GetNumber("version") != DAEMON_PROTOCOL_VERSION) {
+        return nullptr;
+    }
+    timeout = {};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return client;
+}
+
+std::optional<RepoUpdate> DaemonClient::ReadUpdate() {
+    RepoUpdate update;
+    bool begun{false};
+    // every branch name is stored once
+    std::unordered_map<std::string, std::string_view> branchNames;
+    std::string line;
+    while (readLine(line)) {
+        auto record = json::Parse(line);
+        if (!record.has_value()) {
+            return std::nullopt;
+        }
+        const std::string type = record->GetString("type");
+        if (type == "begin") {
+            const json::Value* snapshot = record->Find("snapshot");
+            update.snapshot = snapshot != nullptr && snapshot->boolean;
+            begun = true;
+        } else if (type == "ref") {
+            std::string name = record->GetString("name");
+            update.data.branchHeads[name] = record->GetString("head");
+            update.data.branches.push_back(std::move(name));
+        } else if (type == "commit") {
+            StringArena& arena = *update.data.arena;
+            const std::string branch = record->GetString("branch");
+            auto branchName = branchNames.find(branch);
+            if (branchName == branchNames.end()) {
+                branchName = branchNames.emplace(branch, arena.Store(branch)).first;
+            }
+            Commit commit;
+            commit.hash = arena.Store(record->GetString("hash"));
+            commit.subject = arena.Store(record->GetString("subject"));
+            commit.version = arena.Store(record->GetString("version"));
+            commit.timestamp = Timepoint(
+                std::chrono::seconds(static_cast<int64_t>(record->GetNumber("timestamp"))));
+            commit.parent = arena.Store(record->GetString("parent"));
+            commit.branch = branchName->second;
+            update.data.commits.insert({commit.hash, commit});
+        } else if (type == "removed") {
+            update.removedCommits.push_back(record->GetString("hash"));
+        } else if (type == "end" && begun) {
+            return update;
+        }
+    }
+    return std::nullopt;
+}
+
+bool DaemonClient::RequestRefresh() {
+    constexpr std::string_view REQUEST{"{\"method\":\"refresh\"}\n"};
+    return ::send(fd, REQUEST.data(), REQUEST.size(), MSG_NOSIGNAL) ==
+           static_cast<ssize_t>(REQUEST.size());
+}
+
+void DaemonClient::Close() {
+    ::shutdown(fd, SHUT_RDWR);
+}
+
+bool DaemonClient::readLine(std::string& line) {
+    size_t lineEnd{0};
+    while ((lineEnd = buffer.find('\n', bufferPos)) == std::string::npos) {
+        // consumed data is dropped before reading more, not after every line
+        buffer.erase(0, bufferPos);
+        bufferPos = 0;
+        char chunk[64 * 1024];
+        const ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+    }
+    line.assign(buffer, bufferPos, lineEnd - bufferPos);
+    bufferPos = lineEnd + 1;
+    return true;
+}
+
+}  // namespace cpplibostree
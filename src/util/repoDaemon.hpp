@@ -0,0 +1,173 @@
+/*_____________________________________________________________
+ | Repository Daemon
+ |   Keeps a repository loaded in a long running process (its
+ |   commits, indexes & verified signatures) and serves it to
+ |   the TUIs of the same user over a Unix socket, so that they
+ |   attach in milliseconds instead of walking the history.
+ |   Whenever the refs change on disk, the daemon only reads the
+ |   new commits (up to the loaded history) and only sends the
+ |   changes to all clients.
+ |
+ |   Protocol: NDJSON, one record per line. The daemon greets
+ |   every client with {"type":"hello","version":N}, followed
+ |   by updates, the first one being a complete snapshot:
+ |     {"type":"begin","snapshot":true|false}
+ |     {"type":"ref","name":"..","head":".."}   (all refs)
+ |     {"type":"commit","hash":"..","branch":"..",...}
+ |     {"type":"removed","hash":".."}
+ |     {"type":"end"}
+ |   Clients may ask for an immediate reload (e.g. after they
+ |   wrote to the repository) with {"method":"refresh"}.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cpplibostree.hpp"
+#include "threadPool.hpp"
+
+namespace cpplibostree {
+
+/// version of the socket protocol, clients of other versions load the repository themselves
+constexpr uint32_t DAEMON_PROTOCOL_VERSION{1};
+/// interval, in which the daemon checks the repository for changes
+constexpr std::chrono::milliseconds DAEMON_POLL_INTERVAL{1000};
+/// unsent updates queued for a client (besides its snapshot), more drop the client
+constexpr size_t DAEMON_MAX_QUEUED_BYTES{16 * 1024 * 1024};
+
+/**
+ * @brief Path of the socket of the daemon serving a repository: one socket per (canonical)
+ * repository path, in the user's runtime directory.
+ *
+ * @param repoPath Path to the OSTree repository.
+ * @return Path of the Unix socket
+ */
+[[nodiscard]] std::string GetDaemonSocketPath(const std::string& repoPath);
+
+/// Update received from the daemon, see DaemonClient::ReadUpdate()
+struct RepoUpdate {
+    bool snapshot{false};  // complete state (OSTreeRepo::ApplyRepoData()), or only the changes
+    RepoData data;         // all refs, the complete, or the added (or moved) commits
+    std::vector<std::string> removedCommits;
+};
+
+class RepoDaemon {
+   public:
+    /**
+     * @brief Construct a new RepoDaemon, the repository is loaded by Run().
+     *
+     * @param repoPath Path to the OSTree repository (always loaded completely).
+     */
+    explicit RepoDaemon(const std::string& repoPath);
+
+    /// @brief Disconnects all clients & removes the socket.
+    ~RepoDaemon();
+
+    RepoDaemon(const RepoDaemon&) = delete;
+    RepoDaemon& operator=(const RepoDaemon&) = delete;
+
+    /**
+     * @brief Load the repository, listen on GetDaemonSocketPath() & serve clients until SIGINT,
+     * or SIGTERM. The signatures of all commits are verified (and cached on disk) in the
+     * background meanwhile.
+     *
+     * @param log Stream for status messages.
+     * @return false if the socket could not be created (e.g. another daemon serves the
+     * repository already)
+     */
+    bool Run(std::ostream& log);
+
+   private:
+    struct Client {
+        int fd{-1};
+        std::string input;      // received, not yet complete request line
+        std::string output;     // queued records
+        size_t outputSent{0};   // bytes of `output` sent already
+        size_t outputLimit{0};  // unsent bytes, that drop the client (snapshot & queued updates)
+    };
+
+    /// @brief Create the socket, replaces the one of a crashed daemon.
+    bool listen(std::ostream& log);
+
+    /// @brief Accept a new client & queue the greeting & a snapshot for it.
+    void acceptClient(std::ostream& log);
+
+    /// @brief Read & handle all pending requests of a client, false if it disconnected.
+    bool readRequests(Client& client);
+
+    /// @brief Send as much of the queued records as possible, false if the client is gone.
+    static bool flush(Client& client);
+
+    /// @brief Load the changes of the repository & send them to all clients (if any). Without
+    /// moved refs (e.g. pruned objects), the repository is loaded completely.
+    void reload(std::ostream& log);
+
+    /// @brief Complete state as a single update (see the protocol above).
+    [[nodiscard]] std::string snapshot() const;
+
+    /// @brief Verify & cache signatures in batches on the pool, the cache is written once all
+    /// batches are done.
+    void warmSignatures(const std::vector<std::string>& hashes);
+
+    OSTreeRepo repo;
+    std::string socketPath;
+    int listenFd{-1};
+    std::vector<Client> clients;
+    uint64_t changeStamp{0};       // see RepoStatisticsCollector::GetRepoChangeStamp()
+    bool refreshRequested{false};  // a client asked for a reload
+    ThreadPool signaturePool;      // declared last: joined before the repository is destroyed
+};
+
+class DaemonClient {
+   public:
+    /**
+     * @brief Connect to the daemon of a repository & check its protocol version.
+     *
+     * @param repoPath Path to the OSTree repository.
+     * @return Connected client, or nullptr if no (compatible) daemon serves the repository
+     */
+    [[nodiscard]] static std::unique_ptr<DaemonClient> Connect(const std::string& repoPath);
+
+    ~DaemonClient();
+
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    /**
+     * @brief Block until the next update arrived. The first one is a snapshot.
+     *
+     * @return Update, or nothing if the daemon is gone (or Close() was called)
+     */
+    [[nodiscard]] std::optional<RepoUpdate> ReadUpdate();
+
+    /**
+     * @brief Ask the daemon to check the repository for changes right away. Thread safe, may
+     * be called while another thread waits in ReadUpdate().
+     *
+     * @return false if the daemon is gone
+     */
+    bool RequestRefresh();
+
+    /// @brief Disconnect, a pending ReadUpdate() returns nothing. Thread safe.
+    void Close();
+
+   private:
+    explicit DaemonClient(int fd);
+
+    /// @brief Read the next line (blocking), false on disconnect.
+    bool readLine(std::string& line);
+
+    int fd;
+    std::string buffer;    // received data
+    size_t bufferPos{0};  // start of the data, that is not consumed yet
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,368 @@
+#include "repoStatistics.hpp"
+
+// C++
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+// C
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cstdio>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+#include "commitReader.hpp"
+#include "signatureVerifier.hpp"
+
+namespace cpplibostree {
+
+namespace {
+/// minimum time between two on-disk change checks
+constexpr std::chrono::seconds STAMP_CHECK_INTERVAL{2};
+
+std::string shardName(size_t shard) {
+    constexpr std::string_view HEX_DIGITS{"0123456789abcdef"};
+    return {HEX_DIGITS.at(shard / 16), HEX_DIGITS.at(shard % 16)};
+}
+
+uint64_t hashCombine(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6U) + (seed >> 2U));
+}
+
+uint64_t mtimeOf(const struct stat& st) {
+    return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL +
+           static_cast<uint64_t>(st.st_mtim.tv_nsec);
+}
+}  // namespace
+
+RepoStatisticsCollector::RepoStatisticsCollector(ThreadPool& pool)
+    : pool(pool), state(std::make_shared<SharedState>()) {}
+
+bool RepoStatisticsCollector::Start(const OSTreeRepo& repo, std::function<void()> onProgress) {
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->running) {
+            return false;
+        }
+        // only look at the disk every few seconds
+        auto now = std::chrono::steady_clock::now();
+        if (state->result.has_value() && !state->resultStale &&
+            now - state->lastStampCheck < STAMP_CHECK_INTERVAL) {
+            return false;
+        }
+        state->lastStampCheck = now;
+    }
+
+    uint64_t stamp = GetRepoChangeStamp(repo.GetRepoPath());
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->result.has_value() && !state->resultStale && state->resultStamp == stamp) {
+        return false;
+    }
+
+    // take over ref & commit information, while still on the calling thread
+    RepoStatistics partial;
+    partial.refCount = repo.GetBranches().size() + repo.GetSkippedBranches().size();
+    std::unordered_set<std::string> reachable;
+    reachable.reserve(repo.GetCommitList().size());
+    for (const auto& [hash, commit] : repo.GetCommitList()) {
+        // loaded orphans are listed, not reached
+        if (commit.branch != ORPHANED_BRANCH) {
+            reachable.emplace(hash);
+        }
+    }
+    std::vector<std::string> frontiers;
+    for (const auto& [branch, frontier] : repo.GetHistoryFrontiers()) {
+        frontiers.push_back(frontier);
+    }
+    // refs, that are not loaded at all, are resolved on the worker thread
+    frontiers.insert(frontiers.end(), repo.GetSkippedBranches().begin(),
+                     repo.GetSkippedBranches().end());
+    // signatures are verified on the worker threads (see verifyHeads())
+    std::vector<std::string> heads;
+    for (const auto& [branch, head] : repo.GetBranchHeads()) {
+        if (repo.GetCommitList().contains(head)) {
+            heads.push_back(head);
+        }
+    }
+
+    // all shards, everything outside `objects/` & the batches of heads
+    const size_t headBatches = (heads.size() + SIGNATURE_BATCH_SIZE - 1) / SIGNATURE_BATCH_SIZE;
+    state->running = true;
+    state->shardsDone = 0;
+    state->taskCount = OBJECT_SHARD_COUNT + 1 + headBatches;
+    state->partial = std::move(partial);
+    state->reachableCommits = std::move(reachable);
+    state->historyFrontiers = std::move(frontiers);
+    state->commitObjects.clear();
+    state->scanStart = std::chrono::steady_clock::now();
+    state->scanStamp = stamp;
+    state->onProgress = std::move(onProgress);
+
+    // shard the scan over the prefix directories
+    for (size_t shard{0}; shard < OBJECT_SHARD_COUNT; shard++) {
+        pool.Submit([sharedState = state, repoPath = repo.GetRepoPath(), shard] {
+            scanShard(sharedState, repoPath, shard);
+        });
+    }
+    pool.Submit([sharedState = state, &repo] { scanNonObjects(sharedState, repo); });
+    for (size_t begin{0}; begin < heads.size(); begin += SIGNATURE_BATCH_SIZE) {
+        const size_t end = std::min(begin + SIGNATURE_BATCH_SIZE, heads.size());
+        pool.Submit([sharedState = state, &repo,
+                     batch = std::vector<std::string>(heads.begin() + begin,
+                                                      heads.begin() + end)] {
+            verifyHeads(sharedState, repo, batch);
+        });
+    }
+    return true;
+}
+
+void RepoStatisticsCollector::Invalidate() {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->resultStale = true;
+}
+
+bool RepoStatisticsCollector::IsRunning() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->running;
+}
+
+std::pair<size_t, size_t> RepoStatisticsCollector::GetProgress() const {
+    return {state->shardsDone.load(), state->taskCount.load()};
+}
+
+std::optional<RepoStatistics> RepoStatisticsCollector::GetResult() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->result;
+}
+
+void RepoStatisticsCollector::Wait() const {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [this] { return !state->running; });
+}
+
+uint64_t RepoStatisticsCollector::GetRepoChangeStamp(const std::string& repoPath) {
+    uint64_t stamp{0};
+    struct stat st{};
+
+    // every new or pruned object touches its prefix directory
+    const std::string objectsPath = repoPath + "/objects/";
+    for (size_t shard{0}; shard < OBJECT_SHARD_COUNT; shard++) {
+        if (::stat((objectsPath + shardName(shard)).c_str(), &st) == 0) {
+            stamp = hashCombine(stamp, mtimeOf(st));
+        }
+    }
+
+    // refs
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(repoPath + "/refs", ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (::lstat(it->path().c_str(), &st) == 0) {
+            stamp = hashCombine(stamp, std::hash<std::string>{}(it->path().string()));
+            stamp = hashCombine(stamp, mtimeOf(st));
+        }
+    }
+
+    return stamp;
+}
+
+void RepoStatisticsCollector::scanShard(const std::shared_ptr<SharedState>& state,
+                                        const std::string& repoPath,
+                                        size_t shard) {
+    const std::string prefix = shardName(shard);
+    const std::string shardPath = repoPath + "/objects/" + prefix;
+
+    RepoStatistics local;
+    std::vector<std::string> commits;
+
+    DIR* dir = opendir(shardPath.c_str());
+    if (dir != nullptr) {
+        const int dirFd = dirfd(dir);
+        struct stat st{};
+        while (const struct dirent* entry = readdir(dir)) {
+            const std::string_view name{entry->d_name};
+            const size_t dot = name.rfind('.');
+            if (name.starts_with('.') || dot == std::string_view::npos) {
+                continue;
+            }
+            if (fstatat(dirFd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            const auto size = static_cast<uint64_t>(st.st_size);
+            auto& typeStats = local.objectTypes[std::string(name.substr(dot + 1))];
+            typeStats.count++;
+            typeStats.bytes += size;
+            local.looseObjectBytes += size;
+            if (name.substr(dot + 1) == "commit") {
+                commits.push_back(prefix + std::string(name.substr(0, dot)));
+            }
+        }
+        closedir(dir);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (const auto& [type, typeStats] : local.objectTypes) {
+            state->partial.objectTypes[type].count += typeStats.count;
+            state->partial.objectTypes[type].bytes += typeStats.bytes;
+        }
+        state->partial.looseObjectBytes += local.looseObjectBytes;
+        state->partial.totalBytes += local.looseObjectBytes;
+        state->partial.commitCount += commits.size();
+        state->commitObjects.insert(state->commitObjects.end(), commits.begin(), commits.end());
+    }
+    finishShard(state, repoPath);
+}
+
+void RepoStatisticsCollector::scanNonObjects(const std::shared_ptr<SharedState>& state,
+                                             const OSTreeRepo& repo) {
+    const std::string& repoPath = repo.GetRepoPath();
+    uint64_t bytes{0};
+    const std::filesystem::path objectsPath = std::filesystem::path(repoPath) / "objects";
+
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator it(repoPath, ec);
+    for (std::filesystem::recursive_directory_iterator end; !ec && it != end; it.increment(ec)) {
+        if (it->path() == objectsPath) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        std::error_code sizeError;
+        if (it->is_regular_file(sizeError) && !it->is_symlink(sizeError)) {
+            uintmax_t size = it->file_size(sizeError);
+            bytes += sizeError ? 0 : static_cast<uint64_t>(size);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->partial.totalBytes += bytes;
+    }
+    finishShard(state, repoPath);
+}
+
+void RepoStatisticsCollector::verifyHeads(const std::shared_ptr<SharedState>& state,
+                                          const OSTreeRepo& repo,
+                                          const std::vector<std::string>& heads) {
+    // cached signatures don't need the commit details at all
+    const auto signatures = repo.VerifySignatures(heads);
+    const auto unsignedHeads = static_cast<size_t>(std::count_if(
+        signatures.begin(), signatures.end(), [](const auto& sigs) { return sigs.empty(); }));
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->partial.unsignedHeads += unsignedHeads;
+    }
+    finishShard(state, repo.GetRepoPath());
+}
+
+void RepoStatisticsCollector::finishShard(const std::shared_ptr<SharedState>& state,
+                                          const std::string& repoPath) {
+    std::function<void()> onProgress;
+    bool lastShard{false};
+    std::unordered_set<std::string> reachableCommits;
+    std::vector<std::string> historyFrontiers;
+    std::vector<std::string> commitObjects;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        // the scan keeps running until the result is published
+        lastShard = ++state->shardsDone == state->taskCount;
+        if (lastShard) {
+            reachableCommits = std::move(state->reachableCommits);
+            historyFrontiers = std::move(state->historyFrontiers);
+            commitObjects = std::move(state->commitObjects);
+        }
+        onProgress = state->onProgress;
+    }
+
+    // the unloaded history is walked on disk, without blocking the UI on the mutex
+    if (lastShard) {
+        std::vector<std::string> orphans =
+            findOrphanedCommits(reachableCommits, historyFrontiers, commitObjects, repoPath);
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->partial.orphanedCommits = std::move(orphans);
+        state->partial.scanDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - state->scanStart);
+        state->result = std::move(state->partial);
+        state->resultStamp = state->scanStamp;
+        state->resultStale = false;
+        state->partial = {};
+        state->reachableCommits.clear();
+        state->historyFrontiers.clear();
+        state->commitObjects.clear();
+        state->running = false;
+        state->finished.notify_all();
+    }
+    if (onProgress) {
+        onProgress();
+    }
+}
+
+std::vector<std::string> RepoStatisticsCollector::findOrphanedCommits(
+    std::unordered_set<std::string>& reachableCommits,
+    const std::vector<std::string>& historyFrontiers,
+    const std::vector<std::string>& commitObjects,
+    const std::string& repoPath) {
+    // history, that is not loaded, is still reachable -> follow the parents from disk
+    if (!historyFrontiers.empty()) {
+        GError* error{nullptr};
+        OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+        if (repo == nullptr) {
+            g_printerr("Error opening repository: %s\n", error->message);
+            g_error_free(error);
+            return {};
+        }
+        const CommitReader reader(repo);
+        for (const auto& frontier : historyFrontiers) {
+            // commit hash, or name of a skipped ref
+            g_autofree char* current = nullptr;
+            if (!ostree_repo_resolve_rev(repo, frontier.c_str(), TRUE, &current, nullptr)) {
+                continue;
+            }
+            while (current != nullptr && reachableCommits.insert(current).second) {
+                g_autoptr(GVariant) variant = nullptr;
+                if (!reader.Load(current, &variant, nullptr)) {
+                    break;
+                }
+                char* parent = ostree_commit_get_parent(variant);
+                g_free(current);
+                current = parent;
+            }
+        }
+        g_object_unref(repo);
+    }
+
+    std::vector<std::string> orphans;
+    for (const auto& hash : commitObjects) {
+        if (!reachableCommits.contains(hash)) {
+            orphans.push_back(hash);
+        }
+    }
+    std::sort(orphans.begin(), orphans.end());
+    return orphans;
+}
+
+std::string FormatByteSize(uint64_t bytes) {
+    constexpr std::array<std::string_view, 5> UNITS{"B", "KiB", "MiB", "GiB", "TiB"};
+    auto value = static_cast<double>(bytes);
+    size_t unit{0};
+    while (value >= 1024.0 && unit < UNITS.size() - 1) {
+        value /= 1024.0;
+        unit++;
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << value << " " << UNITS.at(unit);
+    return out.str();
+}
+
+}  // namespace cpplibostree
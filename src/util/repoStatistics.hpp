@@ -0,0 +1,149 @@
+/*_____________________________________________________________
+ | Repository Statistics
+ |   Object counts & sizes, gathered by a parallel scan of the
+ |   `objects/` directory (sharded by its two-character prefix
+ |   directories), plus ref & commit related counters.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "cpplibostree.hpp"
+#include "threadPool.hpp"
+
+namespace cpplibostree {
+
+/// number of `objects/xx` prefix directories
+constexpr size_t OBJECT_SHARD_COUNT{256};
+
+struct ObjectTypeStatistics {
+    size_t count{0};
+    uint64_t bytes{0};
+};
+
+struct RepoStatistics {
+    std::map<std::string, ObjectTypeStatistics> objectTypes;  // object file extension -> stats
+    uint64_t totalBytes{0};                                   // complete repository directory
+    uint64_t looseObjectBytes{0};                             // `objects/` directory only
+    size_t refCount{0};
+    size_t commitCount{0};  // commit objects on disk
+    size_t unsignedHeads{0};
+    std::vector<std::string> orphanedCommits;  // commit objects not reachable from any ref, sorted
+    std::chrono::milliseconds scanDuration{0};
+};
+
+/**
+ * @brief Computes RepoStatistics in the background on a ThreadPool and caches
+ * the last result, until the repository changes on disk.
+ */
+class RepoStatisticsCollector {
+   public:
+    explicit RepoStatisticsCollector(ThreadPool& pool);
+
+    /**
+     * @brief Start a background scan, unless one is already running, or the cached
+     * result still matches the repository on disk.
+     *
+     * @param repo Repository to scan. Ref & commit info is copied before returning.
+     * @param onProgress Called from a worker thread, whenever a shard got scanned.
+     * @return true if a new scan was started
+     */
+    bool Start(const OSTreeRepo& repo, std::function<void()> onProgress);
+
+    /// @brief Mark the cached result as outdated. It stays available, until the next scan is done.
+    void Invalidate();
+
+    /// Getter
+    [[nodiscard]] bool IsRunning() const;
+    /// Getter: scanned & total shards of the currently running scan
+    [[nodiscard]] std::pair<size_t, size_t> GetProgress() const;
+    /// Getter: last finished scan, if any
+    [[nodiscard]] std::optional<RepoStatistics> GetResult() const;
+
+    /// @brief Block until the running scan (if any) is done.
+    void Wait() const;
+
+    /**
+     * @brief Cheap fingerprint of the repository state, built from the modification
+     * times of all object prefix directories and all refs.
+     *
+     * @param repoPath Path to the OSTree repository.
+     * @return Stamp, that changes whenever objects or refs get added or removed.
+     */
+    [[nodiscard]] static uint64_t GetRepoChangeStamp(const std::string& repoPath);
+
+   private:
+    /// state shared with the worker tasks, so that they may outlive the collector
+    struct SharedState {
+        std::mutex mutex;
+        std::condition_variable finished;  // notified, whenever a scan is done
+        // running scan
+        bool running{false};
+        std::atomic<size_t> shardsDone{0};
+        std::atomic<size_t> taskCount{0};  // tasks of the running scan
+        RepoStatistics partial;
+        std::unordered_set<std::string> reachableCommits;
+        std::vector<std::string> historyFrontiers;  // unloaded history & skipped refs
+        std::vector<std::string> commitObjects;     // all commit objects on disk
+        std::chrono::steady_clock::time_point scanStart;
+        uint64_t scanStamp{0};
+        std::function<void()> onProgress;
+        // cache
+        std::optional<RepoStatistics> result;
+        uint64_t resultStamp{0};
+        bool resultStale{false};
+        std::chrono::steady_clock::time_point lastStampCheck;
+    };
+
+    /// @brief Scans one `objects/xx` directory & merges it into the partial result.
+    static void scanShard(const std::shared_ptr<SharedState>& state,
+                          const std::string& repoPath,
+                          size_t shard);
+
+    /// @brief Sums up everything outside of `objects/` into the partial result.
+    static void scanNonObjects(const std::shared_ptr<SharedState>& state, const OSTreeRepo& repo);
+
+    /// @brief Counts the unsigned heads of one batch into the partial result.
+    static void verifyHeads(const std::shared_ptr<SharedState>& state,
+                            const OSTreeRepo& repo,
+                            const std::vector<std::string>& heads);
+
+    /// @brief Marks a shard as done & publishes the result after the last one.
+    static void finishShard(const std::shared_ptr<SharedState>& state,
+                            const std::string& repoPath);
+
+    /// @brief Collects commit objects, that are not reachable from any ref (called after the
+    /// last shard, on data taken out of the state, so that the walk runs unlocked).
+    static std::vector<std::string> findOrphanedCommits(
+        std::unordered_set<std::string>& reachableCommits,
+        const std::vector<std::string>& historyFrontiers,
+        const std::vector<std::string>& commitObjects,
+        const std::string& repoPath);
+
+    ThreadPool& pool;
+    std::shared_ptr<SharedState> state;
+};
+
+/**
+ * @brief Format a byte count in a human readable way (e.g. "12.3 MiB").
+ *
+ * @param bytes Amount of bytes.
+ * @return Formatted string
+ */
+[[nodiscard]] std::string FormatByteSize(uint64_t bytes);
+
+}  // namespace cpplibostree
@@ -0,0 +1,368 @@
+#include "retention.hpp"
+
+// C++
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+// C
+#include <fcntl.h>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+#include "commitReader.hpp"
+#include "reachability.hpp"
+#include "repoStatistics.hpp"
+
+namespace cpplibostree {
+
+namespace {
+
+/// @brief Parse a date (YYYY-MM-DD) to its first second.
+std::optional<Timepoint> parseDate(const std::string& word) {
+    int year{0};
+    unsigned int month{0};
+    unsigned int day{0};
+    char rest{0};
+    if (std::sscanf(word.c_str(), "%d-%u-%u%c", &year, &month, &day, &rest) != 3) {
+        return std::nullopt;
+    }
+    const std::chrono::year_month_day date{std::chrono::year(year), std::chrono::month(month),
+                                           std::chrono::day(day)};
+    if (!date.ok()) {
+        return std::nullopt;
+    }
+    return Timepoint(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::sys_days(date).time_since_epoch()));
+}
+
+/**
+ * @brief Add the commits, that no ref reaches (e.g. orphaned ones), to the reachable set, so
+ * that the prune pass only deletes what the plan shows. Their parents are not added.
+ */
+bool keepUnreferencedCommits(OstreeRepo* repo,
+                             GHashTable* refs,
+                             GHashTable* reachable,
+                             GError** error) {
+    // commits of the complete history of all refs (parent links only, no trees)
+    std::unordered_set<std::string> referenced;
+    const CommitReader reader(repo);
+    GHashTableIter iter;
+    gpointer key{nullptr};
+    gpointer value{nullptr};
+    g_hash_table_iter_init(&iter, refs);
+    while (g_hash_table_iter_next(&iter, nullptr, &value)) {
+        g_autofree char* current = g_strdup(static_cast<const char*>(value));
+        while (current != nullptr && referenced.insert(current).second) {
+            g_autoptr(GVariant) variant = nullptr;
+            if (!reader.Load(current, &variant, nullptr)) {
+                break;
+            }
+            char* parent = ostree_commit_get_parent(variant);
+            g_free(current);
+            current = parent;
+        }
+    }
+
+    GHashTable* commits{nullptr};
+    if (!ostree_repo_list_commit_objects_starting_with(repo, "", &commits, nullptr, error)) {
+        return false;
+    }
+    bool success{true};
+    g_hash_table_iter_init(&iter, commits);
+    while (success && g_hash_table_iter_next(&iter, &key, nullptr)) {
+        const char* checksum{nullptr};
+        OstreeObjectType objectType{};
+        ostree_object_name_deserialize(static_cast<GVariant*>(key), &checksum, &objectType);
+        if (!referenced.contains(checksum)) {
+            success = ostree_repo_traverse_commit_union(repo, checksum, 0, reachable, nullptr,
+                                                        error);
+        }
+    }
+    g_hash_table_unref(commits);
+    return success;
+}
+
+/**
+ * @brief Traverse everything reachable from the current refs into `reachable`. With a plan, the
+ * refs of the plan are only traversed up to their kept depth (moved refs completely, counted
+ * in `refsSkipped`) and commits, that no ref reaches, are kept as well.
+ */
+bool traverseRefs(OstreeRepo* repo,
+                  const RetentionPlan* plan,
+                  GHashTable* reachable,
+                  size_t& refsSkipped,
+                  GError** error) {
+    std::unordered_map<std::string_view, const RetentionRefPlan*> plannedRefs;
+    if (plan != nullptr) {
+        for (const auto& refPlan : plan->refs) {
+            plannedRefs[refPlan.ref] = &refPlan;
+        }
+    }
+    GHashTable* refs{nullptr};
+    if (!ostree_repo_list_refs_ext(repo, nullptr, &refs, OSTREE_REPO_LIST_REFS_EXT_NONE, nullptr,
+                                   error)) {
+        return false;
+    }
+
+    GHashTableIter iter;
+    gpointer key{nullptr};
+    gpointer value{nullptr};
+    bool success{true};
+    g_hash_table_iter_init(&iter, refs);
+    while (success && g_hash_table_iter_next(&iter, &key, &value)) {
+        const std::string_view ref(static_cast<const char*>(key));
+        const char* checksum = static_cast<const char*>(value);
+        int depth{-1};
+        auto refPlan = plannedRefs.find(ref);
+        if (refPlan != plannedRefs.end() && refPlan->second->kept.has_value()) {
+            if (refPlan->second->head == checksum) {
+                depth = static_cast<int>(refPlan->second->kept.value()) - 1;
+            } else {
+                refsSkipped++;
+            }
+        }
+        // a ref, that can't be traversed, would lose all its objects -> don't prune at all
+        success = ostree_repo_traverse_commit_union(repo, checksum, depth, reachable, nullptr,
+                                                    error);
+    }
+    if (success && plan != nullptr) {
+        success = keepUnreferencedCommits(repo, refs, reachable, error);
+    }
+    g_hash_table_unref(refs);
+    return success;
+}
+
+}  // namespace
+
+std::optional<RetentionPolicy> RetentionPolicy::Parse(const std::vector<std::string>& words) {
+    RetentionPolicy policy;
+    for (const auto& word : words) {
+        if (!word.empty() && std::all_of(word.begin(), word.end(),
+                                        [](unsigned char c) { return std::isdigit(c) != 0; })) {
+            size_t keep{0};
+            if (std::sscanf(word.c_str(), "%zu", &keep) != 1 || keep == 0) {
+                return std::nullopt;
+            }
+            policy.keepNewest = keep;
+        } else if (auto date = parseDate(word); date.has_value()) {
+            policy.keepSince = date;
+        } else {
+            auto pattern = RefPattern::Compile(word, RefPattern::GuessSyntax(word));
+            if (!pattern.has_value()) {
+                return std::nullopt;
+            }
+            policy.refs.push_back(std::move(pattern.value()));
+        }
+    }
+    if (!policy.keepNewest.has_value() && !policy.keepSince.has_value()) {
+        return std::nullopt;
+    }
+    return policy;
+}
+
+bool RetentionPolicy::AppliesTo(const std::string& ref) const {
+    return refs.empty() || std::any_of(refs.begin(), refs.end(), [&](const RefPattern& pattern) {
+               return pattern.Matches(ref);
+           });
+}
+
+RetentionPlan PlanRetention(const OSTreeRepo& repo, const RetentionPolicy& policy) {
+    const CommitList& commitList = repo.GetCommitList();
+    const ReachabilityIndex& index = repo.GetReachabilityIndex();
+
+    RetentionPlan plan;
+    std::vector<std::vector<size_t>> chains;  // loaded history of every planned ref, newest first
+    CommitBitset affected(commitList.size());
+    CommitBitset kept(commitList.size());
+    std::vector<std::string> refs = repo.GetBranches();
+    std::sort(refs.begin(), refs.end());
+    for (const auto& ref : refs) {
+        auto head = repo.GetBranchHeads().find(ref);
+        if (!policy.AppliesTo(ref)) {
+            kept.Unite(index.GetReachable(ref));
+            continue;
+        }
+        if (head == repo.GetBranchHeads().end()) {
+            continue;
+        }
+
+        // walk the loaded history & find the first dropped commit
+        std::vector<size_t> chain;
+        for (auto commit = commitList.find(head->second); commit != commitList.end();
+             commit = commitList.find(commit->second.parent)) {
+            const auto id = index.GetId(commit->first);
+            if (!id.has_value()) {
+                break;
+            }
+            chain.push_back(id.value());
+        }
+        // no dropped commit within the loaded history: the policy can't be decided on the
+        // older history, that is not loaded yet -> the ref is kept completely
+        RetentionRefPlan refPlan;
+        refPlan.ref = ref;
+        refPlan.head = head->second;
+        for (size_t i{1}; i < chain.size() && !refPlan.kept.has_value(); i++) {
+            const Timepoint timestamp = commitList.at(index.GetHash(chain[i])).timestamp;
+            if ((policy.keepNewest.has_value() && i >= policy.keepNewest.value()) ||
+                (policy.keepSince.has_value() && timestamp < policy.keepSince.value())) {
+                refPlan.kept = i;
+            }
+        }
+        if (!refPlan.kept.has_value() && policy.keepNewest.has_value() &&
+            policy.keepNewest.value() == chain.size()) {
+            refPlan.kept = chain.size();
+        }
+        refPlan.olderHistory =
+            refPlan.kept.has_value() && repo.GetHistoryFrontiers().contains(ref);
+
+        affected.Unite(index.GetReachable(ref));
+        if (refPlan.kept.has_value()) {
+            for (size_t i{0}; i < refPlan.kept.value(); i++) {
+                kept.Set(chain[i]);
+            }
+        } else {
+            kept.Unite(index.GetReachable(ref));
+        }
+        plan.refs.push_back(std::move(refPlan));
+        chains.push_back(std::move(chain));
+    }
+
+    // dropped: reachable from planned refs only, but not kept by any ref
+    affected.Subtract(kept);
+    for (const size_t id : affected.GetIds()) {
+        plan.droppedCommits.push_back(index.GetHash(id));
+    }
+    for (size_t i{0}; i < plan.refs.size(); i++) {
+        const auto& chain = chains[i];
+        plan.refs[i].dropped = static_cast<size_t>(std::count_if(
+            chain.begin(), chain.end(), [&](size_t id) { return affected.Test(id); }));
+    }
+    return plan;
+}
+
+bool ApplyRetention(const std::string& repoPath,
+                    const RetentionPlan& plan,
+                    RetentionResult& result) {
+    result = RetentionResult{};
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    GHashTable* reachable = ostree_repo_traverse_new_reachable();
+    bool success = traverseRefs(repo, &plan, reachable, result.refsSkipped, &error);
+
+    // single prune pass
+    if (success) {
+        OstreeRepoPruneOptions options{};
+        options.flags = OSTREE_REPO_PRUNE_FLAGS_NONE;
+        options.reachable = reachable;
+        guint64 bytesPruned{0};
+        success = ostree_repo_prune_from_reachable(repo, &options, &result.objectsTotal,
+                                                   &result.objectsPruned, &bytesPruned, nullptr,
+                                                   &error);
+        result.bytesPruned = bytesPruned;
+    }
+    if (!success) {
+        g_printerr("Error pruning repository: %s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_hash_table_unref(reachable);
+    g_object_unref(repo);
+    return success;
+}
+
+bool EstimateRetention(const std::string& repoPath, const RetentionPlan& plan, uint64_t& bytes) {
+    bytes = 0;
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
+
+    // reachable now & after the plan was applied, one union traversal each
+    GHashTable* before = ostree_repo_traverse_new_reachable();
+    GHashTable* after = ostree_repo_traverse_new_reachable();
+    size_t refsSkipped{0};
+    const bool success = traverseRefs(repo, nullptr, before, refsSkipped, &error) &&
+                         traverseRefs(repo, &plan, after, refsSkipped, &error);
+    if (success) {
+        GHashTableIter iter;
+        gpointer key{nullptr};
+        g_hash_table_iter_init(&iter, before);
+        while (g_hash_table_iter_next(&iter, &key, nullptr)) {
+            if (g_hash_table_contains(after, key)) {
+                continue;
+            }
+            const char* checksum{nullptr};
+            OstreeObjectType objectType{};
+            ostree_object_name_deserialize(static_cast<GVariant*>(key), &checksum, &objectType);
+            guint64 objectSize{0};
+            if (ostree_repo_query_object_storage_size(repo, objectType, checksum, &objectSize,
+                                                      nullptr, nullptr)) {
+                bytes += objectSize;
+            }
+        }
+    } else {
+        g_printerr("Error traversing repository: %s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_hash_table_unref(after);
+    g_hash_table_unref(before);
+    g_object_unref(repo);
+    return success;
+}
+
+bool RunRetention(OSTreeRepo& repo, const RetentionPolicy& policy, bool apply, std::ostream& out) {
+    if (!repo.UpdateData()) {
+        return false;
+    }
+    const RetentionPlan plan = PlanRetention(repo, policy);
+
+    // preview
+    for (const auto& refPlan : plan.refs) {
+        out << std::left << std::setw(40) << refPlan.ref << std::right << " keep " << std::setw(6)
+            << (refPlan.kept.has_value() ? std::to_string(refPlan.kept.value()) : "all")
+            << "  drop " << std::setw(6) << refPlan.dropped
+            << (refPlan.olderHistory ? " + older history" : "") << "\n";
+    }
+    uint64_t bytes{0};
+    if (!plan.droppedCommits.empty() && !EstimateRetention(repo.GetRepoPath(), plan, bytes)) {
+        return false;
+    }
+    out << "drop " << plan.droppedCommits.size() << " commits on " << plan.refs.size()
+        << " refs, ≈ " << FormatByteSize(bytes) << "\n";
+    if (!apply || plan.droppedCommits.empty()) {
+        return true;
+    }
+
+    RetentionResult result;
+    if (!ApplyRetention(repo.GetRepoPath(), plan, result)) {
+        return false;
+    }
+    out << "pruned " << result.objectsPruned << " of " << result.objectsTotal << " objects, freed "
+        << FormatByteSize(result.bytesPruned);
+    if (result.refsSkipped > 0) {
+        out << " (" << result.refsSkipped << " moved refs kept completely)";
+    }
+    out << "\n";
+    return true;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,115 @@
+/*_____________________________________________________________
+ | Retention
+ |   Bulk pruning by a retention policy ("keep the newest N
+ |   commits", "drop commits older than DATE") on all refs, or
+ |   the ones matching a pattern. The whole set of dropped
+ |   commits is planned at once (for a preview) and removed
+ |   with a single prune pass.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cpplibostree.hpp"
+#include "refPattern.hpp"
+
+namespace cpplibostree {
+
+struct RetentionPolicy {
+    std::optional<size_t> keepNewest;    // commits kept per ref
+    std::optional<Timepoint> keepSince;  // commits older than this are dropped
+    std::vector<RefPattern> refs;        // refs the policy applies to, empty = all refs
+
+    /**
+     * @brief Parse a policy from words, in any order: a number (keep the newest N commits), a
+     * date (YYYY-MM-DD, drop older commits) and ref patterns (text, or globs). At least a
+     * number, or a date is required.
+     *
+     * @param words Words of the policy, like {"5", "stable"}.
+     * @return Policy, or nothing if a word is invalid
+     */
+    [[nodiscard]] static std::optional<RetentionPolicy> Parse(
+        const std::vector<std::string>& words);
+
+    /// @brief Check if the policy applies to a ref.
+    [[nodiscard]] bool AppliesTo(const std::string& ref) const;
+};
+
+struct RetentionRefPlan {
+    std::string ref;
+    std::string head;            // planned head, the ref is not touched if it moved
+    std::optional<size_t> kept;  // commits kept (including the head), nothing = whole history
+    size_t dropped{0};           // loaded commits dropped from this ref
+    bool olderHistory{false};    // older, not loaded history is dropped as well
+};
+
+struct RetentionPlan {
+    std::vector<RetentionRefPlan> refs;       // refs the policy applies to, sorted by name
+    std::vector<std::string> droppedCommits;  // loaded commits, that become unreachable
+};
+
+struct RetentionResult {
+    size_t refsSkipped{0};  // refs, that moved since the plan was made
+    int objectsTotal{0};
+    int objectsPruned{0};
+    uint64_t bytesPruned{0};
+};
+
+/**
+ * @brief Plan, which commits a retention policy drops. The head of a ref is never dropped, so
+ * no ref needs to be reset. Commits, that are still reachable from other refs (or from kept
+ * commits of other refs) are kept. If the loaded history of a ref does not reach far enough
+ * to apply the policy, the ref is kept completely.
+ *
+ * @param repo Loaded repository.
+ * @param policy Retention policy.
+ * @return Plan, to preview & apply
+ */
+[[nodiscard]] RetentionPlan PlanRetention(const OSTreeRepo& repo, const RetentionPolicy& policy);
+
+/**
+ * @brief Apply a retention plan with a single prune pass (`ostree prune --depth` per ref):
+ * all refs are traversed once (refs of the plan up to their kept depth) and everything else
+ * is deleted. Commits, that no ref reaches (e.g. orphaned ones), are not part of the plan and
+ * are kept. The repository data needs to be reloaded afterwards.
+ *
+ * @param repoPath Path to the OSTree repository.
+ * @param plan Plan of PlanRetention().
+ * @param result Set to the statistics of the prune pass.
+ * @return true on success
+ */
+bool ApplyRetention(const std::string& repoPath,
+                    const RetentionPlan& plan,
+                    RetentionResult& result);
+
+/**
+ * @brief Estimate the bytes, that applying a retention plan frees: the objects reachable from
+ * the refs now, but not after applying the plan. Both sets are built with one union traversal
+ * each, so objects shared by dropped commits are only counted once.
+ *
+ * @param repoPath Path to the OSTree repository.
+ * @param plan Plan of PlanRetention().
+ * @param bytes Set to the size of the freed objects.
+ * @return true on success
+ */
+bool EstimateRetention(const std::string& repoPath, const RetentionPlan& plan, uint64_t& bytes);
+
+/**
+ * @brief Non-interactive retention: load the repository, write the preview (kept & dropped
+ * commits per ref, freed size) to `out` and apply the plan, if requested.
+ *
+ * @param repo Repository (does not need to be loaded).
+ * @param policy Retention policy.
+ * @param apply Prune the dropped commits, instead of only previewing them.
+ * @param out Stream to write to.
+ * @return true on success
+ */
+bool RunRetention(OSTreeRepo& repo, const RetentionPolicy& policy, bool apply, std::ostream& out);
+
+}  // namespace cpplibostree
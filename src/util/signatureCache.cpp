@@ -0,0 +1,358 @@
+#include "signatureCache.hpp"
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+// external
+#include <glib.h>
+
+namespace cpplibostree {
+
+namespace {
+
+/// GVariant format of the cache file: version, map commit hash -> (keyring fingerprint, sigs)
+constexpr const char* CACHE_FORMAT{"(ua{s(sa(sbbbbbssxxsssxx))})"};
+constexpr const char* ENTRIES_FORMAT{"a{s(sa(sbbbbbssxxsssxx))}"};
+constexpr const char* SIGNATURES_FORMAT{"a(sbbbbbssxxsssxx)"};
+
+gint64 toSeconds(const Timepoint& timepoint) {
+    return std::chrono::duration_cast<std::chrono::seconds>(timepoint.time_since_epoch()).count();
+}
+
+/// @brief Add all regular files of a directory, whose name ends with `suffix`.
+void addKeyringFiles(const std::filesystem::path& directory,
+                     std::string_view suffix,
+                     std::vector<std::filesystem::path>& files) {
+    std::error_code ec;
+    std::filesystem::directory_iterator it(directory, ec);
+    for (std::filesystem::directory_iterator end; !ec && it != end; it.increment(ec)) {
+        std::error_code typeError;
+        if (it->is_regular_file(typeError) && it->path().filename().string().ends_with(suffix)) {
+            files.push_back(it->path());
+        }
+    }
+}
+
+/// @brief Add a single file, if it exists.
+void addKeyringFile(const std::filesystem::path& file, std::vector<std::filesystem::path>& files) {
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(file, ec)) {
+        files.push_back(file);
+    }
+}
+
+/// @brief Add the keys of all remotes in a config file: the keyrings of `gpgkeypath` (a file, or
+/// a directory, several ones separated by `;`, or `,`), the ed25519 key file of
+/// `verification-ed25519-file` & the inline ed25519 key of `verification-ed25519-key`.
+void addRemoteKeys(const std::filesystem::path& config,
+                   std::vector<std::filesystem::path>& files,
+                   std::vector<std::string>& keys) {
+    GKeyFile* keyFile = g_key_file_new();
+    if (!g_key_file_load_from_file(keyFile, config.c_str(), G_KEY_FILE_NONE, nullptr)) {
+        g_key_file_free(keyFile);
+        return;
+    }
+    gchar** groups = g_key_file_get_groups(keyFile, nullptr);
+    for (gchar** group = groups; *group != nullptr; group++) {
+        if (!g_str_has_prefix(*group, "remote \"")) {
+            continue;
+        }
+        g_autofree gchar* ed25519File =
+            g_key_file_get_string(keyFile, *group, "verification-ed25519-file", nullptr);
+        if (ed25519File != nullptr) {
+            addKeyringFile(ed25519File, files);
+        }
+        g_autofree gchar* ed25519Key =
+            g_key_file_get_string(keyFile, *group, "verification-ed25519-key", nullptr);
+        if (ed25519Key != nullptr) {
+            keys.emplace_back(ed25519Key);
+        }
+        g_autofree gchar* paths = g_key_file_get_string(keyFile, *group, "gpgkeypath", nullptr);
+        if (paths == nullptr) {
+            continue;
+        }
+        gchar** splitPaths = g_strsplit_set(paths, ";,", -1);
+        for (gchar** path = splitPaths; *path != nullptr; path++) {
+            const std::filesystem::path keyPath = g_strstrip(*path);
+            if (keyPath.empty()) {
+                continue;
+            }
+            std::error_code ec;
+            if (std::filesystem::is_directory(keyPath, ec)) {
+                addKeyringFiles(keyPath, "", files);
+            } else {
+                addKeyringFile(keyPath, files);
+            }
+        }
+        g_strfreev(splitPaths);
+    }
+    g_strfreev(groups);
+    g_key_file_free(keyFile);
+}
+
+/// @brief Check, if a signature or its key expired since the signature was verified.
+bool expiredSinceVerification(const Signature& sig, Timepoint now) {
+    // a timestamp of 0 never expires
+    auto passed = [now](const Timepoint& timestamp) {
+        return timestamp.time_since_epoch().count() != 0 && timestamp <= now;
+    };
+    return (!sig.sigExpired && passed(sig.expireTimestamp)) ||
+           (!sig.keyExpired &&
+            (passed(sig.keyExpireTimestamp) || passed(sig.keyExpireTimestampPrimary)));
+}
+
+/// @brief Path of the cache file of a repository: one file per (canonical) repository path.
+std::string getCachePath(const std::string& repoPath) {
+    std::error_code ec;
+    std::string canonical = std::filesystem::weakly_canonical(repoPath, ec).string();
+    if (ec) {
+        canonical = repoPath;
+    }
+    g_autofree gchar* pathHash = g_compute_checksum_for_data(
+        G_CHECKSUM_SHA256, reinterpret_cast<const guchar*>(canonical.data()), canonical.size());
+    return (std::filesystem::path(g_get_user_cache_dir()) / "ostree-tui" /
+            ("signatures-" + std::string(pathHash, 16) + ".gvariant"))
+        .string();
+}
+
+}  // namespace
+
+SignatureCache::SignatureCache(const std::string& repoPath)
+    : repoPath(repoPath),
+      cachePath(getCachePath(repoPath)),
+      keyringFingerprint(ComputeKeyringFingerprint(repoPath)) {
+    load();
+}
+
+bool SignatureCache::UpdateKeyringFingerprint() {
+    std::string fingerprint = ComputeKeyringFingerprint(repoPath);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fingerprint == keyringFingerprint) {
+        return false;
+    }
+    keyringFingerprint = std::move(fingerprint);
+    return true;
+}
+
+std::optional<std::vector<Signature>> SignatureCache::Find(const std::string& hash) const {
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = entries.find(hash);
+    if (entry == entries.end() || isStale(entry->second, now)) {
+        return std::nullopt;
+    }
+    return entry->second.signatures;
+}
+
+void SignatureCache::Store(const std::string& hash, std::vector<Signature> signatures) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[hash];
+    entry.keyringFingerprint = keyringFingerprint;
+    entry.signatures = std::move(signatures);
+    changed = true;
+}
+
+void SignatureCache::Remove(const std::string& hash) {
+    std::lock_guard<std::mutex> lock(mutex);
+    changed = entries.erase(hash) > 0 || changed;
+}
+
+std::vector<std::string> SignatureCache::GetStaleCommits() const {
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> stale;
+    for (const auto& [hash, entry] : entries) {
+        if (isStale(entry, now)) {
+            stale.push_back(hash);
+        }
+    }
+    return stale;
+}
+
+bool SignatureCache::isStale(const Entry& entry, Timepoint now) const {
+    return entry.keyringFingerprint != keyringFingerprint ||
+           std::any_of(entry.signatures.begin(), entry.signatures.end(),
+                       [now](const Signature& sig) { return expiredSinceVerification(sig, now); });
+}
+
+bool SignatureCache::Save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!changed) {
+        return true;
+    }
+
+    GVariantBuilder entriesBuilder;
+    g_variant_builder_init(&entriesBuilder, G_VARIANT_TYPE(ENTRIES_FORMAT));
+    for (const auto& [hash, entry] : entries) {
+        GVariantBuilder signaturesBuilder;
+        g_variant_builder_init(&signaturesBuilder, G_VARIANT_TYPE(SIGNATURES_FORMAT));
+        for (const auto& sig : entry.signatures) {
+            g_variant_builder_add(
+                &signaturesBuilder, "(sbbbbbssxxsssxx)", sig.scheme.c_str(),
+                static_cast<gboolean>(sig.valid), static_cast<gboolean>(sig.sigExpired),
+                static_cast<gboolean>(sig.keyExpired),
+                static_cast<gboolean>(sig.keyRevoked), static_cast<gboolean>(sig.keyMissing),
+                sig.fingerprint.c_str(), sig.fingerprintPrimary.c_str(), toSeconds(sig.timestamp),
+                toSeconds(sig.expireTimestamp), sig.pubkeyAlgorithm.c_str(), sig.username.c_str(),
+                sig.usermail.c_str(), toSeconds(sig.keyExpireTimestamp),
+                toSeconds(sig.keyExpireTimestampPrimary));
+        }
+        g_variant_builder_add(&entriesBuilder, "{s(sa(sbbbbbssxxsssxx))}", hash.c_str(),
+                              entry.keyringFingerprint.c_str(), &signaturesBuilder);
+    }
+    g_autoptr(GVariant) cache = g_variant_ref_sink(
+        g_variant_new("(ua{s(sa(sbbbbbssxxsssxx))})", SIGNATURE_CACHE_VERSION, &entriesBuilder));
+
+    // written to a temporary file & renamed, readers never see a partial file
+    const std::string directory = std::filesystem::path(cachePath).parent_path().string();
+    GError* error{nullptr};
+    if (g_mkdir_with_parents(directory.c_str(), 0700) != 0 ||
+        !g_file_set_contents(cachePath.c_str(),
+                             static_cast<const gchar*>(g_variant_get_data(cache)),
+                             static_cast<gssize>(g_variant_get_size(cache)), &error)) {
+        g_printerr("Error writing signature cache %s: %s\n", cachePath.c_str(),
+                   error != nullptr ? error->message : "can't create directory");
+        g_clear_error(&error);
+        return false;
+    }
+    changed = false;
+    return true;
+}
+
+std::string SignatureCache::ComputeKeyringFingerprint(const std::string& repoPath) {
+    std::vector<std::filesystem::path> files;
+    // remote keyrings of the repository (<remote>.trustedkeys.gpg)
+    addKeyringFiles(repoPath, ".trustedkeys.gpg", files);
+    // global keyrings, used for all remotes
+    const char* gpgHome = g_getenv("OSTREE_GPG_HOME");
+    addKeyringFiles(gpgHome != nullptr ? gpgHome : "/usr/share/ostree/trusted.gpg.d", ".gpg",
+                    files);
+    addKeyringFiles("/etc/ostree/trusted.gpg.d", ".gpg", files);
+    // keys of single remotes, configured in the repository, or system wide
+    std::vector<std::string> keys;
+    addRemoteKeys(std::filesystem::path(repoPath) / "config", files, keys);
+    std::vector<std::filesystem::path> remoteConfigs;
+    addKeyringFiles("/etc/ostree/remotes.d", ".conf", remoteConfigs);
+    for (const auto& config : remoteConfigs) {
+        addRemoteKeys(config, files, keys);
+    }
+    // trusted ed25519 public keys of `ostree sign`
+    for (const std::filesystem::path directory : {"/etc/ostree", "/usr/share/ostree"}) {
+        addKeyringFile(directory / "trusted.ed25519", files);
+        addKeyringFiles(directory / "trusted.ed25519.d", "", files);
+    }
+    std::sort(files.begin(), files.end());
+    std::sort(keys.begin(), keys.end());
+
+    GChecksum* checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    auto update = [&](const std::string& data) {
+        g_checksum_update(checksum, reinterpret_cast<const guchar*>(data.data()),
+                          static_cast<gssize>(data.size()));
+    };
+    for (const auto& file : files) {
+        std::error_code ec;
+        const auto mtime = std::filesystem::last_write_time(file, ec);
+        std::ifstream stream(file, std::ios::binary);
+        const std::string content{std::istreambuf_iterator<char>(stream),
+                                  std::istreambuf_iterator<char>()};
+        // separated by NUL, which is neither part of a path, nor of a number
+        update(file.string() + '\0' + std::to_string(mtime.time_since_epoch().count()) + '\0' +
+               std::to_string(content.size()) + '\0');
+        update(content);
+    }
+    for (const auto& key : keys) {
+        update(key + '\0');
+    }
+    std::string fingerprint = g_checksum_get_string(checksum);
+    g_checksum_free(checksum);
+    return fingerprint;
+}
+
+void SignatureCache::load() {
+    GMappedFile* file = g_mapped_file_new(cachePath.c_str(), FALSE, nullptr);
+    if (file == nullptr) {
+        return;
+    }
+    GBytes* bytes = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+    // written by another process -> not trusted
+    g_autoptr(GVariant) cache =
+        g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE(CACHE_FORMAT), bytes, FALSE));
+    g_bytes_unref(bytes);
+
+    guint32 version{0};
+    g_variant_get_child(cache, 0, "u", &version);
+    if (version != SIGNATURE_CACHE_VERSION) {
+        return;
+    }
+    g_autoptr(GVariant) cachedEntries = g_variant_get_child_value(cache, 1);
+    const gsize entryCount = g_variant_n_children(cachedEntries);
+    entries.reserve(entryCount);
+    for (gsize i{0}; i < entryCount; i++) {
+        g_autoptr(GVariant) cachedEntry = g_variant_get_child_value(cachedEntries, i);
+        g_autoptr(GVariant) value = g_variant_get_child_value(cachedEntry, 1);
+        g_autoptr(GVariant) signatures = g_variant_get_child_value(value, 1);
+        const gchar* hash{nullptr};
+        const gchar* fingerprint{nullptr};
+        g_variant_get_child(cachedEntry, 0, "&s", &hash);
+        g_variant_get_child(value, 0, "&s", &fingerprint);
+
+        Entry entry;
+        entry.keyringFingerprint = fingerprint;
+        const gsize signatureCount = g_variant_n_children(signatures);
+        for (gsize j{0}; j < signatureCount; j++) {
+            g_autoptr(GVariant) signature = g_variant_get_child_value(signatures, j);
+            const gchar* scheme{nullptr};
+            gboolean valid{FALSE};
+            gboolean sigExpired{FALSE};
+            gboolean keyExpired{FALSE};
+            gboolean keyRevoked{FALSE};
+            gboolean keyMissing{FALSE};
+            const gchar* sigFingerprint{nullptr};
+            const gchar* fingerprintPrimary{nullptr};
+            gint64 timestamp{0};
+            gint64 expireTimestamp{0};
+            const gchar* pubkeyAlgorithm{nullptr};
+            const gchar* username{nullptr};
+            const gchar* usermail{nullptr};
+            gint64 keyExpireTimestamp{0};
+            gint64 keyExpireTimestampPrimary{0};
+            g_variant_get(signature, "(&sbbbbb&s&sxx&s&s&sxx)", &scheme, &valid, &sigExpired,
+                          &keyExpired, &keyRevoked, &keyMissing, &sigFingerprint,
+                          &fingerprintPrimary, &timestamp, &expireTimestamp, &pubkeyAlgorithm,
+                          &username, &usermail, &keyExpireTimestamp, &keyExpireTimestampPrimary);
+
+            Signature sig;
+            sig.scheme = scheme;
+            sig.valid = valid;
+            sig.sigExpired = sigExpired;
+            sig.keyExpired = keyExpired;
+            sig.keyRevoked = keyRevoked;
+            sig.keyMissing = keyMissing;
+            sig.fingerprint = sigFingerprint;
+            sig.fingerprintPrimary = fingerprintPrimary;
+            sig.timestamp = Timepoint(std::chrono::seconds(timestamp));
+            sig.expireTimestamp = Timepoint(std::chrono::seconds(expireTimestamp));
+            sig.pubkeyAlgorithm = pubkeyAlgorithm;
+            sig.username = username;
+            sig.usermail = usermail;
+            sig.keyExpireTimestamp = Timepoint(std::chrono::seconds(keyExpireTimestamp));
+            sig.keyExpireTimestampPrimary =
+                Timepoint(std::chrono::seconds(keyExpireTimestampPrimary));
+            entry.signatures.push_back(std::move(sig));
+        }
+        entries.emplace(hash, std::move(entry));
+    }
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,102 @@
+/*_____________________________________________________________
+ | Signature Cache
+ |   Verified commit signatures, kept on disk across runs (in
+ |   the user's cache directory, one file per repository).
+ |   Every entry is tagged with a fingerprint of the trusted
+ |   keyrings (paths, mtimes & checksums of the keyring files
+ |   of the repository, its remotes & the system), and only used
+ |   while the keyrings are unchanged. Entries of other keyrings
+ |   and entries, whose signature or key expired since they got
+ |   verified, are stale and have to be verified again.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cpplibostree.hpp"
+
+namespace cpplibostree {
+
+/// version of the cache file format, files of other versions are ignored
+constexpr uint32_t SIGNATURE_CACHE_VERSION{2};
+
+class SignatureCache {
+   public:
+    /**
+     * @brief Construct a new SignatureCache & read its file (if any).
+     *
+     * @param repoPath Path to the OSTree repository.
+     */
+    explicit SignatureCache(const std::string& repoPath);
+
+    /**
+     * @brief Recompute the fingerprint of the trusted keyrings. If they changed, all entries
+     * become stale.
+     *
+     * @return true if the keyrings changed
+     */
+    bool UpdateKeyringFingerprint();
+
+    /**
+     * @brief Get the cached signatures of a commit, only if they were verified with the current
+     * keyrings & did not expire since. Thread safe.
+     *
+     * @param hash Hash of the commit.
+     * @return Signatures (empty, if the commit is not signed), or nothing if unknown or stale
+     */
+    [[nodiscard]] std::optional<std::vector<Signature>> Find(const std::string& hash) const;
+
+    /// @brief Store the signatures of a commit, verified with the current keyrings. Thread safe.
+    void Store(const std::string& hash, std::vector<Signature> signatures);
+
+    /// @brief Drop the entry of a commit (e.g. if it was pruned). Thread safe.
+    void Remove(const std::string& hash);
+
+    /// Getter: commits, whose entries were verified with other keyrings, or expired since.
+    /// Thread safe.
+    [[nodiscard]] std::vector<std::string> GetStaleCommits() const;
+
+    /**
+     * @brief Write the cache file (atomically replaced), if any entry changed. Thread safe.
+     *
+     * @return true on success, or if there was nothing to write
+     */
+    bool Save();
+
+    /**
+     * @brief Fingerprint of the keyrings used to verify the commits of a repository: the remote
+     * keyrings of the repository (also the `gpgkeypath` ones & the ed25519 keys of the remotes),
+     * the global keyring directories & the trusted ed25519 keys.
+     *
+     * @param repoPath Path to the OSTree repository.
+     * @return Hex SHA256 checksum
+     */
+    [[nodiscard]] static std::string ComputeKeyringFingerprint(const std::string& repoPath);
+
+   private:
+    struct Entry {
+        std::string keyringFingerprint;
+        std::vector<Signature> signatures;
+    };
+
+    /// @brief Read the cache file, a missing, or unreadable one is an empty cache.
+    void load();
+
+    /// @brief Check, if an entry has to be verified again (with the state locked).
+    [[nodiscard]] bool isStale(const Entry& entry, Timepoint now) const;
+
+    std::string repoPath;
+    std::string cachePath;
+    mutable std::mutex mutex;
+    std::string keyringFingerprint;
+    std::unordered_map<std::string, Entry> entries;  // map commit hash -> entry
+    bool changed{false};                             // entries differ from the cache file
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,197 @@
+#include "signatureVerifier.hpp"
+
+// C++
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+namespace cpplibostree {
+
+SignatureVerifier::SignatureVerifier(OstreeRepo* repo) {
+    ed25519 = ostree_sign_get_by_name(SIGNATURE_SCHEME_ED25519.data(), nullptr);
+    if (ed25519 == nullptr) {
+        return;
+    }
+    // no options: the default key files & directories
+    GVariantBuilder options;
+    g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+    g_autoptr(GVariant) noOptions = g_variant_ref_sink(g_variant_builder_end(&options));
+    ed25519KeysLoaded = ostree_sign_load_pk(ed25519, noOptions, nullptr);
+    // keys are added, not replaced (also see ostree pull)
+    ed25519KeysLoaded = loadRemoteEd25519Keys(repo) || ed25519KeysLoaded;
+}
+
+SignatureVerifier::~SignatureVerifier() {
+    if (ed25519 != nullptr) {
+        g_object_unref(ed25519);
+    }
+}
+
+bool SignatureVerifier::loadRemoteEd25519Keys(OstreeRepo* repo) {
+    bool loaded{false};
+    gchar** remotes = ostree_repo_remote_list(repo, nullptr);
+    if (remotes == nullptr) {
+        return false;
+    }
+    for (gchar** remote = remotes; *remote != nullptr; remote++) {
+        g_autofree gchar* keyFile{nullptr};
+        g_autofree gchar* key{nullptr};
+        ostree_repo_get_remote_option(repo, *remote, "verification-ed25519-file", nullptr,
+                                      &keyFile, nullptr);
+        ostree_repo_get_remote_option(repo, *remote, "verification-ed25519-key", nullptr, &key,
+                                      nullptr);
+        if (keyFile != nullptr) {
+            GVariantBuilder options;
+            g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+            g_variant_builder_add(&options, "{sv}", "filename", g_variant_new_string(keyFile));
+            g_autoptr(GVariant) fileOptions = g_variant_ref_sink(g_variant_builder_end(&options));
+            if (ostree_sign_load_pk(ed25519, fileOptions, nullptr)) {
+                loaded = true;
+            } else {
+                g_printerr("Can't load the ed25519 keys of remote %s from %s\n", *remote, keyFile);
+            }
+        }
+        if (key != nullptr) {
+            g_autoptr(GVariant) publicKey = g_variant_ref_sink(g_variant_new_string(key));
+            if (ostree_sign_add_pk(ed25519, publicKey, nullptr)) {
+                loaded = true;
+            } else {
+                g_printerr("Can't load the ed25519 key of remote %s\n", *remote);
+            }
+        }
+    }
+    g_strfreev(remotes);
+    return loaded;
+}
+
+std::vector<Signature> SignatureVerifier::Verify(OstreeRepo* repo,
+                                                 const std::string& hash,
+                                                 GVariant* variant,
+                                                 GVariant* detachedMetadata) const {
+    std::vector<Signature> signatures;
+    verifyGpg(repo, hash, signatures);
+    verifyEd25519(variant, detachedMetadata, signatures);
+    return signatures;
+}
+
+void SignatureVerifier::verifyGpg(OstreeRepo* repo,
+                                  const std::string& hash,
+                                  std::vector<Signature>& signatures) {
+    // see ostree print_object for reference
+    g_autoptr(OstreeGpgVerifyResult) result = nullptr;
+    g_autoptr(GError) local_error = nullptr;
+    result = ostree_repo_verify_commit_ext(repo, hash.c_str(), nullptr, nullptr, nullptr,
+                                           &local_error);
+    if (g_error_matches(local_error, OSTREE_GPG_ERROR, OSTREE_GPG_ERROR_NO_SIGNATURE) ||
+        local_error != nullptr) {
+        /* Ignore */
+    } else {
+        assert(result);
+        guint n_sigs = ostree_gpg_verify_result_count_all(result);
+        // parse all found signatures
+        for (guint ii = 0; ii < n_sigs; ii++) {
+            g_autoptr(GVariant) variant = nullptr;
+            variant = ostree_gpg_verify_result_get_all(result, ii);
+            // see ostree_gpg_verify_result_describe_variant for reference
+            gint64 timestamp{0};
+            gint64 exp_timestamp{0};
+            gint64 key_exp_timestamp{0};
+            gint64 key_exp_timestamp_primary{0};
+            const char* fingerprint{nullptr};
+            const char* fingerprintPrimary{nullptr};
+            const char* pubkey_algo{nullptr};
+            const char* user_name{nullptr};
+            const char* user_email{nullptr};
+            gboolean valid{false};
+            gboolean sigExpired{false};
+            gboolean keyExpired{false};
+            gboolean keyRevoked{false};
+            gboolean keyMissing{false};
+
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_VALID, "b", &valid);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_SIG_EXPIRED, "b", &sigExpired);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXPIRED, "b", &keyExpired);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_REVOKED, "b", &keyRevoked);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_MISSING, "b", &keyMissing);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_FINGERPRINT, "&s", &fingerprint);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_FINGERPRINT_PRIMARY, "&s",
+                                &fingerprintPrimary);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_TIMESTAMP, "x", &timestamp);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_EXP_TIMESTAMP, "x",
+                                &exp_timestamp);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_PUBKEY_ALGO_NAME, "&s",
+                                &pubkey_algo);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_USER_NAME, "&s", &user_name);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_USER_EMAIL, "&s", &user_email);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXP_TIMESTAMP, "x",
+                                &key_exp_timestamp);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXP_TIMESTAMP_PRIMARY, "x",
+                                &key_exp_timestamp_primary);
+
+            // create signature struct
+            Signature sig;
+
+            sig.scheme = SIGNATURE_SCHEME_GPG;
+            sig.valid = valid;
+            sig.sigExpired = sigExpired;
+            sig.keyExpired = keyExpired;
+            sig.keyRevoked = keyRevoked;
+            sig.keyMissing = keyMissing;
+            sig.fingerprint = fingerprint;
+            sig.fingerprintPrimary = fingerprintPrimary;
+            sig.timestamp = Timepoint(std::chrono::seconds(timestamp));
+            sig.expireTimestamp = Timepoint(std::chrono::seconds(exp_timestamp));
+            sig.pubkeyAlgorithm = pubkey_algo;
+            sig.username = user_name;
+            sig.usermail = user_email;
+            sig.keyExpireTimestamp = Timepoint(std::chrono::seconds(key_exp_timestamp));
+            sig.keyExpireTimestampPrimary =
+                Timepoint(std::chrono::seconds(key_exp_timestamp_primary));
+
+            signatures.push_back(std::move(sig));
+        }
+    }
+}
+
+void SignatureVerifier::verifyEd25519(GVariant* variant,
+                                      GVariant* detachedMetadata,
+                                      std::vector<Signature>& signatures) const {
+    if (ed25519 == nullptr || detachedMetadata == nullptr) {
+        return;
+    }
+    g_autoptr(GVariant) ed25519Signatures = g_variant_lookup_value(
+        detachedMetadata, ostree_sign_metadata_key(ed25519),
+        G_VARIANT_TYPE(ostree_sign_metadata_format(ed25519)));
+    if (ed25519Signatures == nullptr) {
+        return;
+    }
+
+    // ed25519 keys never expire & signatures carry no timestamp
+    Signature sig;
+    sig.scheme = SIGNATURE_SCHEME_ED25519;
+    sig.pubkeyAlgorithm = "ed25519";
+    sig.sigExpired = false;
+    sig.keyExpired = false;
+    sig.keyMissing = !ed25519KeysLoaded;
+    if (ed25519KeysLoaded) {
+        // the signed data is the serialized commit object
+        g_autoptr(GBytes) data = g_variant_get_data_as_bytes(variant);
+        g_autofree char* message{nullptr};
+        sig.valid = ostree_sign_data_verify(ed25519, data, ed25519Signatures, &message, nullptr);
+        // "... verified with key '<public key>'"
+        const std::string verified = message != nullptr ? message : "";
+        const size_t keyStart = verified.find('\'');
+        const size_t keyEnd = verified.rfind('\'');
+        if (keyStart != std::string::npos && keyEnd > keyStart) {
+            sig.fingerprint = verified.substr(keyStart + 1, keyEnd - keyStart - 1);
+        }
+    }
+    signatures.push_back(std::move(sig));
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,81 @@
+/*_____________________________________________________________
+ | Signature Verifier
+ |   Verifies both kinds of commit signatures: GPG signatures
+ |   (checked by libostree against the keyrings of the repo)
+ |   and ed25519 signatures made with `ostree sign` (checked
+ |   against the trusted public keys & the keys of the remotes,
+ |   loaded once per verifier - one verifier per batch of
+ |   commits).
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <string>
+#include <string_view>
+#include <vector>
+// external
+#include <glib.h>
+#include <ostree.h>
+
+#include "cpplibostree.hpp"
+
+namespace cpplibostree {
+
+/// Signature::scheme of GPG signatures
+constexpr std::string_view SIGNATURE_SCHEME_GPG{"gpg"};
+/// Signature::scheme of ed25519 signatures (`ostree sign`)
+constexpr std::string_view SIGNATURE_SCHEME_ED25519{"ed25519"};
+/// commits verified together (sharing one verifier) per pool task
+constexpr size_t SIGNATURE_BATCH_SIZE{64};
+
+class SignatureVerifier {
+   public:
+    /**
+     * @brief Construct a new SignatureVerifier & load the trusted ed25519 public keys from the
+     * default locations of `ostree sign` (`/etc/ostree/trusted.ed25519[.d]`, ...) and the
+     * `verification-ed25519-file` & `verification-ed25519-key` options of all remotes of a
+     * repository. Commits are not tied to a remote, a key of any remote verifies them.
+     *
+     * @param repo Opened repository.
+     */
+    explicit SignatureVerifier(OstreeRepo* repo);
+    ~SignatureVerifier();
+    SignatureVerifier(const SignatureVerifier&) = delete;
+    SignatureVerifier& operator=(const SignatureVerifier&) = delete;
+
+    /**
+     * @brief Verify all signatures of a commit.
+     *
+     * @param repo Opened repository.
+     * @param hash Hash of the commit.
+     * @param variant Commit object (the signed data of ed25519 signatures).
+     * @param detachedMetadata Detached metadata of the commit (holds the ed25519 signatures),
+     * might be nullptr.
+     * @return GPG signatures, followed by the ed25519 one (empty, if the commit is not signed)
+     */
+    [[nodiscard]] std::vector<Signature> Verify(OstreeRepo* repo,
+                                                const std::string& hash,
+                                                GVariant* variant,
+                                                GVariant* detachedMetadata) const;
+
+   private:
+    /// @brief Load the ed25519 keys of the options of all remotes.
+    /// @return true, if any key was loaded
+    bool loadRemoteEd25519Keys(OstreeRepo* repo);
+
+    /// @brief Append the GPG signatures of a commit, as checked by libostree.
+    static void verifyGpg(OstreeRepo* repo,
+                          const std::string& hash,
+                          std::vector<Signature>& signatures);
+
+    /// @brief Append one ed25519 signature, if the commit has any (valid, if one of them was
+    /// made by a trusted key).
+    void verifyEd25519(GVariant* variant,
+                       GVariant* detachedMetadata,
+                       std::vector<Signature>& signatures) const;
+
+    OstreeSign* ed25519{nullptr};  // nullptr, if libostree was built without ed25519 support
+    bool ed25519KeysLoaded{false};
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,64 @@
+#include "stringArena.hpp"
+
+// C++
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+namespace cpplibostree {
+
+StringArena::StringArena(size_t blockSize) : blockSize(blockSize) {}
+
+std::string_view StringArena::Store(std::string_view value) {
+    if (value.empty()) {
+        return {};
+    }
+
+    char* target{nullptr};
+    if (value.size() > blockSize) {
+        // oversized strings get a block of their own, the current block stays in use
+        auto block = std::make_unique_for_overwrite<char[]>(value.size());
+        target = block.get();
+        blocks.insert(blocks.end() - (blocks.empty() ? 0 : 1), std::move(block));
+        statistics.allocatedBytes += value.size();
+    } else {
+        if (value.size() > blockFree) {
+            blocks.push_back(std::make_unique_for_overwrite<char[]>(blockSize));
+            blockFree = blockSize;
+            currentBlock = true;
+            statistics.allocatedBytes += blockSize;
+        }
+        target = blocks.back().get() + (blockSize - blockFree);
+        blockFree -= value.size();
+    }
+
+    std::memcpy(target, value.data(), value.size());
+    statistics.usedBytes += value.size();
+    statistics.blocks = blocks.size();
+    return {target, value.size()};
+}
+
+void StringArena::Clear() {
+    blocks.clear();
+    blockFree = 0;
+    currentBlock = false;
+    statistics = {};
+}
+
+void StringArena::Reset() {
+    if (!currentBlock) {
+        Clear();
+        return;
+    }
+    std::unique_ptr<char[]> block = std::move(blocks.back());
+    blocks.clear();
+    blocks.push_back(std::move(block));
+    blockFree = blockSize;
+    statistics = {1, 0, blockSize};
+}
+
+const StringArenaStatistics& StringArena::GetStatistics() const {
+    return statistics;
+}
+
+}  // namespace cpplibostree
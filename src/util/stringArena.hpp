@@ -0,0 +1,58 @@
+/*_____________________________________________________________
+ | String Arena
+ |   Append-only storage for many small strings (e.g. commit
+ |   subjects & hashes). Strings are copied into large blocks
+ |   and handed out as string_views, that stay valid until the
+ |   arena is cleared or destroyed.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace cpplibostree {
+
+/// Memory usage of one or more StringArenas
+struct StringArenaStatistics {
+    size_t blocks{0};          // amount of block allocations
+    size_t usedBytes{0};       // bytes handed out by StringArena::Store()
+    size_t allocatedBytes{0};  // bytes allocated for all blocks
+};
+
+class StringArena {
+   public:
+    /// default size of a single block
+    static constexpr size_t DEFAULT_BLOCK_SIZE{64 * 1024};
+
+    explicit StringArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    /**
+     * @brief Copy a string into the arena.
+     *
+     * @param value String to copy.
+     * @return View on the copy, valid for the lifetime of the arena
+     */
+    std::string_view Store(std::string_view value);
+
+    /// @brief Release all blocks. Invalidates all views handed out before.
+    void Clear();
+
+    /// @brief Like Clear(), but keep the current block for the next strings (e.g. to reuse the
+    /// arena for one record after another without allocating).
+    void Reset();
+
+    /// Getter
+    [[nodiscard]] const StringArenaStatistics& GetStatistics() const;
+
+   private:
+    size_t blockSize;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockFree{0};        // free bytes in the last block
+    bool currentBlock{false};  // the last block takes the next strings (not an oversized one)
+    StringArenaStatistics statistics;
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,82 @@
+/*_____________________________________________________________
+ | Thread Pool
+ |   Small fixed-size worker pool for background work like
+ |   repository scans. Tasks are executed in FIFO order, low
+ |   priority tasks only when no other task is queued.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cpplibostree {
+
+enum class TaskPriority : uint8_t { NORMAL, LOW };
+
+class ThreadPool {
+   public:
+    /**
+     * @brief Construct a new ThreadPool and start its workers.
+     *
+     * @param threadCount Number of worker threads (0 = one per hardware thread).
+     */
+    explicit ThreadPool(size_t threadCount = 0);
+
+    /// @brief Stops all workers. Queued tasks, that have not been started yet, are dropped.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queue a task for execution on one of the workers.
+     *
+     * @param function Callable without arguments.
+     * @param priority Low priority tasks (e.g. speculative work) wait for all other tasks.
+     * @return Future holding the result of the task.
+     */
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> Submit(
+        Function&& function,
+        TaskPriority priority = TaskPriority::NORMAL) {
+        using Result = std::invoke_result_t<Function>;
+        auto task =
+            std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            (priority == TaskPriority::LOW ? lowPriorityTasks : tasks).emplace_back([task] {
+                (*task)();
+            });
+        }
+        condition.notify_one();
+        return future;
+    }
+
+    /// Getter
+    [[nodiscard]] size_t GetThreadCount() const;
+
+   private:
+    /// @brief Worker main loop: pops and runs tasks until the pool is stopped.
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::deque<std::function<void()>> lowPriorityTasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping{false};
+};
+
+}  // namespace cpplibostree
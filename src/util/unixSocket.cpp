@@ -0,0 +1,109 @@
+#include "unixSocket.hpp"
+
+// C++
+#include <filesystem>
+#include <string>
+// C
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+// external
+#include <glib.h>
+
+namespace cpplibostree {
+
+namespace {
+/// @brief Socket address of a path, false if the path is too long for a Unix socket.
+bool toSocketAddress(const std::string& path, sockaddr_un& address) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+}  // namespace
+
+int ConnectUnixSocket(const std::string& path) {
+    sockaddr_un address{};
+    if (!toSocketAddress(path, address)) {
+        return -1;
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int ListenUnixSocket(const std::string& path, std::string& error) {
+    sockaddr_un address{};
+    if (!toSocketAddress(path, address)) {
+        error = "socket path too long";
+        return -1;
+    }
+    const std::string directory = std::filesystem::path(path).parent_path().string();
+    if (!directory.empty() && g_mkdir_with_parents(directory.c_str(), 0700) != 0) {
+        error = "can't create " + directory;
+        return -1;
+    }
+    // a socket, that nobody listens on, is left over by a crashed process (other files are
+    // never replaced)
+    if (const int fd = ConnectUnixSocket(path); fd >= 0) {
+        ::close(fd);
+        error = "another process listens on it already";
+        return -1;
+    }
+    struct stat st{};
+    if (::lstat(path.c_str(), &st) == 0 && !S_ISSOCK(st.st_mode)) {
+        error = "the path exists & is not a socket";
+        return -1;
+    }
+
+    // bound in a private directory & restricted there, before it is moved into place: there
+    // is no window for others to connect (the process umask is not touched)
+    g_autofree gchar* privateDirectory =
+        g_build_filename(directory.empty() ? "." : directory.c_str(), ".socket-XXXXXX", nullptr);
+    if (g_mkdtemp(privateDirectory) == nullptr) {
+        error = std::strerror(errno);
+        return -1;
+    }
+    const std::string privatePath = std::string(privateDirectory) + "/s";
+    sockaddr_un privateAddress{};
+    if (!toSocketAddress(privatePath, privateAddress)) {
+        ::rmdir(privateDirectory);
+        error = "socket path too long";
+        return -1;
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    auto listenPrivately = [&] {
+        const auto* socketAddress = reinterpret_cast<const sockaddr*>(&privateAddress);
+        return ::bind(fd, socketAddress, sizeof(privateAddress)) == 0 &&
+               ::chmod(privatePath.c_str(), 0600) == 0 && ::listen(fd, SOMAXCONN) == 0 &&
+               // replaces a left over socket atomically
+               ::rename(privatePath.c_str(), path.c_str()) == 0;
+    };
+    const bool listening = fd >= 0 && listenPrivately();
+    if (!listening) {
+        error = std::strerror(errno);
+        ::unlink(privatePath.c_str());
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    ::rmdir(privateDirectory);
+    if (!listening) {
+        return -1;
+    }
+    return fd;
+}
+
+}  // namespace cpplibostree
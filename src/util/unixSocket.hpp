@@ -0,0 +1,35 @@
+/*_____________________________________________________________
+ | Unix Sockets
+ |   Helpers for the local sockets of ostree-tui (the index
+ |   daemon & the control socket): only the current user may
+ |   connect, sockets left over by a crashed process are
+ |   replaced.
+ |___________________________________________________________*/
+
+#pragma once
+// C++
+#include <string>
+
+namespace cpplibostree {
+
+/**
+ * @brief Connect to a Unix stream socket (blocking).
+ *
+ * @param path Path of the socket.
+ * @return Connected socket, or -1 if nobody listens on the path
+ */
+[[nodiscard]] int ConnectUnixSocket(const std::string& path);
+
+/**
+ * @brief Create a non-blocking, listening Unix stream socket, that only the current user may
+ * connect to (it is bound in a private directory first & then moved to its path). Missing
+ * parent directories are created (only accessible by the current user).
+ *
+ * @param path Path of the socket, replaces a socket that nobody listens on anymore (but never
+ * another kind of file).
+ * @param error Set to the reason, if the socket could not be created.
+ * @return Listening socket, or -1 (e.g. if another process listens on the path already)
+ */
+[[nodiscard]] int ListenUnixSocket(const std::string& path, std::string& error);
+
+}  // namespace cpplibostree